@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 199309L
+#include "audio.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AUDIO_X86 1
+#endif
+
+// Output frames mixed per pass, the mono scratch buffer lives on the stack
+#define AUDIO_BLOCK 256
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+void AudioQueue_init(AudioQueue* queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+bool AudioQueue_push(AudioQueue* queue, AudioCommand command) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == AUDIO_QUEUE_SIZE) {
+        return false;
+    }
+    queue->items[tail & (AUDIO_QUEUE_SIZE - 1)] = command;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool AudioQueue_pop(AudioQueue* queue, AudioCommand* command) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *command = queue->items[head & (AUDIO_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Adds n resampled frames of voice into mono, linear interpolation
+typedef void (*VoiceKernel)(const AudioVoice* voice, float* mono, size_t n);
+
+static void renderScalar(const AudioVoice* voice, float* mono, size_t n) {
+    const float* clip = voice->samples;
+    for (size_t i = 0; i < n; i++) {
+        double p = voice->pos + (double)voice->step * i;
+        size_t idx = min((size_t)p, voice->frames - 2);
+        float frac = p - idx;
+        float s = clip[idx] + (clip[idx + 1] - clip[idx]) * frac;
+        mono[i] += s * voice->gain;
+    }
+}
+
+#ifdef AUDIO_X86
+
+__attribute__((target("avx2")))
+static void renderAvx2(const AudioVoice* voice, float* mono, size_t n) {
+    const float* clip = voice->samples;
+    __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 step = _mm256_set1_ps(voice->step);
+    __m256 gain = _mm256_set1_ps(voice->gain);
+    __m256i last = _mm256_set1_epi32((int)voice->frames - 2);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // whole frames in double, only the offset within the block in float
+        double base = voice->pos + (double)voice->step * i;
+        double whole = floor(base);
+        __m256 rel = _mm256_add_ps(
+            _mm256_set1_ps(base - whole), _mm256_mul_ps(step, lane));
+        __m256 relFloor = _mm256_floor_ps(rel);
+        __m256 frac = _mm256_sub_ps(rel, relFloor);
+        __m256i idx = _mm256_add_epi32(
+            _mm256_set1_epi32((int)whole), _mm256_cvttps_epi32(relFloor));
+        idx = _mm256_min_epi32(idx, last);
+        __m256 a = _mm256_i32gather_ps(clip, idx, 4);
+        __m256 b = _mm256_i32gather_ps(clip + 1, idx, 4);
+        __m256 s = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), frac));
+        __m256 acc = _mm256_loadu_ps(mono + i);
+        _mm256_storeu_ps(mono + i, _mm256_add_ps(acc, _mm256_mul_ps(s, gain)));
+    }
+    AudioVoice rest = *voice;
+    rest.pos += (double)voice->step * i;
+    renderScalar(&rest, mono + i, n - i);
+}
+
+#endif
+
+static VoiceKernel kernel = NULL;
+static const char* kernelName = NULL;
+
+static void selectKernel(void) {
+#ifdef AUDIO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = renderAvx2;
+        kernelName = "avx2";
+        return;
+    }
+#endif
+    kernel = renderScalar;
+    kernelName = "scalar";
+}
+
+const char* Audio_kernel(void) {
+    if (!kernel) {
+        selectKernel();
+    }
+    return kernelName;
+}
+
+bool Audio_setKernel(const char* name) {
+    if (strcmp(name, "scalar") == 0) {
+        kernel = renderScalar;
+        kernelName = "scalar";
+        return true;
+    }
+#ifdef AUDIO_X86
+    if (strcmp(name, "avx2") == 0) {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) {
+            return false;
+        }
+        kernel = renderAvx2;
+        kernelName = "avx2";
+        return true;
+    }
+#endif
+    return false;
+}
+
+void AudioMixer_init(AudioMixer* mixer) {
+    // picked here so the audio thread never races on it
+    if (!kernel) {
+        selectKernel();
+    }
+    AudioQueue_init(&mixer->queue);
+    for (int i = 0; i < AUDIO_VOICES; i++) {
+        mixer->voices[i] = (AudioVoice) { .active = false };
+    }
+    atomic_init(&mixer->dropped, 0);
+    atomic_init(&mixer->stolen, 0);
+    atomic_init(&mixer->entered, 0);
+    atomic_init(&mixer->left, 0);
+    atomic_init(&mixer->closed, false);
+}
+
+void AudioMixer_play(
+    AudioMixer* mixer, const AudioClip* clip, float pitch, float gain)
+{
+    // interpolation reads two frames
+    if (!clip || clip->frames < 2) {
+        return;
+    }
+    AudioCommand command = { .clip = clip, .pitch = pitch, .gain = gain };
+    if (!AudioQueue_push(&mixer->queue, command)) {
+        atomic_fetch_add_explicit(&mixer->dropped, 1, memory_order_relaxed);
+    }
+}
+
+// A free voice, or the one closest to its end
+static void AudioMixer_start(AudioMixer* mixer, AudioCommand command) {
+    if (command.stop) {
+        for (int i = 0; i < AUDIO_VOICES; i++) {
+            if (mixer->voices[i].samples == command.clip->samples) {
+                mixer->voices[i].active = false;
+            }
+        }
+        return;
+    }
+    AudioVoice* voice = NULL;
+    for (int i = 0; i < AUDIO_VOICES && !voice; i++) {
+        if (!mixer->voices[i].active) {
+            voice = &mixer->voices[i];
+        }
+    }
+    if (!voice) {
+        voice = &mixer->voices[0];
+        for (int i = 1; i < AUDIO_VOICES; i++) {
+            if (mixer->voices[i].pos > voice->pos) {
+                voice = &mixer->voices[i];
+            }
+        }
+        atomic_fetch_add_explicit(&mixer->stolen, 1, memory_order_relaxed);
+    }
+    *voice = (AudioVoice) {
+        .active = command.pitch > 0,
+        .samples = command.clip->samples,
+        .frames = command.clip->frames,
+        .pos = 0,
+        .step = command.pitch,
+        .gain = command.gain,
+    };
+}
+
+// Output frames before the voice runs off the clip
+static size_t AudioVoice_framesLeft(const AudioVoice* voice) {
+    double left = (voice->frames - 1 - voice->pos) / voice->step;
+    return left > 0 ? (size_t)ceil(left) : 0;
+}
+
+static void AudioMixer_mix(
+    AudioMixer* mixer, float* out, size_t frames, int channels)
+{
+    AudioCommand command;
+    while (AudioQueue_pop(&mixer->queue, &command)) {
+        AudioMixer_start(mixer, command);
+    }
+
+    float mono[AUDIO_BLOCK];
+    for (size_t done = 0; done < frames; done += AUDIO_BLOCK) {
+        size_t block = min((size_t)AUDIO_BLOCK, frames - done);
+        size_t used = 0; // frames any voice wrote to
+        for (int v = 0; v < AUDIO_VOICES; v++) {
+            AudioVoice* voice = &mixer->voices[v];
+            if (!voice->active) {
+                continue;
+            }
+            size_t n = min(block, AudioVoice_framesLeft(voice));
+            if (n > used) {
+                memset(mono + used, 0, (n - used) * sizeof(float));
+                used = n;
+            }
+            kernel(voice, mono, n);
+            voice->pos += (double)voice->step * n;
+            if (n < block) {
+                voice->active = false;
+            }
+        }
+        if (used == 0) {
+            return;
+        }
+
+        float* o = out + done * channels;
+        for (size_t i = 0; i < used; i++) {
+            for (int c = 0; c < channels; c++) {
+                o[i * channels + c] += mono[i];
+            }
+        }
+    }
+}
+
+void AudioMixer_process(
+    AudioMixer* mixer, float* out, size_t frames, int channels)
+{
+    // entered before closed is read, so a fence that missed this call
+    // has closed set already
+    atomic_fetch_add(&mixer->entered, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load(&mixer->closed)) {
+        AudioMixer_mix(mixer, out, frames, channels);
+    }
+    atomic_fetch_add(&mixer->left, 1);
+}
+
+void AudioMixer_fence(AudioMixer* mixer) {
+    // calls are serialized on the audio thread, so once as many left as
+    // had entered by now, any later one pops the queue first
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t entered = atomic_load(&mixer->entered);
+    struct timespec wait = { .tv_sec = 0, .tv_nsec = 200000 };
+    while (atomic_load(&mixer->left) < entered) {
+        nanosleep(&wait, NULL);
+    }
+}
+
+void AudioMixer_stop(AudioMixer* mixer, const AudioClip* clip) {
+    if (!atomic_load(&mixer->closed)) {
+        AudioCommand command = { .clip = clip, .stop = true };
+        struct timespec wait = { .tv_sec = 0, .tv_nsec = 200000 };
+        while (!AudioQueue_push(&mixer->queue, command)) {
+            nanosleep(&wait, NULL);
+        }
+    }
+    AudioMixer_fence(mixer);
+}
+
+void AudioMixer_close(AudioMixer* mixer) {
+    atomic_store(&mixer->closed, true);
+    AudioMixer_fence(mixer);
+}
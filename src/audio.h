@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sound effect mixer for the audio thread
+// The game thread queues play commands through a single producer, single
+// consumer ring, the audio callback drains it and mixes every playing voice
+// into the device buffer. Voices resample their clip to change pitch, with
+// AVX2 gathers when the cpu has them. Nothing here locks or allocates.
+
+#define AUDIO_QUEUE_SIZE 64 // power of two
+#define AUDIO_VOICES 8
+
+// Mono float samples at the device sample rate
+typedef struct {
+    const float* samples;
+    size_t frames;
+} AudioClip;
+
+typedef struct {
+    const AudioClip* clip;
+    float pitch; // playback rate, 2 is an octave up
+    float gain;
+    bool stop; // ends every voice playing clip instead
+} AudioCommand;
+
+typedef struct {
+    _Alignas(64) atomic_size_t head; // next to pop, audio thread
+    _Alignas(64) atomic_size_t tail; // next to push, game thread
+    AudioCommand items[AUDIO_QUEUE_SIZE];
+} AudioQueue;
+
+void AudioQueue_init(AudioQueue* queue);
+// Producer side, false when full
+bool AudioQueue_push(AudioQueue* queue, AudioCommand command);
+// Consumer side, false when empty
+bool AudioQueue_pop(AudioQueue* queue, AudioCommand* command);
+
+typedef struct {
+    bool active;
+    const float* samples;
+    size_t frames;
+    double pos; // in clip frames
+    float step; // clip frames per output frame
+    float gain;
+} AudioVoice;
+
+typedef struct {
+    AudioQueue queue;
+    AudioVoice voices[AUDIO_VOICES];
+    atomic_size_t dropped; // commands the queue had no room for
+    atomic_size_t stolen; // voices cut off for a new one
+    // process calls started and finished, for AudioMixer_fence
+    atomic_size_t entered;
+    atomic_size_t left;
+    atomic_bool closed; // process returns without touching anything
+} AudioMixer;
+
+void AudioMixer_init(AudioMixer* mixer);
+// Game thread, the samples must stay alive until the voice ends or the
+// mixer stops being processed
+void AudioMixer_play(
+    AudioMixer* mixer, const AudioClip* clip, float pitch, float gain);
+// Audio thread, adds the voices into out, interleaved float frames
+void AudioMixer_process(
+    AudioMixer* mixer, float* out, size_t frames, int channels);
+// Game thread, returns once no process call that may have missed the
+// commands queued before it is still running. Doesn't wait for anything
+// while no call is running, so it's safe with the device stopped.
+void AudioMixer_fence(AudioMixer* mixer);
+// Ends every voice of clip, after it the samples can be freed. Waits for
+// room in the queue, so the mixer must be processed or closed.
+void AudioMixer_stop(AudioMixer* mixer, const AudioClip* clip);
+// No process call touches the mixer or a clip after this returns
+void AudioMixer_close(AudioMixer* mixer);
+
+// "avx2" or "scalar"
+const char* Audio_kernel(void);
+bool Audio_setKernel(const char* name);
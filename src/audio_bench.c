@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "audio.h"
+#include "timing.h"
+
+// Worst case time of the audio callback
+// usage: audio_bench [buffers] [frames per buffer] [avx2|scalar]
+// Every buffer starts with all voices playing at random pitches, while a
+// second thread keeps the command queue under pressure.
+
+#define SAMPLE_RATE 48000
+#define CHANNELS 2
+
+typedef struct {
+    AudioMixer* mixer;
+    const AudioClip* clip;
+    atomic_bool stop;
+    size_t sent;
+} Producer;
+
+void* produce(void* arg) {
+    Producer* producer = arg;
+    while (!atomic_load(&producer->stop)) {
+        AudioMixer_play(producer->mixer, producer->clip, 1, 0.5);
+        producer->sent++;
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    long buffers = argc > 1 ? atol(argv[1]) : 20000;
+    size_t frames = argc > 2 ? strtoul(argv[2], NULL, 0) : 512;
+    if (argc > 3 && !Audio_setKernel(argv[3])) {
+        fprintf(stderr, "kernel %s not available\n", argv[3]);
+        return 1;
+    }
+
+    // quarter second decaying tone, about as long as the hit sound
+    size_t clipFrames = SAMPLE_RATE / 4;
+    float* clip = malloc(clipFrames * sizeof(float));
+    for (size_t i = 0; i < clipFrames; i++) {
+        float t = (float)i / SAMPLE_RATE;
+        clip[i] = sinf(2 * 3.14159265f * 440 * t) * expf(-t * 12);
+    }
+
+    AudioClip sound = { .samples = clip, .frames = clipFrames };
+    AudioMixer mixer;
+    AudioMixer_init(&mixer);
+    float* out = malloc(frames * CHANNELS * sizeof(float));
+    double* times = malloc(buffers * sizeof(double));
+
+    Producer producer = { .mixer = &mixer, .clip = &sound, .sent = 0 };
+    atomic_init(&producer.stop, false);
+    pthread_t thread;
+    pthread_create(&thread, NULL, produce, &producer);
+
+    srand(1);
+    for (long b = 0; b < buffers; b++) {
+        for (int v = 0; v < AUDIO_VOICES; v++) {
+            float pitch = 0.5 + 1.5 * rand() / RAND_MAX;
+            AudioMixer_play(&mixer, &sound, pitch, 0.25);
+        }
+        memset(out, 0, frames * CHANNELS * sizeof(float));
+        double start = now();
+        AudioMixer_process(&mixer, out, frames, CHANNELS);
+        times[b] = now() - start;
+    }
+
+    atomic_store(&producer.stop, true);
+    pthread_join(thread, NULL);
+
+    double sum = 0;
+    for (long b = 0; b < buffers; b++) {
+        sum += times[b];
+    }
+    qsort(times, buffers, sizeof(double), compareDouble);
+    double deadline = (double)frames / SAMPLE_RATE;
+
+    printf("kernel        %s\n", Audio_kernel());
+    printf("buffers       %ld of %zu frames, %d voices\n",
+        buffers, frames, AUDIO_VOICES);
+    printf("mean          %.2f us\n", sum / buffers * 1e6);
+    printf("p99           %.2f us\n", times[(size_t)(buffers * 0.99)] * 1e6);
+    printf("max           %.2f us\n", times[buffers - 1] * 1e6);
+    printf("deadline      %.2f us at %d Hz, worst case uses %.2f%%\n",
+        deadline * 1e6, SAMPLE_RATE, times[buffers - 1] / deadline * 100);
+    printf("queue         %zu background plays, %zu dropped, %zu voices stolen\n",
+        producer.sent, atomic_load(&mixer.dropped),
+        atomic_load(&mixer.stolen));
+
+    free(times);
+    free(out);
+    free(clip);
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include "batch.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86 1
+#endif
+
+// Widest vector is 8 floats, keep every array aligned to it
+#define BATCH_ALIGN 32
+#define BATCH_LANES 8
+
+// Vector kernels load the two int8 of a GameInput as one int16
+_Static_assert(sizeof(GameInput) == 2, "GameInput must be two int8_t");
+
+static void GameBatch_selectKernel(void);
+
+static void* allocLanes(size_t capacity, size_t size) {
+    return aligned_alloc(BATCH_ALIGN, capacity * size);
+}
+
+size_t GameBatch_capacity(size_t count) {
+    size_t capacity = (count + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+    return capacity ? capacity : BATCH_LANES;
+}
+
+GameBatch GameBatch_init(size_t count, enum Mode mode, uint64_t seed) {
+    size_t capacity = GameBatch_capacity(count);
+    GameBatchFields fields = {
+        .ballX = allocLanes(capacity, sizeof(float)),
+        .ballY = allocLanes(capacity, sizeof(float)),
+        .velX = allocLanes(capacity, sizeof(float)),
+        .velY = allocLanes(capacity, sizeof(float)),
+        .p0y = allocLanes(capacity, sizeof(float)),
+        .p1y = allocLanes(capacity, sizeof(float)),
+        .score0 = allocLanes(capacity, sizeof(uint32_t)),
+        .score1 = allocLanes(capacity, sizeof(uint32_t)),
+    };
+    GameBatch batch = GameBatch_initIn(count, mode, seed, 0, fields);
+    batch.ownsFields = true;
+    return batch;
+}
+
+GameBatch GameBatch_initIn(
+    size_t count, enum Mode mode, uint64_t seed, uint64_t firstMatch,
+    GameBatchFields fields)
+{
+    assert(mode != CPU_VS_CPU);
+    // here and not on the first step, which shard threads all take at once
+    GameBatch_selectKernel();
+    size_t capacity = GameBatch_capacity(count);
+    GameBatch batch = {
+        .mode = mode,
+        .count = count,
+        .capacity = capacity,
+        .ballX = fields.ballX,
+        .ballY = fields.ballY,
+        .velX = fields.velX,
+        .velY = fields.velY,
+        .p0y = fields.p0y,
+        .p1y = fields.p1y,
+        .chanceOffset = allocLanes(capacity, sizeof(float)),
+        .score0 = fields.score0,
+        .score1 = fields.score1,
+        .ended = allocLanes(capacity, sizeof(uint32_t)),
+        .rng = allocLanes(capacity, sizeof(Rng)),
+        .rollLanes = allocLanes(capacity, sizeof(uint32_t)),
+        .rollRngs = allocLanes(capacity, sizeof(Rng)),
+        .rollDraws = allocLanes(capacity, sizeof(uint32_t)),
+    };
+    for (size_t i = 0; i < capacity; i++) {
+        batch.chanceOffset[i] = 0;
+        GameBatch_reset(&batch, i, seed, firstMatch + i);
+        if (i >= count) {
+            batch.ended[i] = UINT32_MAX;
+        }
+    }
+    return batch;
+}
+
+void GameBatch_del(GameBatch* batch) {
+    if (batch->ownsFields) {
+        free(batch->ballX);
+        free(batch->ballY);
+        free(batch->velX);
+        free(batch->velY);
+        free(batch->p0y);
+        free(batch->p1y);
+        free(batch->score0);
+        free(batch->score1);
+    }
+    free(batch->chanceOffset);
+    free(batch->ended);
+    free(batch->rng);
+    free(batch->rollLanes);
+    free(batch->rollRngs);
+    free(batch->rollDraws);
+    *batch = (GameBatch){ .count = 0 };
+}
+
+// Remembers a lane whose cpu offset was just cleared, unless it already is
+// queued. Every lane is in the queue at most once.
+static inline void GameBatch_queueRoll(
+    GameBatch* batch, size_t i, bool wasPending)
+{
+    if (batch->mode == ONE_PLAYER && !wasPending &&
+        isnan(batch->chanceOffset[i]))
+    {
+        batch->rollLanes[batch->rollCount++] = i;
+    }
+}
+
+void GameBatch_reset(
+    GameBatch* batch, size_t i, uint64_t seed, uint64_t matchId)
+{
+    Game game = Game_initMatch(batch->mode, seed, matchId);
+    bool pending = isnan(batch->chanceOffset[i]);
+    GameBatch_set(batch, i, &game);
+    GameBatch_queueRoll(batch, i, pending);
+    Game_del(&game);
+}
+
+void GameBatch_get(const GameBatch* batch, size_t i, Game* game) {
+    game->ended = batch->ended[i] != 0;
+    game->rng = batch->rng[i];
+    game->ball = (Ball) {
+        .pos = { .x = batch->ballX[i], .y = batch->ballY[i] },
+        .vel = { .x = batch->velX[i], .y = batch->velY[i] },
+    };
+    game->players[0].score = batch->score0[i];
+    game->players[0].y = batch->p0y[i];
+    if (game->players[0].isCpu) {
+        game->players[0].cpu.chanceOffset = batch->chanceOffset[i];
+    }
+    game->players[1].score = batch->score1[i];
+    game->players[1].y = batch->p1y[i];
+}
+
+void GameBatch_set(GameBatch* batch, size_t i, const Game* game) {
+    // the kernels only implement the discrete step and the chasing cpu
+    assert(!game->swept);
+    assert(!game->players[0].isCpu ||
+        game->players[0].cpu.params.aim == CPU_AIM_CHASE);
+    batch->ended[i] = game->ended ? UINT32_MAX : 0;
+    batch->rng[i] = game->rng;
+    batch->ballX[i] = game->ball.pos.x;
+    batch->ballY[i] = game->ball.pos.y;
+    batch->velX[i] = game->ball.vel.x;
+    batch->velY[i] = game->ball.vel.y;
+    batch->score0[i] = game->players[0].score;
+    batch->p0y[i] = game->players[0].y;
+    batch->chanceOffset[i] = game->players[0].isCpu ?
+        game->players[0].cpu.chanceOffset :
+        0;
+    batch->score1[i] = game->players[1].score;
+    batch->p1y[i] = game->players[1].y;
+}
+
+// Reference path, steps one lane through Game_step
+static void GameBatch_stepLane(GameBatch* batch, size_t i, GameInput input) {
+    Game game = {
+        .init = true,
+        .players = {{
+            .isCpu = batch->mode == ONE_PLAYER,
+            .cpu = { .params = CPU_PARAMS_DEFAULT },
+        }},
+    };
+    GameBatch_get(batch, i, &game);
+    bool pending = isnan(batch->chanceOffset[i]);
+    Game_step(&game, input, NULL);
+    GameBatch_set(batch, i, &game);
+    GameBatch_queueRoll(batch, i, pending);
+}
+
+static void GameBatch_stepScalar(GameBatch* batch, const GameInput* inputs) {
+    for (size_t i = 0; i < batch->count; i++) {
+        if (!batch->ended[i]) {
+            GameBatch_stepLane(batch, i, inputs ? inputs[i] : GAME_INPUT_IDLE);
+        }
+    }
+}
+
+#ifdef BATCH_X86
+
+#define vblendMasked(a, b, m, and, andnot, or) or(and(m, b), andnot(m, a))
+
+// SSE2, baseline on x86-64
+#define VF __m128
+#define VLANES 4
+#define KERNEL GameBatch_stepSse2
+#define KERNEL_TARGET __attribute__((target("sse2")))
+#define vset1 _mm_set1_ps
+#define vload _mm_load_ps
+#define vstore _mm_store_ps
+#define vadd _mm_add_ps
+#define vsub _mm_sub_ps
+#define vmul _mm_mul_ps
+#define vdiv _mm_div_ps
+#define vmin _mm_min_ps
+#define vand _mm_and_ps
+#define vandnot _mm_andnot_ps
+#define vor _mm_or_ps
+#define vneg(a) _mm_xor_ps(a, _mm_set1_ps(-0.f))
+#define vcmplt _mm_cmplt_ps
+#define vcmple _mm_cmple_ps
+#define vcmpgt _mm_cmpgt_ps
+#define vcmpeq _mm_cmpeq_ps
+#define vcmpunord _mm_cmpunord_ps
+#define vmovemask _mm_movemask_ps
+#define vblend(a, b, m) \
+    vblendMasked(a, b, m, _mm_and_ps, _mm_andnot_ps, _mm_or_ps)
+#define vsignmask(a) \
+    _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(a), 31))
+#define vloadInputs(in, dy0, dy1) \
+    do { \
+        __m128i raw = _mm_loadl_epi64((const __m128i*)(in)); \
+        __m128i x = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16); \
+        *(dy0) = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(x, 24), 24)); \
+        *(dy1) = _mm_cvtepi32_ps(_mm_srai_epi32(x, 8)); \
+    } while (0)
+
+#include "batch_kernel.h"
+
+#undef VF
+#undef VLANES
+#undef KERNEL
+#undef KERNEL_TARGET
+#undef vset1
+#undef vload
+#undef vstore
+#undef vadd
+#undef vsub
+#undef vmul
+#undef vdiv
+#undef vmin
+#undef vand
+#undef vandnot
+#undef vor
+#undef vneg
+#undef vcmplt
+#undef vcmple
+#undef vcmpgt
+#undef vcmpeq
+#undef vcmpunord
+#undef vmovemask
+#undef vblend
+#undef vsignmask
+#undef vloadInputs
+
+// AVX2
+#define VF __m256
+#define VLANES 8
+#define KERNEL GameBatch_stepAvx2
+#define KERNEL_TARGET __attribute__((target("avx2")))
+#define vset1 _mm256_set1_ps
+#define vload _mm256_load_ps
+#define vstore _mm256_store_ps
+#define vadd _mm256_add_ps
+#define vsub _mm256_sub_ps
+#define vmul _mm256_mul_ps
+#define vdiv _mm256_div_ps
+#define vmin _mm256_min_ps
+#define vand _mm256_and_ps
+#define vandnot _mm256_andnot_ps
+#define vor _mm256_or_ps
+#define vneg(a) _mm256_xor_ps(a, _mm256_set1_ps(-0.f))
+#define vcmplt(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define vcmple(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define vcmpgt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define vcmpeq(a, b) _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define vcmpunord(a, b) _mm256_cmp_ps(a, b, _CMP_UNORD_Q)
+#define vmovemask _mm256_movemask_ps
+#define vblend _mm256_blendv_ps
+#define vsignmask(a) \
+    _mm256_castsi256_ps(_mm256_srai_epi32(_mm256_castps_si256(a), 31))
+#define vloadInputs(in, dy0, dy1) \
+    do { \
+        __m256i x = _mm256_cvtepi16_epi32( \
+            _mm_loadu_si128((const __m128i*)(in))); \
+        *(dy0) = _mm256_cvtepi32_ps( \
+            _mm256_srai_epi32(_mm256_slli_epi32(x, 24), 24)); \
+        *(dy1) = _mm256_cvtepi32_ps(_mm256_srai_epi32(x, 8)); \
+    } while (0)
+
+#include "batch_kernel.h"
+
+#endif
+
+typedef void (*GameBatchKernel)(GameBatch*, const GameInput*);
+
+static GameBatchKernel kernel = NULL;
+static const char* kernelName = NULL;
+
+// Unless set already, by an earlier batch or GameBatch_setKernel
+static void GameBatch_selectKernel(void) {
+    if (kernel) {
+        return;
+    }
+#ifdef BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = GameBatch_stepAvx2;
+        kernelName = "avx2";
+    } else {
+        kernel = GameBatch_stepSse2;
+        kernelName = "sse2";
+    }
+#else
+    kernel = GameBatch_stepScalar;
+    kernelName = "scalar";
+#endif
+}
+
+// Cpu_update rolls a new offset first thing in a tick whenever the last
+// one was used up by a hit. The kernels queue those lanes, and all of the
+// rolls are drawn together here so the kernel never drops to Game_step for
+// them.
+static void GameBatch_rollCpuOffsets(GameBatch* batch) {
+    size_t n = 0;
+    for (size_t k = 0; k < batch->rollCount; k++) {
+        uint32_t i = batch->rollLanes[k];
+        if (!batch->ended[i]) {
+            batch->rollLanes[n] = i;
+            batch->rollRngs[n] = batch->rng[i];
+            n++;
+        }
+    }
+    batch->rollCount = 0;
+    if (n == 0) {
+        return;
+    }
+
+    Rng_nextBatch(batch->rollRngs, n, batch->rollDraws);
+
+    // same conversions as Cpu_update
+    float fac = 100000.f;
+    int maxOffset = CPU_PARAMS_DEFAULT.chaseOffset * fac;
+    for (size_t k = 0; k < n; k++) {
+        uint32_t i = batch->rollLanes[k];
+        batch->rng[i] = batch->rollRngs[k];
+        batch->chanceOffset[i] =
+            Rng_rangeOf(batch->rollDraws[k], 0, maxOffset) / fac;
+    }
+}
+
+void GameBatch_step(GameBatch* batch, const GameInput* inputs) {
+    if (batch->mode == ONE_PLAYER) {
+        GameBatch_rollCpuOffsets(batch);
+    }
+    kernel(batch, inputs);
+}
+
+const char* GameBatch_kernel(void) {
+    GameBatch_selectKernel();
+    return kernelName;
+}
+
+bool GameBatch_setKernel(const char* name) {
+    if (strcmp(name, "scalar") == 0) {
+        kernel = GameBatch_stepScalar;
+        kernelName = "scalar";
+        return true;
+    }
+#ifdef BATCH_X86
+    if (strcmp(name, "sse2") == 0) {
+        kernel = GameBatch_stepSse2;
+        kernelName = "sse2";
+        return true;
+    }
+    if (strcmp(name, "avx2") == 0) {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) {
+            return false;
+        }
+        kernel = GameBatch_stepAvx2;
+        kernelName = "avx2";
+        return true;
+    }
+#endif
+    return false;
+}
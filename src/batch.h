@@ -0,0 +1,74 @@
+#pragma once
+
+#include "sim.h"
+
+// Many matches stepped together
+// State is stored as one array per field so the ball and paddle physics can
+// run several matches per SIMD instruction. Results are bit identical to
+// stepping each match with Game_step.
+
+typedef struct {
+    enum Mode mode;
+    size_t count;
+    size_t capacity; // count rounded up to the widest vector
+
+    float* ballX;
+    float* ballY;
+    float* velX;
+    float* velY;
+    float* p0y;
+    float* p1y;
+    float* chanceOffset; // NAN when the cpu needs a new roll
+    uint32_t* score0;
+    uint32_t* score1;
+    uint32_t* ended; // all bits set once the match ended, also for padding
+    Rng* rng;
+    bool ownsFields; // false when the observed fields are caller memory
+
+    // lanes whose cpu rolls a new offset next tick, see GameBatch_step
+    uint32_t* rollLanes;
+    size_t rollCount;
+    Rng* rollRngs;
+    uint32_t* rollDraws;
+} GameBatch;
+
+// What an observer of the matches reads
+typedef struct {
+    float* ballX;
+    float* ballY;
+    float* velX;
+    float* velY;
+    float* p0y;
+    float* p1y;
+    uint32_t* score0;
+    uint32_t* score1;
+} GameBatchFields;
+
+// Match i starts like Game_initMatch(mode, seed, i)
+// ONE_PLAYER or TWO_PLAYERS, the cpu always plays with CPU_PARAMS_DEFAULT
+GameBatch GameBatch_init(size_t count, enum Mode mode, uint64_t seed);
+// Entries every array of a batch of count matches has
+size_t GameBatch_capacity(size_t count);
+// Same with the observed fields in caller memory, to share them without
+// copies. Each array needs GameBatch_capacity(count) entries aligned to 32
+// bytes. Match i starts as match firstMatch + i.
+GameBatch GameBatch_initIn(
+    size_t count, enum Mode mode, uint64_t seed, uint64_t firstMatch,
+    GameBatchFields fields);
+void GameBatch_del(GameBatch* batch); // Doesn't free the batch pointer
+
+void GameBatch_reset(
+    GameBatch* batch, size_t i, uint64_t seed, uint64_t matchId);
+// Copies match i in or out, game must come from Game_init with the same mode
+void GameBatch_get(const GameBatch* batch, size_t i, Game* game);
+void GameBatch_set(GameBatch* batch, size_t i, const Game* game);
+
+// inputs has count entries or is NULL for idle players
+// Ended matches don't move
+void GameBatch_step(GameBatch* batch, const GameInput* inputs);
+
+// Name of the kernel GameBatch_step dispatches to, "avx2", "sse2" or "scalar"
+// The widest one the cpu supports is picked by the first GameBatch_init,
+// unless overridden before. Set it before any thread steps a batch.
+const char* GameBatch_kernel(void);
+bool GameBatch_setKernel(const char* name); // false if unsupported
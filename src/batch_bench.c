@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "batch.h"
+#include "timing.h"
+
+// Throughput of GameBatch_step, cpu against a scripted player
+// Ended matches restart as a new match id so every lane keeps ticking
+// usage: batch_bench [matches] [ticks] [kernel] [check]
+// check steps a Game per lane next to the batch and compares every tick
+
+int8_t scriptedInput(float ballY, float paddleY) {
+    float dy = ballY - paddleY;
+    return dy < -pdy ? -1 : dy > pdy ? 1 : 0;
+}
+
+bool sameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Compares lane i with game, prints the first difference
+bool checkLane(GameBatch* batch, size_t i, Game* game, size_t tick) {
+    Game lane = {
+        .init = true,
+        .players = {{ .isCpu = batch->mode == ONE_PLAYER }},
+    };
+    GameBatch_get(batch, i, &lane);
+
+    bool same =
+        lane.ended == game->ended &&
+        memcmp(&lane.rng, &game->rng, sizeof(Rng)) == 0 &&
+        sameFloat(lane.ball.pos.x, game->ball.pos.x) &&
+        sameFloat(lane.ball.pos.y, game->ball.pos.y) &&
+        sameFloat(lane.ball.vel.x, game->ball.vel.x) &&
+        sameFloat(lane.ball.vel.y, game->ball.vel.y) &&
+        lane.players[0].score == game->players[0].score &&
+        lane.players[1].score == game->players[1].score &&
+        sameFloat(lane.players[0].y, game->players[0].y) &&
+        sameFloat(lane.players[1].y, game->players[1].y);
+    if (same && game->players[0].isCpu) {
+        float a = lane.players[0].cpu.chanceOffset;
+        float b = game->players[0].cpu.chanceOffset;
+        same = (isnan(a) && isnan(b)) || sameFloat(a, b);
+    }
+    if (!same) {
+        printf(
+            "mismatch at tick %zu, match %zu: "
+            "ball (%a, %a) vs (%a, %a), paddles (%a, %a) vs (%a, %a)\n",
+            tick, i,
+            lane.ball.pos.x, lane.ball.pos.y,
+            game->ball.pos.x, game->ball.pos.y,
+            lane.players[0].y, lane.players[1].y,
+            game->players[0].y, game->players[1].y);
+    }
+    return same;
+}
+
+int main(int argc, char** argv) {
+    size_t matches = argc > 1 ? strtoull(argv[1], NULL, 0) : 4096;
+    size_t ticks = argc > 2 ? strtoull(argv[2], NULL, 0) : 20000;
+    if (argc > 3 && strcmp(argv[3], "auto") != 0 &&
+        !GameBatch_setKernel(argv[3]))
+    {
+        fprintf(stderr, "kernel %s isn't supported\n", argv[3]);
+        return 1;
+    }
+    bool check = argc > 4 && strcmp(argv[4], "check") == 0;
+
+    uint64_t seed = 1;
+    GameBatch batch = GameBatch_init(matches, ONE_PLAYER, seed);
+    uint64_t nextMatch = matches;
+    GameInput* inputs = calloc(matches, sizeof(*inputs));
+
+    Game* games = NULL;
+    if (check) {
+        games = malloc(matches * sizeof(*games));
+        for (size_t i = 0; i < matches; i++) {
+            games[i] = Game_initMatch(ONE_PLAYER, seed, i);
+        }
+    }
+
+    size_t matchTicks = 0;
+    size_t finished = 0;
+    double elapsed = 0;
+    for (size_t t = 0; t < ticks; t++) {
+        for (size_t i = 0; i < matches; i++) {
+            inputs[i].dy[1] = scriptedInput(batch.ballY[i], batch.p1y[i]);
+        }
+
+        double start = now();
+        GameBatch_step(&batch, inputs);
+        elapsed += now() - start;
+        matchTicks += matches;
+
+        if (check) {
+            for (size_t i = 0; i < matches; i++) {
+                Game_step(&games[i], inputs[i], NULL);
+                if (!checkLane(&batch, i, &games[i], t)) {
+                    return 1;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < matches; i++) {
+            if (batch.ended[i]) {
+                finished++;
+                GameBatch_reset(&batch, i, seed, nextMatch);
+                if (check) {
+                    Game_del(&games[i]);
+                    games[i] = Game_initMatch(ONE_PLAYER, seed, nextMatch);
+                }
+                nextMatch++;
+            }
+        }
+    }
+
+    printf("kernel            %s\n", GameBatch_kernel());
+    printf("matches           %zu\n", matches);
+    printf("ticks             %zu\n", ticks);
+    printf("finished matches  %zu\n", finished);
+    printf("step time         %.3f s\n", elapsed);
+    printf("match-ticks/s     %.0f (1 core)\n", matchTicks / elapsed);
+    if (check) {
+        printf("check             every tick matches Game_step\n");
+    }
+
+    if (games) {
+        for (size_t i = 0; i < matches; i++) {
+            Game_del(&games[i]);
+        }
+        free(games);
+    }
+    free(inputs);
+    GameBatch_del(&batch);
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Vector kernel for GameBatch_step
+// Included by batch.c once per instruction set, no include guard on purpose.
+// Expects VF, VLANES, KERNEL, KERNEL_TARGET and the v* operations below to
+// be defined by the includer.
+//
+// Lanes that are out of bounds (scoring) take the scalar path in
+// GameBatch_stepLane, everything else is computed with masks in place of
+// the branches of sim.c. Cpu offsets were already rolled by
+// GameBatch_rollCpuOffsets, a NAN left here still goes the scalar path.
+
+KERNEL_TARGET
+static void KERNEL(GameBatch* batch, const GameInput* inputs) {
+    const bool cpu = batch->mode == ONE_PLAYER;
+
+    const VF zero = vset1(0.f);
+    const VF one = vset1(1.f);
+    const VF minusOne = vset1(-1.f);
+    const VF nan = vset1(NAN);
+
+    const VF pdyV = vset1(pdy);
+    const VF minusPdy = vset1(-pdy);
+    const VF paddleLow = vset1(boardHeight / 2);
+    const VF paddleHigh = vset1(1 - boardHeight / 2);
+    const VF slowDistance = vset1(cpuSlowMovingDistance);
+    const VF slowFactor = vset1(cpuSlowMovingFactor);
+
+    const VF ballHalf = vset1(ballWidth / 2);
+    const VF boardHalfHeight = vset1(boardHeight / 2);
+    const VF boardHeightV = vset1(boardHeight);
+    const VF p0Front = vset1(p0x + boardHalfWidth);
+    const VF p0Back = vset1(p0x - boardHalfWidth / 2);
+    const VF p1Front = vset1(p1x - boardHalfWidth);
+    const VF p1Back = vset1(p1x + boardHalfWidth / 2);
+    const VF speed = vset1(ballSpeedNormal);
+    const VF minusSpeed = vset1(-ballSpeedNormal);
+    const VF four = vset1(4.f);
+
+    for (size_t i = 0; i < batch->capacity; i += VLANES) {
+        VF ended = vload((const float*)(batch->ended + i));
+        VF bx = vload(batch->ballX + i);
+        VF by = vload(batch->ballY + i);
+        VF vx = vload(batch->velX + i);
+        VF vy = vload(batch->velY + i);
+        VF p0y = vload(batch->p0y + i);
+        VF p1y = vload(batch->p1y + i);
+        VF co = vload(batch->chanceOffset + i);
+
+        VF fixup = vor(vcmplt(bx, zero), vcmpgt(bx, one));
+        if (cpu) {
+            fixup = vor(fixup, vcmpunord(co, co));
+        }
+        VF skip = vor(ended, fixup);
+        int skipBits = vmovemask(skip);
+        int fixupBits = vmovemask(vandnot(ended, fixup));
+
+        GameInput laneInputs[VLANES];
+        const GameInput* in = inputs ? inputs + i : NULL;
+        if (in && i + VLANES > batch->count) {
+            for (size_t l = 0; l < VLANES; l++) {
+                laneInputs[l] = i + l < batch->count ? in[l] : GAME_INPUT_IDLE;
+            }
+            in = laneInputs;
+        }
+
+        if (skipBits != (1 << VLANES) - 1) {
+            VF dy0, dy1;
+            if (in) {
+                vloadInputs(in, &dy0, &dy1);
+            } else {
+                dy0 = zero;
+                dy1 = zero;
+            }
+
+            // Cpu_update or Player_update for the left player
+            VF newP0y;
+            if (cpu) {
+                VF dirUp = vor(
+                    vcmpgt(vy, zero),
+                    vandnot(vsignmask(vy),
+                        vand(vcmpeq(vy, zero), vcmplt(vx, zero))));
+                VF dir = vblend(minusOne, one, dirUp);
+                VF movingFac = vblend(one, slowFactor, vcmpgt(bx, slowDistance));
+                VF guess = vadd(by, vmul(co, dir));
+                VF maxStep = vmul(pdyV, movingFac);
+                VF up = vmin(maxStep, vmul(vsub(guess, p0y), movingFac));
+                VF down = vneg(vmin(maxStep, vmul(vsub(p0y, guess), movingFac)));
+                VF dy = vblend(
+                    vblend(zero, down, vcmpgt(p0y, guess)),
+                    up,
+                    vcmplt(p0y, guess));
+                newP0y = vadd(p0y, dy);
+            } else {
+                VF step = vor(
+                    vand(vcmplt(dy0, zero), minusPdy),
+                    vand(vcmpgt(dy0, zero), pdyV));
+                newP0y = vadd(p0y, step);
+            }
+            newP0y = vblend(newP0y, paddleHigh, vcmpgt(newP0y, paddleHigh));
+            newP0y = vblend(newP0y, paddleLow, vcmplt(newP0y, paddleLow));
+
+            VF step1 = vor(
+                vand(vcmplt(dy1, zero), minusPdy),
+                vand(vcmpgt(dy1, zero), pdyV));
+            VF newP1y = vadd(p1y, step1);
+            newP1y = vblend(newP1y, paddleHigh, vcmpgt(newP1y, paddleHigh));
+            newP1y = vblend(newP1y, paddleLow, vcmplt(newP1y, paddleLow));
+
+            // Ball_checkCollisionWithBoard
+            VF ballLeft = vsub(bx, ballHalf);
+            VF ballRight = vadd(bx, ballHalf);
+            VF ballTop = vsub(by, ballHalf);
+            VF ballBottom = vadd(by, ballHalf);
+
+            VF hit0 = vand(
+                vand(vcmplt(vx, zero),
+                    vand(vcmple(ballLeft, p0Front), vcmple(p0Back, ballRight))),
+                vand(vcmple(ballTop, vadd(newP0y, boardHalfHeight)),
+                    vcmple(vsub(newP0y, boardHalfHeight), ballBottom)));
+            VF hit1 = vandnot(hit0, vand(
+                vand(vcmpgt(vx, zero),
+                    vand(vcmple(ballLeft, p1Back), vcmple(p1Front, ballRight))),
+                vand(vcmple(ballTop, vadd(newP1y, boardHalfHeight)),
+                    vcmple(vsub(newP1y, boardHalfHeight), ballBottom))));
+
+            VF dis0 = vdiv(vsub(by, newP0y), boardHeightV);
+            VF dis1 = vdiv(vsub(by, newP1y), boardHeightV);
+            vx = vblend(vblend(vx, speed, hit0), minusSpeed, hit1);
+            vy = vblend(vy, vmul(vmul(dis0, four), speed), hit0);
+            vy = vblend(vy, vmul(vmul(dis1, four), speed), hit1);
+            if (cpu) {
+                co = vblend(co, nan, hit0);
+                int rollBits = vmovemask(vandnot(skip, hit0));
+                while (rollBits) {
+                    int l = __builtin_ctz(rollBits);
+                    rollBits &= rollBits - 1;
+                    batch->rollLanes[batch->rollCount++] = i + l;
+                }
+            }
+
+            // Ball_checkCollisionWithWall
+            VF futureY = vadd(by, vy);
+            VF wall = vor(vcmplt(futureY, zero), vcmpgt(futureY, one));
+            vy = vblend(vy, vneg(vy), wall);
+
+            bx = vadd(bx, vx);
+            by = vadd(by, vy);
+
+            #define storeLanes(field, value) \
+                vstore(batch->field + i, \
+                    vblend(value, vload(batch->field + i), skip))
+
+            storeLanes(ballX, bx);
+            storeLanes(ballY, by);
+            storeLanes(velX, vx);
+            storeLanes(velY, vy);
+            storeLanes(p0y, newP0y);
+            storeLanes(p1y, newP1y);
+            storeLanes(chanceOffset, co);
+
+            #undef storeLanes
+        }
+
+        while (fixupBits) {
+            int l = __builtin_ctz(fixupBits);
+            fixupBits &= fixupBits - 1;
+            GameBatch_stepLane(batch, i + l, in ? in[l] : GAME_INPUT_IDLE);
+        }
+    }
+}
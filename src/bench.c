@@ -0,0 +1,330 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "audio.h"
+#include "render.h"
+#include "sim.h"
+#include "sim_internal.h"
+#include "timing.h"
+
+// Microbenchmarks of the engine hot paths
+// usage: bench [--reps N] [--out FILE] [--baseline FILE] [--threshold PCT]
+//              [--filter NAME]
+// Every benchmark runs over the same pool of states sampled from recorded
+// matches, restored before each repetition so none of them drift. Results
+// are ns per op over the repetitions, --out writes them as CSV and
+// --baseline compares against an earlier CSV, exiting with 1 when the
+// median and the fastest repetition of any benchmark both got more than
+// --threshold percent (default 10) slower. Either one alone is often noise.
+
+#define BENCH_STATES 1024
+#define BENCH_SAMPLE_EVERY 13 // ticks between recorded states
+#define BENCH_AUDIO_FRAMES 512
+#define BENCH_SAMPLE_RATE 48000
+
+// Recorded states and the inputs and sounds that went with them
+typedef struct {
+    GameSnapshot snapshots[BENCH_STATES];
+    GameInput inputs[BENCH_STATES];
+    float pitches[BENCH_STATES]; // of hits, for the mixer
+    size_t hits;
+    Game games[BENCH_STATES]; // working copies
+    DrawList list;
+    AudioMixer mixer;
+    AudioClip clip;
+    float* out;
+} Bench;
+
+// One player matches against the ball follower, like render_bench
+void Bench_record(Bench* bench) {
+    size_t count = 0;
+    bench->hits = 0;
+    for (uint64_t match = 0; count < BENCH_STATES; match++) {
+        Game game = Game_initMatch(ONE_PLAYER, 1, match);
+        for (long tick = 0; !game.ended && count < BENCH_STATES; tick++) {
+            GameInput input = { .dy = { 0, Game_followBall(&game, 1) } };
+            if (tick % BENCH_SAMPLE_EVERY == 0) {
+                bench->snapshots[count] = Game_snapshot(&game);
+                bench->inputs[count] = input;
+                count++;
+            }
+            GameEvents events;
+            Game_step(&game, input, &events);
+            for (int i = 0; i < events.count; i++) {
+                GameEvent* event = &events.events[i];
+                if (event->type == GAMEEVENT_HIT &&
+                    bench->hits < BENCH_STATES)
+                {
+                    // same mapping as Game_playEvents
+                    float pitch = event->ballSpeed / ballSpeedNormal;
+                    pitch = pitch < 0.5 ? 0.5 : pitch > 2 ? 2 : pitch;
+                    bench->pitches[bench->hits++] = pitch;
+                }
+            }
+        }
+        Game_del(&game);
+    }
+}
+
+void Bench_restore(Bench* bench) {
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game_restore(&bench->games[i], &bench->snapshots[i]);
+    }
+    AudioMixer_init(&bench->mixer);
+}
+
+// Each returns the number of ops it ran
+
+size_t benchBallUpdate(Bench* bench) {
+    GameEvents events;
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game* g = &bench->games[i];
+        events.count = 0;
+        Ball_update(&g->ball, g->players, &g->firstHit, &g->rng, &events);
+    }
+    return BENCH_STATES;
+}
+
+size_t benchCpuUpdate(Bench* bench) {
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game* g = &bench->games[i];
+        Cpu_update(&g->players[0], &g->ball, &g->rng, 0, 1);
+    }
+    return BENCH_STATES;
+}
+
+size_t benchPlayerUpdate(Bench* bench) {
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game* g = &bench->games[i];
+        Player_update(&g->players[1], bench->inputs[i].dy[1], 1);
+    }
+    return BENCH_STATES;
+}
+
+size_t benchGameStep(Bench* bench) {
+    GameEvents events;
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game_step(&bench->games[i], bench->inputs[i], &events);
+    }
+    return BENCH_STATES;
+}
+
+size_t benchRender(Bench* bench) {
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game* g = &bench->games[i];
+        DrawList_reset(&bench->list);
+        Game_draw(&bench->list, g, Game_view(g), GAME_RENDER_ALL, 600, 400);
+    }
+    return BENCH_STATES;
+}
+
+// One device buffer each, with a hit starting every other buffer
+size_t benchAudioMix(Bench* bench) {
+    size_t buffers = 256;
+    for (size_t i = 0; i < buffers; i++) {
+        if (i % 2 == 0 && bench->hits) {
+            float pitch = bench->pitches[(i / 2) % bench->hits];
+            AudioMixer_play(&bench->mixer, &bench->clip, pitch, 1);
+        }
+        memset(bench->out, 0, BENCH_AUDIO_FRAMES * 2 * sizeof(float));
+        AudioMixer_process(&bench->mixer, bench->out, BENCH_AUDIO_FRAMES, 2);
+    }
+    return buffers;
+}
+
+typedef struct {
+    const char* name;
+    size_t (*run)(Bench* bench);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    { "ball_update", benchBallUpdate },
+    { "cpu_update", benchCpuUpdate },
+    { "player_update", benchPlayerUpdate },
+    { "game_step", benchGameStep },
+    { "render_commands", benchRender },
+    { "audio_mix_512", benchAudioMix },
+};
+#define BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+typedef struct {
+    char name[64];
+    size_t ops; // per repetition
+    int reps;
+    double mean; // ns per op
+    double stddev;
+    double median;
+    double min;
+    double max;
+} BenchResult;
+
+BenchResult Benchmark_run(const Benchmark* benchmark, Bench* bench, int reps) {
+    BenchResult result = { .reps = reps, .min = INFINITY, .max = 0 };
+    snprintf(result.name, sizeof(result.name), "%s", benchmark->name);
+    double* times = malloc(reps * sizeof(double));
+    double sum = 0;
+    double sumSquares = 0;
+    for (int r = -1; r < reps; r++) {
+        Bench_restore(bench);
+        double start = now();
+        size_t ops = benchmark->run(bench);
+        double ns = (now() - start) / ops * 1e9;
+        if (r < 0) {
+            continue; // warm up
+        }
+        result.ops = ops;
+        times[r] = ns;
+        sum += ns;
+        sumSquares += ns * ns;
+        result.min = ns < result.min ? ns : result.min;
+        result.max = ns > result.max ? ns : result.max;
+    }
+    result.mean = sum / reps;
+    double variance = sumSquares / reps - result.mean * result.mean;
+    result.stddev = variance > 0 ? sqrt(variance) : 0;
+    qsort(times, reps, sizeof(double), compareDouble);
+    result.median = times[reps / 2];
+    free(times);
+    return result;
+}
+
+#define CSV_HEADER \
+    "name,ops,reps,mean_ns,stddev_ns,median_ns,min_ns,max_ns\n"
+
+bool BenchResult_writeCsv(const BenchResult* results, size_t n, FILE* out) {
+    fprintf(out, CSV_HEADER);
+    for (size_t i = 0; i < n; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "%s,%zu,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n", r->name,
+            r->ops, r->reps, r->mean, r->stddev, r->median, r->min, r->max);
+    }
+    return !ferror(out);
+}
+
+// Returns how many rows were read, at most capacity
+size_t BenchResult_readCsv(BenchResult* results, size_t capacity, FILE* in) {
+    char line[256];
+    if (!fgets(line, sizeof(line), in) || strcmp(line, CSV_HEADER) != 0) {
+        return 0;
+    }
+    size_t n = 0;
+    while (n < capacity && fgets(line, sizeof(line), in)) {
+        BenchResult* r = &results[n];
+        if (sscanf(line, "%63[^,],%zu,%d,%lf,%lf,%lf,%lf,%lf", r->name,
+            &r->ops, &r->reps, &r->mean, &r->stddev, &r->median, &r->min,
+            &r->max) == 8)
+        {
+            n++;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char** argv) {
+    int reps = 200;
+    const char* outPath = NULL;
+    const char* baselinePath = NULL;
+    double threshold = 10;
+    const char* filter = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--reps") == 0) {
+            reps = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--out") == 0) {
+            outPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[i + 1];
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            threshold = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            filter = argv[i + 1];
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+
+    Bench* bench = malloc(sizeof(Bench));
+    Bench_record(bench);
+    for (int i = 0; i < BENCH_STATES; i++) {
+        bench->games[i] = Game_init(ONE_PLAYER, 1);
+    }
+    bench->list = DrawList_new(DRAW_LIST_CAPACITY, DRAW_LIST_TEXT_BYTES);
+    // quarter second decaying tone, about as long as the hit sound
+    size_t clipFrames = BENCH_SAMPLE_RATE / 4;
+    float* samples = malloc(clipFrames * sizeof(float));
+    for (size_t i = 0; i < clipFrames; i++) {
+        float t = (float)i / BENCH_SAMPLE_RATE;
+        samples[i] = sinf(2 * 3.14159265f * 440 * t) * expf(-t * 12);
+    }
+    bench->clip = (AudioClip) { .samples = samples, .frames = clipFrames };
+    bench->out = malloc(BENCH_AUDIO_FRAMES * 2 * sizeof(float));
+
+    BenchResult results[BENCHMARKS];
+    size_t n = 0;
+    printf("%-16s %10s %10s %10s %10s %10s\n",
+        "benchmark", "ns/op", "stddev", "median", "min", "max");
+    for (size_t b = 0; b < BENCHMARKS; b++) {
+        if (filter && !strstr(benchmarks[b].name, filter)) {
+            continue;
+        }
+        BenchResult r = Benchmark_run(&benchmarks[b], bench, reps);
+        printf("%-16s %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            r.name, r.mean, r.stddev, r.median, r.min, r.max);
+        results[n++] = r;
+    }
+    printf("audio kernel %s, %d states, %d reps\n",
+        Audio_kernel(), BENCH_STATES, reps);
+
+    int status = 0;
+    if (outPath) {
+        FILE* out = fopen(outPath, "w");
+        if (!out || !BenchResult_writeCsv(results, n, out)) {
+            fprintf(stderr, "can't write %s\n", outPath);
+            status = 1;
+        }
+        if (out) {
+            fclose(out);
+        }
+    }
+    if (baselinePath) {
+        FILE* in = fopen(baselinePath, "r");
+        BenchResult baseline[BENCHMARKS * 2];
+        size_t m = in ? BenchResult_readCsv(baseline, BENCHMARKS * 2, in) : 0;
+        if (in) {
+            fclose(in);
+        }
+        if (m == 0) {
+            fprintf(stderr, "no results in %s\n", baselinePath);
+            status = 1;
+        }
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < m; j++) {
+                if (strcmp(results[i].name, baseline[j].name) != 0) {
+                    continue;
+                }
+                double change =
+                    (results[i].median / baseline[j].median - 1) * 100;
+                double minChange =
+                    (results[i].min / baseline[j].min - 1) * 100;
+                bool slower = change > threshold && minChange > threshold;
+                printf("%-16s median %+7.1f%%  min %+7.1f%%%s\n",
+                    results[i].name, change, minChange,
+                    slower ? "  REGRESSION" : "");
+                if (slower) {
+                    status = 1;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < BENCH_STATES; i++) {
+        Game_del(&bench->games[i]);
+    }
+    DrawList_del(&bench->list);
+    free(bench->out);
+    free(samples);
+    free(bench);
+    return status;
+}
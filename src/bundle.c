@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+#include "bundle.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t alignUp(size_t n) {
+    return (n + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+}
+
+bool Bundle_open(Bundle* bundle, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BundleHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const BundleHeader* header = map;
+    const BundleEntry* entries = (const BundleEntry*)(header + 1);
+    size_t size = st.st_size;
+    bool ok = memcmp(header->magic, BUNDLE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->size == size &&
+        header->count <= (size - sizeof(*header)) / sizeof(BundleEntry);
+    for (uint32_t i = 0; ok && i < header->count; i++) {
+        const BundleEntry* entry = &entries[i];
+        ok = entry->offset % BUNDLE_ALIGN == 0 && entry->offset <= size &&
+            entry->frames <= (size - entry->offset) / sizeof(float) &&
+            memchr(entry->name, 0, sizeof(entry->name)) != NULL;
+    }
+    if (!ok) {
+        munmap(map, size);
+        return false;
+    }
+
+    *bundle = (Bundle) {
+        .map = map,
+        .size = size,
+        .header = header,
+        .entries = entries,
+    };
+    return true;
+}
+
+void Bundle_close(Bundle* bundle) {
+    if (bundle->map) {
+        munmap((void*)bundle->map, bundle->size);
+    }
+    *bundle = (Bundle) { .map = NULL };
+}
+
+const float* Bundle_find(const Bundle* bundle, const char* name, size_t* frames) {
+    if (!bundle->map) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < bundle->header->count; i++) {
+        const BundleEntry* entry = &bundle->entries[i];
+        if (strcmp(entry->name, name) == 0) {
+            *frames = entry->frames;
+            return (const float*)((const char*)bundle->map + entry->offset);
+        }
+    }
+    return NULL;
+}
+
+void Bundle_prefault(const Bundle* bundle) {
+    long page = sysconf(_SC_PAGESIZE);
+    volatile const char* bytes = bundle->map;
+    for (size_t i = 0; i < bundle->size; i += page) {
+        (void)bytes[i];
+    }
+}
+
+bool Bundle_write(
+    const char* path, uint32_t sampleRate, size_t count,
+    const char* const* names, const float* const* samples,
+    const size_t* frames)
+{
+    BundleEntry* entries = calloc(count, sizeof(BundleEntry));
+    size_t offset = alignUp(sizeof(BundleHeader) + count * sizeof(BundleEntry));
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(names[i]) >= BUNDLE_NAME_SIZE) {
+            fprintf(stderr, "name too long for a bundle: %s\n", names[i]);
+            free(entries);
+            return false;
+        }
+        strcpy(entries[i].name, names[i]);
+        entries[i].offset = offset;
+        entries[i].frames = frames[i];
+        offset = alignUp(offset + frames[i] * sizeof(float));
+    }
+    BundleHeader header = {
+        .count = count,
+        .sampleRate = sampleRate,
+        .size = offset,
+    };
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+
+    FILE* file = fopen(path, "wb");
+    bool ok = file &&
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(entries, sizeof(BundleEntry), count, file) == count;
+    size_t written = sizeof(header) + count * sizeof(BundleEntry);
+    static const char zeros[BUNDLE_ALIGN] = { 0 };
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = fwrite(zeros, 1, entries[i].offset - written, file) ==
+                entries[i].offset - written &&
+            fwrite(samples[i], sizeof(float), frames[i], file) == frames[i];
+        written = entries[i].offset + frames[i] * sizeof(float);
+    }
+    ok = ok && fwrite(zeros, 1, offset - written, file) == offset - written;
+    if (file) {
+        ok = fclose(file) == 0 && ok;
+    }
+    free(entries);
+    return ok;
+}
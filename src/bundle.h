@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sounds decoded ahead of time into one file, made by pack
+//
+// File layout, native byte order:
+//   BundleHeader
+//   BundleEntry[count]
+//   samples, every sound's mono floats starting on a BUNDLE_ALIGN boundary
+//
+// The file is mapped read only and the samples are played from the
+// mapping, so loading one costs no decoding and no copy.
+
+#define BUNDLE_MAGIC "PONGPAK1"
+#define BUNDLE_ALIGN 64
+#define BUNDLE_NAME_SIZE 64
+
+typedef struct {
+    char magic[8];
+    uint32_t count;
+    uint32_t sampleRate; // of every sound
+    uint64_t size; // of the whole file
+} BundleHeader;
+
+typedef struct {
+    char name[BUNDLE_NAME_SIZE]; // path the sound was packed from
+    uint64_t offset; // bytes from the start of the file
+    uint64_t frames;
+} BundleEntry;
+
+typedef struct {
+    const void* map; // NULL when closed
+    size_t size;
+    const BundleHeader* header;
+    const BundleEntry* entries;
+} Bundle;
+
+// Maps path and checks its index, false if it's missing or broken
+bool Bundle_open(Bundle* bundle, const char* path);
+void Bundle_close(Bundle* bundle);
+// Samples of the sound packed from name, NULL if there is none
+const float* Bundle_find(const Bundle* bundle, const char* name, size_t* frames);
+// Reads every page so playing doesn't fault on the audio thread
+void Bundle_prefault(const Bundle* bundle);
+
+// Writes count sounds, names[i] with frames[i] mono floats at sampleRate
+bool Bundle_write(
+    const char* path, uint32_t sampleRate, size_t count,
+    const char* const* names, const float* const* samples,
+    const size_t* frames);
@@ -0,0 +1,87 @@
+#include "ccd.h"
+#include <math.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+bool Ball_nextContact(
+    const Ball* ball, float start, float duration,
+    const float paddleFrom[2], const float paddleTo[2],
+    Contact* contact)
+{
+    Contact best = { .time = INFINITY };
+    // a ball already past a wall or goal line touches it right away
+    #define consider(contactType, contactSide, t) do { \
+        float time = max(start, (t)); \
+        if (time < best.time) { \
+            best = (Contact) { \
+                .type = (contactType), .side = (contactSide), .time = time }; \
+        } \
+    } while (0)
+
+    Vec2 pos = ball->pos;
+    Vec2 vel = ball->vel;
+
+    if (vel.y < 0) {
+        consider(CONTACT_WALL, 0, start + (0 - pos.y) / vel.y);
+    } else if (vel.y > 0) {
+        consider(CONTACT_WALL, 1, start + (1 - pos.y) / vel.y);
+    }
+
+    // Ball center on the paddle's front face, same extents as the
+    // discrete overlap test
+    int side = vel.x < 0 ? 0 : 1;
+    float face = Paddle_faceX(side);
+    bool approaching = side == 0 ? pos.x >= face : pos.x <= face;
+    if (vel.x != 0 && approaching) {
+        float t = start + (face - pos.x) / vel.x;
+        if (t <= duration) {
+            float y = pos.y + vel.y * (t - start);
+            float paddleY = Paddle_at(paddleFrom, paddleTo, side, t, duration);
+            if (fabsf(y - paddleY) <= boardHeight / 2 + ballWidth / 2) {
+                consider(CONTACT_PADDLE, side, t);
+            }
+        }
+    }
+    // Ball center on a paddle's top or bottom edge. Both paddles, a
+    // paddle moving along y can catch a ball that is leaving it
+    float reach = boardHeight / 2 + ballWidth / 2;
+    for (int s = 0; s < 2; s++) {
+        float rate = (paddleTo[s] - paddleFrom[s]) / duration;
+        float rel = vel.y - rate;
+        float d = pos.y - Paddle_at(paddleFrom, paddleTo, s, start, duration);
+        bool closing = d > 0 ? rel < 0 : rel > 0;
+        if (rel == 0 || fabsf(d) < reach || !closing) {
+            continue;
+        }
+        float t = start + ((d > 0 ? reach : -reach) - d) / rel;
+        if (t <= duration) {
+            float x = pos.x + vel.x * (t - start);
+            float paddleX = s == 0 ? p0x : p1x;
+            if (fabsf(x - paddleX) <= boardHalfWidth + ballWidth / 2) {
+                consider(CONTACT_PADDLE, s, t);
+            }
+        }
+    }
+    if (vel.x != 0) {
+        float goal = side == 0 ? 0 : 1;
+        consider(CONTACT_GOAL, side, start + (goal - pos.x) / vel.x);
+    }
+    #undef consider
+
+    if (best.time > duration) {
+        return false;
+    }
+    *contact = best;
+    return true;
+}
+
+float Ball_interceptY(const Ball* ball, float x, int* bounces) {
+    float t = (x - ball->pos.x) / ball->vel.x;
+    float y = ball->pos.y + ball->vel.y * t;
+    if (bounces) {
+        *bounces = (int)fabsf(floorf(y));
+    }
+    // reflecting between 0 and 1 repeats every 2
+    float m = y - 2 * floorf(y / 2);
+    return m > 1 ? 2 - m : m;
+}
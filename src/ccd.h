@@ -0,0 +1,55 @@
+#pragma once
+
+#include "sim.h"
+
+// Continuous collision for the ball
+// Finds the exact time at which the ball center reaches a wall, a goal line
+// or a paddle, grown by half the ball on every side. Paddles only move
+// along y, so the front face is tested by where the paddle is at the
+// contact time, and the top and bottom edges by the ball's y relative to
+// the moving paddle.
+//
+// Where this differs from the discrete step:
+// - an edge hit is a CONTACT_PADDLE and bounces like a hit at the end of
+//   the face, back toward the field, even if the ball was behind the face
+// - the discrete overlap test reaches only boardHalfWidth / 2 behind the
+//   paddle, the edges here span its full width
+// - a ball already overlapping a paddle isn't pushed out
+
+typedef struct {
+    enum ContactType {
+        CONTACT_WALL,
+        CONTACT_PADDLE,
+        CONTACT_GOAL, // ball left the field on side's end
+    } type;
+    int side; // paddle or goal, 0 left, 1 right
+    float time; // in ticks from the start of the sweep
+} Contact;
+
+// Paddles move linearly from paddleFrom to paddleTo over [0, duration]
+// Returns false if nothing is hit within [start, duration]
+bool Ball_nextContact(
+    const Ball* ball, float start, float duration,
+    const float paddleFrom[2], const float paddleTo[2],
+    Contact* contact);
+
+// Ball center x when it touches the front face of side's paddle
+static inline float Paddle_faceX(int side) {
+    return side == 0 ?
+        p0x + boardHalfWidth + ballWidth / 2 :
+        p1x - boardHalfWidth - ballWidth / 2;
+}
+
+// y where the ball center reaches x, with the walls folded in as
+// reflections. Exact for swept collision, the discrete step reflects up to
+// a tick early. bounces can be NULL.
+float Ball_interceptY(const Ball* ball, float x, int* bounces);
+
+// Paddle y at time t of a sweep
+static inline float Paddle_at(
+    const float paddleFrom[2], const float paddleTo[2],
+    int side, float t, float duration)
+{
+    float from = paddleFrom[side];
+    return from + (paddleTo[side] - from) * (t / duration);
+}
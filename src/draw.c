@@ -0,0 +1,205 @@
+#include "draw.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+Arena Arena_new(size_t size) {
+    return (Arena) {
+        .base = malloc(size),
+        .used = 0,
+        .size = size,
+    };
+}
+
+void Arena_del(Arena* arena) {
+    free(arena->base);
+    *arena = (Arena) { .base = NULL };
+}
+
+void* Arena_alloc(Arena* arena, size_t size) {
+    if (size > arena->size - arena->used) {
+        return NULL;
+    }
+    void* p = arena->base + arena->used;
+    arena->used += size;
+    return p;
+}
+
+void Arena_reset(Arena* arena) {
+    arena->used = 0;
+}
+
+DrawList DrawList_new(size_t capacity, size_t textBytes) {
+    return (DrawList) {
+        .commands = malloc(capacity * sizeof(DrawCommand)),
+        .count = 0,
+        .capacity = capacity,
+        .dropped = 0,
+        .text = Arena_new(textBytes),
+    };
+}
+
+void DrawList_del(DrawList* list) {
+    free(list->commands);
+    Arena_del(&list->text);
+    *list = (DrawList) { .commands = NULL };
+}
+
+void DrawList_reset(DrawList* list) {
+    list->count = 0;
+    list->dropped = 0;
+    Arena_reset(&list->text);
+}
+
+static DrawCommand* DrawList_push(DrawList* list) {
+    if (list->count == list->capacity) {
+        list->dropped++;
+        return NULL;
+    }
+    return &list->commands[list->count++];
+}
+
+void DrawList_rect(
+    DrawList* list, float x, float y, float w, float h, DrawColor color)
+{
+    DrawCommand* command = DrawList_push(list);
+    if (command) {
+        *command = (DrawCommand) {
+            .type = DRAW_RECT,
+            .color = color,
+            .x = x,
+            .y = y,
+            .w = w,
+            .h = h,
+        };
+    }
+}
+
+static void DrawList_pushText(
+    DrawList* list, const char* text, float x, float y, float size,
+    enum DrawAlign align, DrawColor color)
+{
+    DrawCommand* command = DrawList_push(list);
+    if (command) {
+        *command = (DrawCommand) {
+            .type = DRAW_TEXT,
+            .align = align,
+            .color = color,
+            .x = x,
+            .y = y,
+            .h = size,
+            .text = text,
+        };
+    }
+}
+
+void DrawList_text(
+    DrawList* list, const char* text, float x, float y, float size,
+    enum DrawAlign align, DrawColor color)
+{
+    size_t length = strlen(text) + 1;
+    char* copy = Arena_alloc(&list->text, length);
+    if (!copy) {
+        list->dropped++;
+        return;
+    }
+    memcpy(copy, text, length);
+    DrawList_pushText(list, copy, x, y, size, align, color);
+}
+
+void DrawList_textf(
+    DrawList* list, float x, float y, float size,
+    enum DrawAlign align, DrawColor color, const char* format, ...)
+{
+    // format straight into the arena, then give back what's unused
+    Arena* arena = &list->text;
+    char* text = arena->base + arena->used;
+    size_t left = arena->size - arena->used;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, left, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= left) {
+        list->dropped++;
+        return;
+    }
+    arena->used += length + 1;
+    DrawList_pushText(list, text, x, y, size, align, color);
+}
+
+void DrawList_beginLayer(DrawList* list, uint16_t layer, uint64_t key) {
+    DrawCommand* command = DrawList_push(list);
+    if (command) {
+        *command = (DrawCommand) {
+            .type = DRAW_LAYER_BEGIN,
+            .layer = layer,
+            .key = key,
+        };
+    }
+}
+
+void DrawList_endLayer(DrawList* list) {
+    DrawCommand* command = DrawList_push(list);
+    if (command) {
+        *command = (DrawCommand) { .type = DRAW_LAYER_END };
+    }
+}
+
+void DrawBackend_submit(
+    DrawBackend* backend, const DrawList* list, int w, int h)
+{
+    backend->submit(backend, list, w, h);
+    backend->frames++;
+}
+
+void DrawBackend_del(DrawBackend* backend) {
+    if (backend->del) {
+        backend->del(backend);
+    }
+}
+
+static void nullSubmit(
+    DrawBackend* backend, const DrawList* list, int w, int h)
+{
+}
+
+DrawBackend DrawBackend_null(void) {
+    return (DrawBackend) { .submit = nullSubmit };
+}
+
+static void serializerSubmit(
+    DrawBackend* backend, const DrawList* list, int w, int h)
+{
+    static const char* aligns[] = { "left", "center", "right" };
+    FILE* out = backend->data;
+    fprintf(out, "frame %zu %dx%d\n", backend->frames, w, h);
+    for (size_t i = 0; i < list->count; i++) {
+        const DrawCommand* c = &list->commands[i];
+        #define color(c) (c)->color.r, (c)->color.g, (c)->color.b, (c)->color.a
+        switch (c->type) {
+        case DRAW_RECT:
+            fprintf(out, "rect %g %g %g %g #%02x%02x%02x%02x\n",
+                c->x, c->y, c->w, c->h, color(c));
+            break;
+        case DRAW_TEXT:
+            fprintf(out, "text %g %g %g %s #%02x%02x%02x%02x \"%s\"\n",
+                c->x, c->y, c->h, aligns[c->align], color(c), c->text);
+            break;
+        case DRAW_LAYER_BEGIN:
+            fprintf(out, "layer %u %llx\n",
+                c->layer, (unsigned long long)c->key);
+            break;
+        case DRAW_LAYER_END:
+            fprintf(out, "end\n");
+            break;
+        }
+        #undef color
+    }
+    if (list->dropped) {
+        fprintf(out, "dropped %zu\n", list->dropped);
+    }
+}
+
+DrawBackend DrawBackend_serializer(FILE* out) {
+    return (DrawBackend) { .submit = serializerSubmit, .data = out };
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Draw command list
+// Render code records rects and text into a DrawList, a backend draws it.
+// The list and its text arena are allocated once and reset every frame.
+// No raylib here, so frames can be recorded without a window.
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} DrawColor;
+
+// same values as raylib's
+#define DRAW_WHITE ((DrawColor) { 255, 255, 255, 255 })
+#define DRAW_BLACK ((DrawColor) { 0, 0, 0, 255 })
+#define DRAW_DARKGRAY ((DrawColor) { 80, 80, 80, 255 })
+#define DRAW_LIGHTGRAY ((DrawColor) { 200, 200, 200, 255 })
+
+enum DrawAlign {
+    DRAW_ALIGN_LEFT,    // x is where the text starts
+    DRAW_ALIGN_CENTER,
+    DRAW_ALIGN_RIGHT,   // x is where the text ends
+};
+
+enum DrawCommandType {
+    DRAW_RECT,
+    DRAW_TEXT,
+    // Commands up to the matching DRAW_LAYER_END only change with key, so
+    // a backend may draw them once and reuse the result
+    DRAW_LAYER_BEGIN,
+    DRAW_LAYER_END,
+};
+
+typedef struct {
+    uint8_t type;
+    uint8_t align; // text only
+    uint16_t layer; // layer commands only
+    DrawColor color;
+    float x;
+    float y;
+    float w; // rect only
+    float h; // text: font size
+    union {
+        const char* text; // in the list's arena
+        uint64_t key; // DRAW_LAYER_BEGIN
+    };
+} DrawCommand;
+
+typedef struct {
+    char* base;
+    size_t used;
+    size_t size;
+} Arena;
+
+Arena Arena_new(size_t size);
+void Arena_del(Arena* arena);
+// NULL once full
+void* Arena_alloc(Arena* arena, size_t size);
+void Arena_reset(Arena* arena);
+
+typedef struct {
+    DrawCommand* commands;
+    size_t count;
+    size_t capacity;
+    size_t dropped; // commands that didn't fit since the last reset
+    Arena text;
+} DrawList;
+
+#define DRAW_LIST_CAPACITY 256
+#define DRAW_LIST_TEXT_BYTES 4096
+
+DrawList DrawList_new(size_t capacity, size_t textBytes);
+void DrawList_del(DrawList* list);
+void DrawList_reset(DrawList* list);
+
+void DrawList_rect(
+    DrawList* list, float x, float y, float w, float h, DrawColor color);
+// text is copied
+void DrawList_text(
+    DrawList* list, const char* text, float x, float y, float size,
+    enum DrawAlign align, DrawColor color);
+void DrawList_textf(
+    DrawList* list, float x, float y, float size,
+    enum DrawAlign align, DrawColor color, const char* format, ...);
+void DrawList_beginLayer(DrawList* list, uint16_t layer, uint64_t key);
+void DrawList_endLayer(DrawList* list);
+
+typedef struct DrawBackend {
+    void (*submit)(
+        struct DrawBackend* backend, const DrawList* list, int w, int h);
+    void (*del)(struct DrawBackend* backend);
+    void* data;
+    size_t frames;
+} DrawBackend;
+
+// Counts frames and draws nothing
+DrawBackend DrawBackend_null(void);
+// One line per command, for golden frame comparisons
+DrawBackend DrawBackend_serializer(FILE* out);
+// draw_raylib.c, needs a window. Call between BeginDrawing and EndDrawing.
+DrawBackend DrawBackend_raylib(void);
+
+void DrawBackend_submit(
+    DrawBackend* backend, const DrawList* list, int w, int h);
+void DrawBackend_del(DrawBackend* backend);
@@ -0,0 +1,157 @@
+#include "draw.h"
+#include <raylib.h>
+#include <stdlib.h>
+
+#define RAYLIB_LAYERS 4
+
+// Cached DRAW_LAYER_BEGIN contents, redrawn when the key or size changes
+typedef struct {
+    RenderTexture2D target; // id 0 until first used
+    uint64_t key;
+    int w;
+    int h;
+} RaylibLayer;
+
+typedef struct {
+    RaylibLayer layers[RAYLIB_LAYERS];
+    // rect waiting to be merged with the next one
+    bool pending;
+    Rectangle rect;
+    Color color;
+} RaylibBackend;
+
+static Color toColor(DrawColor c) {
+    return (Color) { .r = c.r, .g = c.g, .b = c.b, .a = c.a };
+}
+
+static bool sameColor(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void RaylibBackend_flush(RaylibBackend* backend) {
+    if (backend->pending) {
+        DrawRectangleRec(backend->rect, backend->color);
+        backend->pending = false;
+    }
+}
+
+// Same colored rects sharing an edge become one
+static void RaylibBackend_rect(RaylibBackend* backend, const DrawCommand* c) {
+    Rectangle rect = { .x = c->x, .y = c->y, .width = c->w, .height = c->h };
+    Color color = toColor(c->color);
+    if (backend->pending && sameColor(color, backend->color)) {
+        Rectangle* last = &backend->rect;
+        if (rect.y == last->y && rect.height == last->height &&
+            rect.x == last->x + last->width)
+        {
+            last->width += rect.width;
+            return;
+        }
+        if (rect.x == last->x && rect.width == last->width &&
+            rect.y == last->y + last->height)
+        {
+            last->height += rect.height;
+            return;
+        }
+    }
+    RaylibBackend_flush(backend);
+    backend->pending = true;
+    backend->rect = rect;
+    backend->color = color;
+}
+
+static void RaylibBackend_text(RaylibBackend* backend, const DrawCommand* c) {
+    RaylibBackend_flush(backend);
+    float x = c->x;
+    if (c->align != DRAW_ALIGN_LEFT) {
+        float width = MeasureText(c->text, c->h);
+        x -= c->align == DRAW_ALIGN_CENTER ? width / 2.f : width;
+    }
+    DrawText(c->text, x, c->y, c->h, toColor(c->color));
+}
+
+static void RaylibBackend_draw(
+    RaylibBackend* backend, const DrawCommand* c, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (c[i].type == DRAW_RECT) {
+            RaylibBackend_rect(backend, &c[i]);
+        } else if (c[i].type == DRAW_TEXT) {
+            RaylibBackend_text(backend, &c[i]);
+        }
+    }
+    RaylibBackend_flush(backend);
+}
+
+static void raylibSubmit(
+    DrawBackend* self, const DrawList* list, int w, int h)
+{
+    RaylibBackend* backend = self->data;
+    const DrawCommand* c = list->commands;
+    size_t i = 0;
+    while (i < list->count) {
+        if (c[i].type != DRAW_LAYER_BEGIN) {
+            size_t start = i;
+            while (i < list->count && c[i].type != DRAW_LAYER_BEGIN) {
+                i++;
+            }
+            RaylibBackend_draw(backend, c + start, i - start);
+            continue;
+        }
+
+        const DrawCommand* begin = &c[i];
+        size_t start = ++i;
+        while (i < list->count && c[i].type != DRAW_LAYER_END) {
+            i++;
+        }
+        size_t count = i - start;
+        i++;
+        if (begin->layer >= RAYLIB_LAYERS || w <= 0 || h <= 0) {
+            RaylibBackend_draw(backend, c + start, count);
+            continue;
+        }
+
+        RaylibLayer* layer = &backend->layers[begin->layer];
+        bool resized = !layer->target.id || layer->w != w || layer->h != h;
+        if (resized) {
+            if (layer->target.id) {
+                UnloadRenderTexture(layer->target);
+            }
+            layer->target = LoadRenderTexture(w, h);
+            layer->w = w;
+            layer->h = h;
+        }
+        if (resized || layer->key != begin->key) {
+            BeginTextureMode(layer->target);
+            ClearBackground(BLANK);
+            RaylibBackend_draw(backend, c + start, count);
+            EndTextureMode();
+            layer->key = begin->key;
+        }
+        // render textures are stored upside down
+        DrawTextureRec(
+            layer->target.texture,
+            (Rectangle) { .x = 0, .y = 0, .width = w, .height = -h },
+            (Vector2) { .x = 0, .y = 0 },
+            WHITE);
+    }
+}
+
+static void raylibDel(DrawBackend* self) {
+    RaylibBackend* backend = self->data;
+    for (int i = 0; i < RAYLIB_LAYERS; i++) {
+        if (backend->layers[i].target.id) {
+            UnloadRenderTexture(backend->layers[i].target);
+        }
+    }
+    free(backend);
+    self->data = NULL;
+}
+
+DrawBackend DrawBackend_raylib(void) {
+    return (DrawBackend) {
+        .submit = raylibSubmit,
+        .del = raylibDel,
+        .data = calloc(1, sizeof(RaylibBackend)),
+    };
+}
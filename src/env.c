@@ -0,0 +1,303 @@
+#define _GNU_SOURCE
+#include "env.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpuRelax() _mm_pause()
+#else
+#define cpuRelax() ((void)0)
+#endif
+
+// Shards are whole vectors of the batch kernels, so their slices of the
+// shared arrays stay aligned
+#define ENV_ALIGN 64
+#define ENV_SHARD_ALIGN 16
+
+typedef struct {
+    Env* env;
+    GameBatch batch;
+    size_t first; // of its lanes in the shared arrays
+    uint64_t nextMatch;
+    int32_t* margin; // right paddle's score minus the left's, per lane
+    pthread_t thread;
+} EnvShard;
+
+struct Env {
+    char name[256];
+    EnvShared* shared;
+    uint64_t seed;
+    int threads;
+    EnvShard* shards;
+};
+
+// Process shared, the trainer and the server are different processes
+static void futexWait(_Atomic uint32_t* word, uint32_t old) {
+    syscall(SYS_futex, word, FUTEX_WAIT, old, NULL, NULL, 0);
+}
+
+static void futexWake(_Atomic uint32_t* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Until word isn't old anymore, returns its new value
+static uint32_t Env_wait(
+    _Atomic uint32_t* word, _Atomic uint32_t* sleepers, uint32_t old)
+{
+    // on one cpu the other side can't run while we spin
+    static _Atomic int spins = -1;
+    if (spins < 0) {
+        spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? ENV_SPIN : 0;
+    }
+    uint32_t value;
+    for (int i = 0; i < spins; i++) {
+        value = atomic_load_explicit(word, memory_order_acquire);
+        if (value != old) {
+            return value;
+        }
+        cpuRelax();
+    }
+    // the waker checks sleepers after storing word, so one of us sees the
+    // other's write
+    atomic_fetch_add(sleepers, 1);
+    while ((value = atomic_load(word)) == old) {
+        futexWait(word, old);
+    }
+    atomic_fetch_sub(sleepers, 1);
+    return value;
+}
+
+static void Env_publish(
+    _Atomic uint32_t* word, _Atomic uint32_t* sleepers, uint32_t value)
+{
+    atomic_store(word, value);
+    if (atomic_load(sleepers)) {
+        futexWake(word);
+    }
+}
+
+static size_t alignUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+static void EnvShard_step(EnvShard* shard) {
+    EnvShared* shared = shard->env->shared;
+    GameBatch* batch = &shard->batch;
+    size_t first = shard->first;
+    const GameInput* actions = Env_array(shared, GameInput, actions) + first;
+    float* reward = Env_array(shared, float, reward) + first;
+    uint8_t* done = Env_array(shared, uint8_t, done) + first;
+
+    GameBatch_step(batch, actions);
+    for (size_t i = 0; i < batch->count; i++) {
+        int32_t margin = (int32_t)(batch->score1[i] - batch->score0[i]);
+        reward[i] = (float)(margin - shard->margin[i]);
+        shard->margin[i] = margin;
+        done[i] = batch->ended[i] != 0;
+    }
+    // a separate pass, ends are rare
+    for (size_t i = 0; i < batch->count; i++) {
+        if (done[i]) {
+            GameBatch_reset(batch, i, shard->env->seed, shard->nextMatch);
+            shard->nextMatch += shard->env->threads;
+            shard->margin[i] = 0;
+        }
+    }
+}
+
+static void* EnvShard_run(void* arg) {
+    EnvShard* shard = arg;
+    EnvShared* shared = shard->env->shared;
+    // not what request is once the thread runs, a trainer may have asked
+    // already
+    uint32_t seen = 0;
+    for (;;) {
+        seen = Env_wait(&shared->request, &shared->requestSleepers, seen);
+        if (atomic_load(&shared->closed)) {
+            break;
+        }
+        EnvShard_step(shard);
+        // the last shard answers, pending is reset before the trainer can
+        // ask again
+        if (atomic_fetch_sub(&shared->pending, 1) == 1) {
+            atomic_store(&shared->pending, shard->env->threads);
+            Env_publish(&shared->response, &shared->responseSleepers, seen);
+        }
+    }
+    return NULL;
+}
+
+Env* Env_create(
+    const char* name, size_t count, enum Mode mode, int threads,
+    uint64_t seed)
+{
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    size_t shardCount =
+        alignUp((count + threads - 1) / threads, ENV_SHARD_ALIGN);
+    shardCount = shardCount ? shardCount : ENV_SHARD_ALIGN;
+    // no empty shards
+    threads = (count + shardCount - 1) / shardCount;
+    threads = threads ? threads : 1;
+    size_t capacity = shardCount * threads;
+
+    EnvShared header = {
+        .count = count,
+        .capacity = capacity,
+        .mode = mode,
+        .threads = threads,
+    };
+    memcpy(header.magic, ENV_MAGIC, sizeof(header.magic));
+    size_t size = alignUp(sizeof(EnvShared), ENV_ALIGN);
+    #define place(field, type) \
+        header.field = size; \
+        size = alignUp(size + capacity * sizeof(type), ENV_ALIGN)
+    place(actions, GameInput);
+    place(ballX, float);
+    place(ballY, float);
+    place(velX, float);
+    place(velY, float);
+    place(p0y, float);
+    place(p1y, float);
+    place(score0, uint32_t);
+    place(score1, uint32_t);
+    place(reward, float);
+    place(done, uint8_t);
+    #undef place
+    header.size = size;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        perror(name);
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(name);
+        }
+        return NULL;
+    }
+    EnvShared* shared =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED) {
+        perror(name);
+        shm_unlink(name);
+        return NULL;
+    }
+    // the object starts zeroed, actions are idle
+    memcpy(shared, &header, sizeof(header));
+    atomic_init(&shared->pending, threads);
+
+    Env* env = calloc(1, sizeof(Env));
+    snprintf(env->name, sizeof(env->name), "%s", name);
+    env->shared = shared;
+    env->seed = seed;
+    env->threads = threads;
+    env->shards = calloc(threads, sizeof(EnvShard));
+    for (int t = 0; t < threads; t++) {
+        EnvShard* shard = &env->shards[t];
+        size_t first = t * shardCount;
+        size_t lanes =
+            count - first < shardCount ? count - first : shardCount;
+        GameBatchFields fields = {
+            .ballX = Env_array(shared, float, ballX) + first,
+            .ballY = Env_array(shared, float, ballY) + first,
+            .velX = Env_array(shared, float, velX) + first,
+            .velY = Env_array(shared, float, velY) + first,
+            .p0y = Env_array(shared, float, p0y) + first,
+            .p1y = Env_array(shared, float, p1y) + first,
+            .score0 = Env_array(shared, uint32_t, score0) + first,
+            .score1 = Env_array(shared, uint32_t, score1) + first,
+        };
+        shard->env = env;
+        shard->first = first;
+        // match ids are unique across shards
+        shard->batch = GameBatch_initIn(lanes, mode, seed, first, fields);
+        shard->nextMatch = count + t;
+        shard->margin = calloc(shardCount, sizeof(int32_t));
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&env->shards[t].thread, NULL, EnvShard_run,
+            &env->shards[t]);
+    }
+    return env;
+}
+
+EnvShared* Env_shared(Env* env) {
+    return env->shared;
+}
+
+void Env_serve(Env* env) {
+    EnvShared* shared = env->shared;
+    while (!atomic_load(&shared->closed)) {
+        futexWait(&shared->closed, 0);
+    }
+}
+
+// Workers see closed on their next request, Env_serve right away
+void Env_stop(EnvShared* shared) {
+    atomic_store(&shared->closed, 1);
+    futexWake(&shared->closed);
+    Env_publish(&shared->request, &shared->requestSleepers,
+        atomic_load(&shared->request) + 1);
+}
+
+void Env_del(Env* env) {
+    EnvShared* shared = env->shared;
+    Env_stop(shared);
+    for (int t = 0; t < env->threads; t++) {
+        pthread_join(env->shards[t].thread, NULL);
+        GameBatch_del(&env->shards[t].batch);
+        free(env->shards[t].margin);
+    }
+    free(env->shards);
+    munmap(shared, shared->size);
+    shm_unlink(env->name);
+    free(env);
+}
+
+EnvShared* Env_open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        perror(name);
+        return NULL;
+    }
+    EnvShared header;
+    EnvShared* shared = MAP_FAILED;
+    if (read(fd, &header, sizeof(header)) == sizeof(header) &&
+        memcmp(header.magic, ENV_MAGIC, sizeof(header.magic)) == 0)
+    {
+        shared = mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    } else {
+        fprintf(stderr, "%s isn't a pong environment\n", name);
+    }
+    close(fd);
+    return shared == MAP_FAILED ? NULL : shared;
+}
+
+void Env_step(EnvShared* shared) {
+    uint32_t request = atomic_load(&shared->request) + 1;
+    Env_publish(&shared->request, &shared->requestSleepers, request);
+    uint32_t response = request - 1;
+    while (response != request) {
+        response =
+            Env_wait(&shared->response, &shared->responseSleepers, response);
+    }
+}
+
+void Env_close(EnvShared* shared, bool stop) {
+    if (stop) {
+        Env_stop(shared);
+    }
+    munmap(shared, shared->size);
+}
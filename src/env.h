@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sim.h"
+
+// Batched matches as a training environment, shared with the trainer
+// The server maps a POSIX shared memory object holding an EnvShared header
+// followed by one array per field, and steps GameBatch shards on its
+// worker threads straight into them. A step is a futex handshake: the
+// trainer writes actions and bumps request, every worker steps its shard
+// and the last one to finish sets response to match. Both sides spin a
+// little before sleeping, so back to back steps make no syscalls at all.
+//
+// Layout, for trainers not written in C. Offsets are bytes from the start
+// of the mapping, arrays have capacity entries and count of them are used.
+//   actions  GameInput, int8 pairs: the left paddle's dy then the right's,
+//            -1 up, 1 down. Only the right one is read in ONE_PLAYER.
+//   ballX, ballY, velX, velY, p0y, p1y  float, in field units
+//   score0, score1  uint32
+//   reward   float, +1 when the right paddle scored this step, -1 when the
+//            left did, negate it for the left paddle
+//   done     uint8, 1 when the match ended this step. It has already been
+//            reset, so the observation is the first of the next match.
+
+#define ENV_MAGIC "PONGENV1"
+#define ENV_SPIN 4096 // polls before sleeping on the futex
+
+typedef struct {
+    char magic[8];
+    uint32_t count; // matches
+    uint32_t capacity; // entries of every array
+    uint32_t mode; // ONE_PLAYER or TWO_PLAYERS
+    uint32_t threads;
+    uint64_t size; // of the whole mapping
+
+    uint64_t actions;
+    uint64_t ballX;
+    uint64_t ballY;
+    uint64_t velX;
+    uint64_t velY;
+    uint64_t p0y;
+    uint64_t p1y;
+    uint64_t score0;
+    uint64_t score1;
+    uint64_t reward;
+    uint64_t done;
+
+    _Alignas(64) _Atomic uint32_t request; // steps the trainer asked for
+    _Atomic uint32_t requestSleepers;
+    _Alignas(64) _Atomic uint32_t response; // steps the server finished
+    _Atomic uint32_t responseSleepers;
+    _Alignas(64) _Atomic uint32_t pending; // shards still stepping
+    _Atomic uint32_t closed; // set to stop the server, a futex too
+} EnvShared;
+
+#define Env_array(shared, type, field) \
+    ((type*)((char*)(shared) + (shared)->field))
+
+// Server side, owns the mapping and the worker threads
+typedef struct Env Env;
+
+// Creates the shared memory object name, "/pong-env" style, and starts
+// threads workers, one per online cpu if <= 0
+Env* Env_create(
+    const char* name, size_t count, enum Mode mode, int threads,
+    uint64_t seed);
+EnvShared* Env_shared(Env* env);
+// Blocks until a trainer closes the server
+void Env_serve(Env* env);
+// Stops the workers and removes the shared memory object
+void Env_del(Env* env);
+
+// Trainer side
+EnvShared* Env_open(const char* name);
+// Steps every match once with the actions written so far
+void Env_step(EnvShared* shared);
+// Unmaps, and stops the server too when stop is set
+void Env_close(EnvShared* shared, bool stop);
+// Makes Env_serve return, from either side, async signal safe
+void Env_stop(EnvShared* shared);
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "env.h"
+#include "timing.h"
+
+// Trains nothing, but drives an env_server like a trainer would
+// Forks a server, maps its shared memory and steps it with the right paddle
+// following the ball, the actions computed from the shared observations.
+// Match 0 is replayed with Game_step next to it to check the observations
+// are the exact physics, and every reward and done flag is checked.
+//
+// usage: env_bench [options]
+//   --matches N        matches stepped together (4096)
+//   --threads N        server worker threads, 0 for one per cpu (0)
+//   --steps N          steps to time (2000)
+//   --name NAME        shared memory object (/pong-env-bench)
+
+#define ENV_BENCH_SEED 1
+
+bool sameFloat(float a, float b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Child process, tells the parent through ready once the memory is mapped
+int serve(const char* name, size_t matches, int threads, int ready) {
+    Env* env = Env_create(name, matches, ONE_PLAYER, threads, ENV_BENCH_SEED);
+    char ok = env != NULL;
+    if (write(ready, &ok, 1) != 1 || !env) {
+        return 1;
+    }
+    close(ready);
+    Env_serve(env);
+    Env_del(env);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    size_t matches = 4096;
+    int threads = 0;
+    size_t steps = 2000;
+    const char* name = "/pong-env-bench";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--matches") == 0) {
+            matches = strtoull(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--steps") == 0) {
+            steps = strtoull(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--name") == 0) {
+            name = argv[i + 1];
+        }
+    }
+
+    int pipes[2];
+    if (pipe(pipes) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    pid_t server = fork();
+    if (server == 0) {
+        close(pipes[0]);
+        return serve(name, matches, threads, pipes[1]);
+    }
+    close(pipes[1]);
+    char ok = 0;
+    if (read(pipes[0], &ok, 1) != 1 || !ok) {
+        waitpid(server, NULL, 0);
+        return 1;
+    }
+    close(pipes[0]);
+    EnvShared* shared = Env_open(name);
+    if (!shared) {
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+        return 1;
+    }
+
+    GameInput* actions = Env_array(shared, GameInput, actions);
+    const float* ballY = Env_array(shared, float, ballY);
+    const float* ballX = Env_array(shared, float, ballX);
+    const float* p1y = Env_array(shared, float, p1y);
+    const uint32_t* score0 = Env_array(shared, uint32_t, score0);
+    const uint32_t* score1 = Env_array(shared, uint32_t, score1);
+    const float* reward = Env_array(shared, float, reward);
+    const uint8_t* done = Env_array(shared, uint8_t, done);
+
+    Game reference = Game_initMatch(ONE_PLAYER, ENV_BENCH_SEED, 0);
+    bool checking = true; // until match 0 ends
+    bool valid = true;
+    size_t episodes = 0;
+    double rewards = 0;
+    double elapsed = 0;
+    for (size_t t = 0; t < steps && valid; t++) {
+        double start = now();
+        for (size_t i = 0; i < matches; i++) {
+            float dy = ballY[i] - p1y[i];
+            actions[i].dy[1] = dy < -pdy ? -1 : dy > pdy ? 1 : 0;
+        }
+        GameInput action = actions[0];
+        Env_step(shared);
+        elapsed += now() - start;
+
+        for (size_t i = 0; i < matches; i++) {
+            rewards += reward[i];
+            episodes += done[i];
+            if (fabsf(reward[i]) > 1 ||
+                (done[i] && (score0[i] || score1[i])))
+            {
+                printf("step %zu, match %zu: reward %g, done %u, "
+                    "score %u:%u\n", t, i, reward[i], done[i],
+                    score0[i], score1[i]);
+                valid = false;
+                break;
+            }
+        }
+        if (checking) {
+            Game_step(&reference, action, NULL);
+            if (reference.ended) {
+                checking = false;
+                valid = valid && done[0];
+            } else if (!sameFloat(ballX[0], reference.ball.pos.x) ||
+                !sameFloat(ballY[0], reference.ball.pos.y) ||
+                !sameFloat(p1y[0], reference.players[1].y))
+            {
+                printf("step %zu: match 0 differs from Game_step\n", t);
+                valid = false;
+            }
+        }
+    }
+
+    printf("matches       %zu on %u server threads\n",
+        matches, shared->threads);
+    printf("steps         %zu in %.3f s, %.1f us each\n",
+        steps, elapsed, elapsed / steps * 1e6);
+    printf("env-steps/s   %.0f\n", matches * steps / elapsed);
+    printf("episodes      %zu, total reward %.0f\n", episodes, rewards);
+    if (valid) {
+        printf("check         rewards and done flags consistent, match 0 "
+            "%s Game_step\n", checking ? "so far matches" : "matched");
+    }
+
+    Env_close(shared, true);
+    waitpid(server, NULL, 0);
+    return valid ? 0 : 1;
+}
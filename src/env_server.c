@@ -0,0 +1,71 @@
+#define _POSIX_C_SOURCE 199309L
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include "env.h"
+
+// Serves batched matches to a trainer through shared memory, see env.h
+//
+// usage: env_server [options]
+//   --name NAME        shared memory object (/pong-env)
+//   --matches N        matches stepped together (4096)
+//   --threads N        worker threads, 0 for one per cpu (0)
+//   --mode one|two     the agent plays the right paddle against the cpu,
+//                      or both paddles (one)
+//   --seed S           seed, match m uses rng stream m (1)
+// Runs until the trainer closes it or on SIGINT and SIGTERM.
+
+static EnvShared* served = NULL;
+
+static void stop(int signal) {
+    (void)signal;
+    Env_stop(served);
+}
+
+int main(int argc, char** argv) {
+    const char* name = "/pong-env";
+    size_t matches = 4096;
+    int threads = 0;
+    enum Mode mode = ONE_PLAYER;
+    uint64_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* val = argv[i + 1];
+        bool ok = true;
+        if (strcmp(opt, "--name") == 0) {
+            name = val;
+        } else if (strcmp(opt, "--matches") == 0) {
+            matches = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--threads") == 0) {
+            threads = atoi(val);
+        } else if (strcmp(opt, "--mode") == 0) {
+            mode = strcmp(val, "two") == 0 ? TWO_PLAYERS : ONE_PLAYER;
+            ok = mode == TWO_PLAYERS || strcmp(val, "one") == 0;
+        } else if (strcmp(opt, "--seed") == 0) {
+            seed = strtoull(val, NULL, 0);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "bad option %s %s\n", opt, val);
+            return 1;
+        }
+    }
+
+    Env* env = Env_create(name, matches, mode, threads, seed);
+    if (!env) {
+        return 1;
+    }
+    EnvShared* shared = Env_shared(env);
+    printf("serving %u matches on %s with %u threads, %llu bytes\n",
+        shared->count, name, shared->threads,
+        (unsigned long long)shared->size);
+    fflush(stdout);
+    served = shared;
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    Env_serve(env);
+    printf("served %u steps\n", atomic_load(&shared->response));
+    Env_del(env);
+    return 0;
+}
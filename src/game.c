@@ -1,282 +1,212 @@
 #include "game.h"
 #include <raylib.h>
 #include <raymath.h>
-#include <stdio.h>
+#include "sfx.h"
+#include "prof.h"
 
-const float p0x = 0.1;
-const float p1x = 0.9;
-const float pdy = 0.015;
-const float boardHalfWidth = 0.01;
-const float boardHeight = 0.15;
-const float ballWidth = boardHalfWidth * 2;
-const float ballSpeedSlow = 0.007;
-const float ballSpeedNormal = ballSpeedSlow * 2;
+static const AudioClip* hitSound = NULL;
+static ReplayWriter* recorder = NULL;
+static SpectatePublisher* broadcaster = NULL;
+static bool injecting = false;
+static GameInput injected;
+static double injectedFrom;
 
-// CPU difficulty
-const float cpuChaseOffset = boardHeight / 4;
-const float cpuSlowMovingDistance = 0.8;
-const float cpuSlowMovingFactor = 0.5;
+void Game_playEvents(GameEvents* events);
 
-static float hitsoundPitchMultiplier = 1.f;
-
-void Player_update(Player* player, int pn);
-void Cpu_update(Cpu* player, Ball* ball);
-void Player_render(Player* players[2], int w, int h);
-
-void Ball_update(Ball* ball, Player* players[2], bool* firstHit);
-void Ball_render(Ball* ball, int w, int h);
-
-// net and scores and additional stuff if have
-void renderNet(int w, int h);
-void renderScores(Player* players[2], int w, int h);
-
-#define max(a, b) ((a) > (b) ? (a) : (b))
-#define min(a, b) ((a) < (b) ? (a) : (b))
-#define isInRangeInclusive(x, l, u) ((x) >= (l) && (x) <= (u))
-#define isRangeOverlap(x1, x2, y1, y2) ((x1) <= (y2) && (y1) <= (x2))
-
-Game Game_init(enum Mode players_n) {
-    Game game;
-    game.init = true;
-    game.firstHit = false;
-    game.ended = false;
-    game.ball = (Ball) {
-        .pos = { .x = 0.5, .y = 0.5 },
-        .vel = { .x = ballSpeedSlow, .y = 0 },
-        .hitsound = LoadSound("assets/hitsound.mp3"),
-    };
-    if (players_n == ONE_PLAYER) {
-        game.players[0] = malloc(sizeof(Cpu));
-        *(Cpu*)game.players[0] = (Cpu){
-            .player = (Player) {
-                .isCpu = true,
-                .score = 0,
-                .y = 0.5,
-            },
-            .chanceOffset = NAN,
-        };
-    } else {
-        game.players[0] = malloc(sizeof(Player));
-        *game.players[0] = (Player) {
-            .isCpu = false,
-            .score = 0,
-            .y = 0.5,
-        };
+void Game_loadAssets(void) {
+    if (!hitSound) {
+        hitSound = Sfx_acquire("assets/hitsound.mp3");
     }
-    game.players[1] = malloc(sizeof(Player));
-    *game.players[1] = (Player) {
-        .isCpu = false,
-        .score = 0,
-        .y = 0.5,
-    };
-    return game;
 }
 
-void Game_del(Game* game) {
-    if (!game->init) {
-        return;
-    }
-    game->init = false;
-    UnloadSound(game->ball.hitsound);
-    free(game->players[0]);
-    free(game->players[1]);
+void Game_unloadAssets(void) {
+    Sfx_release(hitSound);
+    hitSound = NULL;
 }
 
-void Game_update(Game* game) {
-    if (game->players[0]->isCpu) {
-        Cpu_update((Cpu*)game->players[0], &game->ball);
-    } else {
-        Player_update(game->players[0], 0);
-    }
-    Player_update(game->players[1], 1);
-    Ball_update(&game->ball, game->players, &game->firstHit);
-
-    if (game->players[0]->score == 11 || game->players[1]->score == 11) {
-        game->ended = true;
-    }
+GameClock GameClock_init(double tickRate, int maxTicksPerFrame) {
+    return (GameClock) {
+        .tickRate = tickRate,
+        .maxTicksPerFrame = maxTicksPerFrame,
+        .accumulator = 0,
+    };
 }
 
-void Game_render(Game* state, GameRenderComponents components, int w, int h) {
-    components.net ? renderNet(w, h) : 0;
-    components.scores ? renderScores(state->players, w, h) : 0;
-    components.ball ? Ball_render(&state->ball, w, h) : 0;
-    components.boards ? Player_render(state->players, w, h) : 0;
+void GameClock_reset(GameClock* clock, Game* game) {
+    clock->accumulator = 0;
+    clock->prev = Game_view(game);
 }
 
-void Cpu_update(Cpu* cpu, Ball* ball) {
-    if (isnan(cpu->chanceOffset)) {
-        float fac = 100000.f;
-        cpu->chanceOffset = GetRandomValue(0, cpuChaseOffset * fac) / fac;
-    }
-
-    int ballDir = Vector2Angle(Vector2Zero(), ball->vel) > 0 ? 1 : -1;
-    float movingFac = ball->pos.x > cpuSlowMovingDistance ?
-        cpuSlowMovingFactor : 1;
-    float ballGuessY = ball->pos.y + cpu->chanceOffset * ballDir;
-    float dy = cpu->player.y < ballGuessY ?
-        min(pdy * movingFac, (ballGuessY - cpu->player.y) * movingFac) :
-        cpu->player.y > ballGuessY ?
-            -min(pdy * movingFac, (cpu->player.y - ballGuessY) * movingFac) :
-            0;
-    cpu->player.y += dy;
-    cpu->player.y = Clamp(cpu->player.y, boardHeight / 2, 1 - boardHeight / 2);
+void Game_record(ReplayWriter* writer) {
+    recorder = writer;
 }
 
-void Player_update(Player* player, int pn) {
-    #define isUpKeyDown(pn) IsKeyDown((pn) ? KEY_UP : KEY_W)
-    #define isDownKeyDown(pn) IsKeyDown((pn) ? KEY_DOWN : KEY_S)
-
-    if (isUpKeyDown(pn)) {
-        player->y -= pdy;
-    } else if (isDownKeyDown(pn)) {
-        player->y += pdy;
-    }
-    player->y = Clamp(player->y, boardHeight / 2, 1 - boardHeight / 2);
-
-    #undef isUpKeyDown
-    #undef isDownKeyDown
+void Game_broadcast(SpectatePublisher* publisher) {
+    broadcaster = publisher;
 }
 
-void Player_render(Player* player[2], int w, int h) {
-    // center
-    int player0x = p0x * w;
-    int player0y = player[0]->y * h;
-    int player1x = p1x * w;
-    int player1y = player[1]->y * h;
+int Game_advance(
+    Game* game, GameClock* clock, double frameTime,
+    const InputTimeline* inputs, double now)
+{
+    double tickTime = 1 / clock->tickRate;
+    clock->accumulator += frameTime;
+    double due = clock->accumulator;
 
-    int boardW = boardHalfWidth * 2 * w;
-    int boardH = boardHeight * h;
+    int ticks = 0;
+    GameInput input = inputs ? GAME_INPUT_IDLE : Game_sampleInput();
+    while (clock->accumulator >= tickTime && !game->ended) {
+        if (ticks == clock->maxTicksPerFrame) {
+            // too far behind, slow down instead of spiraling
+            clock->accumulator = 0;
+            break;
+        }
+        clock->prev = Game_view(game);
+        if (inputs) {
+            input = InputTimeline_forTick(inputs, now, due, tickTime, ticks);
+        }
 
-    DrawRectangle(
-        player0x - boardW / 2, player0y - boardH / 2, boardW, boardH, WHITE);
-    DrawRectangle(
-        player1x - boardW / 2, player1y - boardH / 2, boardW, boardH, WHITE);
-}
+        if (recorder) {
+            ReplayWriter_tick(recorder, game, input);
+        }
+        GameEvents events;
+        Game_step(game, input, &events);
+        if (broadcaster) {
+            SpectatePublisher_tick(broadcaster, game, GetTime());
+        }
+        Game_playEvents(&events);
+        for (int i = 0; i < events.count; i++) {
+            if (events.events[i].type == GAMEEVENT_SCORE) {
+                // ball is served again, don't blend it across the field
+                clock->prev.ball = game->ball.pos;
+            }
+        }
 
-void Ball_resetVel(Ball* ball) {
-    float angle = GetRandomValue(110, 135) / 180.f * 2 - 1;
-    Vector2 v = { .x = 1, .y = angle };
-    ball->vel = Vector2Scale(v, ballSpeedSlow);
-}
+        clock->accumulator -= tickTime;
+        ticks++;
+    }
+    return ticks;
+}
+
+int Game_advanceNet(
+    Game* game, GameClock* clock, double frameTime, NetSession* session,
+    double now)
+{
+    double tickTime = 1 / clock->tickRate;
+    clock->accumulator += frameTime;
+
+    NetSession_poll(session, now);
+    profile(PROF_ROLLBACK, {
+        Rollback_correct(&session->rollback, game);
+    });
+
+    int ticks = 0;
+    GameInput keys = Game_sampleInput();
+    int8_t dy = keys.dy[0] ? keys.dy[0] : keys.dy[1];
+    while (clock->accumulator >= tickTime && !game->ended) {
+        if (ticks == clock->maxTicksPerFrame) {
+            clock->accumulator = 0;
+            break;
+        }
+        if (!NetSession_canStep(session)) {
+            // owe at most one tick, the peer will catch up
+            clock->accumulator = tickTime;
+            break;
+        }
+        clock->prev = Game_view(game);
+
+        GameEvents events;
+        Rollback_step(&session->rollback, game, dy, &events);
+        Game_playEvents(&events);
+        for (int i = 0; i < events.count; i++) {
+            if (events.events[i].type == GAMEEVENT_SCORE) {
+                clock->prev.ball = game->ball.pos;
+            }
+        }
 
-void Ball_checkOutOfBounce(Ball* ball, Player* players[2]) {
-    if (ball->pos.x > 1) {
-        players[0]->score++;
-        ball->pos = (Vector2){ .x = 0.5, .y = GetRandomValue(4, 6) / 10.f };
-        Ball_resetVel(ball);
-    } else if (ball->pos.x < 0) {
-        players[1]->score++;
-        ball->pos = (Vector2){ .x = 0.5, .y = GetRandomValue(4, 6) / 10.f };
-        Ball_resetVel(ball);
-        ball->vel.x = -ball->vel.x;
+        clock->accumulator -= tickTime;
+        ticks++;
     }
+    NetSession_send(session, now);
+    return ticks;
 }
 
-void Ball_checkCollisionWithBoard(Ball* ball, Player* players[2], bool* firstHit) {
-    #define xCollideWithP0(bx) \
-        isRangeOverlap( \
-            bx - ballWidth / 2, bx + ballWidth / 2, \
-            p0x - boardHalfWidth / 2, p0x + boardHalfWidth)
-    #define yCollideWithP0(by) \
-        isRangeOverlap( \
-            by - ballWidth / 2, by + ballWidth / 2, \
-            players[0]->y - boardHeight / 2, players[0]->y + boardHeight / 2)
-    #define collideWithP0(ball) \
-        ball->vel.x < 0 && \
-        xCollideWithP0(ball->pos.x) && yCollideWithP0(ball->pos.y)
+int Game_advanceSwarm(Swarm* swarm, GameClock* clock, double frameTime) {
+    double tickTime = 1 / GAME_TICK_RATE;
+    clock->accumulator += frameTime;
 
-    #define xCollideWithP1(bx) \
-        isRangeOverlap( \
-            bx - ballWidth / 2, bx + ballWidth / 2, \
-            p1x - boardHalfWidth, p1x + boardHalfWidth / 2)
-    #define yCollideWithP1(by) \
-        isRangeOverlap( \
-            by - ballWidth / 2, by + ballWidth / 2, \
-            players[1]->y - boardHeight / 2, players[1]->y + boardHeight / 2)
-    #define collideWithP1(ball) \
-        ball->vel.x > 0 && \
-        xCollideWithP1(ball->pos.x) && yCollideWithP1(ball->pos.y)
-
-    if (collideWithP0(ball)) {
-        float dis = (ball->pos.y - players[0]->y) / (boardHeight);
-        Vector2 v = { .x = 1, .y = dis * 4 };
-        ball->vel = Vector2Scale(v, ballSpeedNormal);
-        if (players[0]->isCpu) {
-            ((Cpu*)players[0])->chanceOffset = NAN;
+    int ticks = 0;
+    GameInput keys = Game_sampleInput();
+    GameInput input = { .dy = { 0, keys.dy[1] ? keys.dy[1] : keys.dy[0] } };
+    while (clock->accumulator >= tickTime) {
+        if (ticks == clock->maxTicksPerFrame) {
+            clock->accumulator = 0;
+            break;
         }
-
-        float diff = Vector2Length(ball->vel) - ballSpeedNormal;
-        hitsoundPitchMultiplier = exp(diff * 150);
-        PlaySound(ball->hitsound);
-    } else if (collideWithP1(ball)) {
-        float dis = (ball->pos.y - players[1]->y) / (boardHeight);
-        Vector2 v = { .x = -1, .y = dis * 4 };
-        ball->vel = Vector2Scale(v, ballSpeedNormal);
-
-        float diff = Vector2Length(ball->vel) - ballSpeedNormal;
-        hitsoundPitchMultiplier = exp(diff * 150);
-        PlaySound(ball->hitsound);
+        Swarm_step(swarm, input);
+        clock->accumulator -= tickTime;
+        ticks++;
     }
+    return ticks;
+}
 
-    if (!IsSoundPlaying(ball->hitsound)) {
-        hitsoundPitchMultiplier = 1.f;
+void Game_injectInput(const GameInput* input, double from) {
+    injecting = input != NULL;
+    if (input) {
+        injected = *input;
+        injectedFrom = from;
     }
-
-    #undef xCollideWithP0
-    #undef yCollideWithP0
-    #undef collideWithP0
-    #undef xCollideWithP1
-    #undef yCollideWithP1
-    #undef collideWithP1
 }
 
-void Ball_checkCollisionWithWall(Ball* ball) {
-    Vector2 future = Vector2Add(ball->pos, ball->vel);
-    if (!isInRangeInclusive(future.y, 0, 1)) {
-        ball->vel.y = -ball->vel.y;
+GameInput Game_sampleInput(void) {
+    if (injecting && GetTime() >= injectedFrom) {
+        return injected;
     }
-}
 
-void Ball_update(Ball* ball, Player* players[2], bool* firstHit) {
-    Ball_checkOutOfBounce(ball, players);
-    Ball_checkCollisionWithBoard(ball, players, firstHit);
-    Ball_checkCollisionWithWall(ball);
-    ball->pos = Vector2Add(ball->pos, ball->vel);
-}
+    #define keyDy(up, down) (IsKeyDown(up) ? -1 : IsKeyDown(down) ? 1 : 0)
 
-void Ball_render(Ball* ball, int w, int h) {
-    int x = ball->pos.x * w;
-    int y = ball->pos.y * h;
-    int width = ballWidth * w;
-    DrawRectangle(x - width / 2, y - width / 2, width, width, WHITE);
+    return (GameInput) {
+        .dy = {
+            keyDy(KEY_W, KEY_S),
+            keyDy(KEY_UP, KEY_DOWN),
+        },
+    };
+
+    #undef keyDy
 }
 
-void renderNet(int w, int h) {
-    for (float y = 0; y < h; y += (ballWidth * 2) * w) {
-        float x = (0.5 - ballWidth / 2) * w;
-        int width = ballWidth * w;
-        DrawRectangle(x, y, width, width, WHITE);
+void Game_playEvents(GameEvents* events) {
+    for (int i = 0; i < events->count; i++) {
+        GameEvent* event = &events->events[i];
+        if (event->type == GAMEEVENT_HIT) {
+            // steeper hits are faster and sound higher
+            float pitch = event->ballSpeed / ballSpeedNormal;
+            pitch = pitch < 0.5 ? 0.5 : pitch > 2 ? 2 : pitch;
+            Sfx_play(hitSound, pitch, 1);
+        }
     }
 }
 
-void renderScores(Player* players[2], int w, int h) {
-    float fontSize = 0.13 * h;
-    {
-        char text[20];
-        sprintf(text, "%zu", players[0]->score);
-        int textwidth = MeasureText(text, fontSize);
-        DrawText(text, (0.5 - 0.1) * w - textwidth, 0.1 * h, fontSize, WHITE);
-    }
-    {
-        char text[20];
-        sprintf(text, "%zu", players[1]->score);
-        DrawText(text, (0.5 + 0.1) * w, 0.1 * h, fontSize, WHITE);
+GameView Game_interpolate(const Game* state, const GameClock* clock) {
+    GameView view = Game_view(state);
+    if (clock) {
+        // fraction of the next tick that has already elapsed
+        float alpha = clock->accumulator * clock->tickRate;
+        alpha = alpha < 0 ? 0 : alpha > 1 ? 1 : alpha;
+        #define lerp(a, b) ((a) + ((b) - (a)) * alpha)
+        view.ball.x = lerp(clock->prev.ball.x, view.ball.x);
+        view.ball.y = lerp(clock->prev.ball.y, view.ball.y);
+        view.paddles[0] = lerp(clock->prev.paddles[0], view.paddles[0]);
+        view.paddles[1] = lerp(clock->prev.paddles[1], view.paddles[1]);
+        #undef lerp
     }
+    return view;
 }
 
-void processHitSound(void* buffer, unsigned int frames) {
-    float* samples = buffer;
-    for (unsigned int f = 0; f < frames; f++) {
-        samples[f] = samples[f] * hitsoundPitchMultiplier;
-    }
+void Game_render(
+    DrawList* list, Game* state, GameClock* clock,
+    GameRenderComponents components, int w, int h)
+{
+    GameView view = Game_interpolate(state, clock);
+    Game_draw(list, state, view, components, w, h);
 }
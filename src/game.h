@@ -2,56 +2,64 @@
 
 #include <stdlib.h>
 #include <raylib.h>
+#include "sim.h"
+#include "render.h"
+#include "replay.h"
+#include "net.h"
+#include "pacer.h"
+#include "spectate.h"
 
-// Coordinates 0 to 1
-// Scale with screen size
+// Simulation constants are tuned per tick at this rate
+#define GAME_TICK_RATE 60.0
+#define GAME_MAX_TICKS_PER_FRAME 8
 
+// Fixed timestep, decouples simulation ticks from rendered frames
 typedef struct {
-    bool isCpu;
-    size_t score;
-    float y;
-} Player;
+    double tickRate;
+    int maxTicksPerFrame; // time beyond this is dropped instead of caught up
+    double accumulator; // seconds not simulated yet
+    GameView prev; // state before the last tick
+} GameClock;
 
-typedef struct {
-    Player player;
-    float chanceOffset;
-} Cpu;
+GameClock GameClock_init(double tickRate, int maxTicksPerFrame);
+void GameClock_reset(GameClock* clock, Game* game); // call on a new match
 
-typedef struct {
-    Vector2 pos;
-    Vector2 vel;
-    Sound hitsound;
-} Ball;
+// Between Sfx_open and Sfx_close, the sounds are shared through the cache
+void Game_loadAssets(void);
+void Game_unloadAssets(void);
 
-typedef struct {
-    bool init;
-    bool firstHit;
-    bool ended;
-    Ball ball;
-    Player* players[2];
-} Game;
+// Every tick Game_advance runs is recorded while set
+// NULL stops recording
+void Game_record(ReplayWriter* writer);
+// Same for broadcasting them to spectators, NULL stops
+void Game_broadcast(SpectatePublisher* publisher);
 
-typedef struct {
-    bool boards;
-    bool scores;
-    bool ball;
-    bool net;
-} GameRenderComponents;
-
-static const GameRenderComponents GAME_RENDER_ALL = {
-    .boards = true,
-    .scores = true, 
-    .ball = true,
-    .net = true,
-};
-
-enum Mode : bool {
-    ONE_PLAYER,
-    TWO_PLAYERS
-};
-
-Game Game_init(enum Mode players_n);
-void Game_del(Game* game); // Doesn't free the game pointer
-void Game_update(Game* game);
-void Game_render(Game* state, GameRenderComponents components, int w, int h);
-void processHitSound(void* buffer, unsigned int frames);
+// W/S for the left paddle, the arrows for the right
+GameInput Game_sampleInput(void);
+// Game_sampleInput returns input instead of the keyboard once GetTime()
+// reaches from, for timing a press that nobody makes. NULL stops it.
+void Game_injectInput(const GameInput* input, double from);
+
+// Runs the ticks due after frameTime seconds, returns how many ran
+// Every tick uses the keyboard as it is now, or with inputs the input
+// polled for its time, now being when the frame sampled it last
+int Game_advance(
+    Game* game, GameClock* clock, double frameTime,
+    const InputTimeline* inputs, double now);
+// Same with the other paddle played over session, the keyboard moves the
+// local one. Redoes mispredicted ticks first and holds back while the peer
+// is too far behind. now is GetTime().
+int Game_advanceNet(
+    Game* game, GameClock* clock, double frameTime, NetSession* session,
+    double now);
+// Arena mode, the right paddle is played with W/S or the arrows. Steps
+// the ticks due like Game_advance, drawn without interpolation. The arena
+// only steps whole ticks, so it always runs at GAME_TICK_RATE.
+int Game_advanceSwarm(Swarm* swarm, GameClock* clock, double frameTime);
+// What Game_render draws, interpolated between the last two ticks
+GameView Game_interpolate(const Game* state, const GameClock* clock);
+// Records the frame into list
+// clock can be NULL to draw the current tick without interpolation
+void Game_render(
+    DrawList* list, Game* state, GameClock* clock,
+    GameRenderComponents components, int w, int h);
@@ -0,0 +1,77 @@
+#define _POSIX_C_SOURCE 199309L
+#include "latency.h"
+#include <raylib.h>
+#include <stdlib.h>
+#include "ui.h"
+#include "timing.h"
+
+LatencyTest LatencyTest_new(int presses, uint64_t seed) {
+    return (LatencyTest) {
+        .presses = presses,
+        .count = 0,
+        .latencies = presses > 0 ? malloc(presses * sizeof(double)) : NULL,
+        .pressAt = 0,
+        .nextPress = 0,
+        .rng = Rng_init(seed, 0),
+    };
+}
+
+// A new match moves the paddles, the press in flight doesn't count
+static void LatencyTest_cancel(LatencyTest* test, double now) {
+    test->pressAt = 0;
+    test->nextPress = now + 0.1;
+    Game_injectInput(&GAME_INPUT_IDLE, 0);
+}
+
+bool LatencyTest_frame(
+    LatencyTest* test, Game* game, GameClock* clock, double presented,
+    double period)
+{
+    float drawnY = Game_interpolate(game, clock).paddles[1];
+    double random = Rng_next(&test->rng) / 4294967296.0;
+    if (test->pressAt) {
+        if (drawnY != test->restY) {
+            test->latencies[test->count++] = presented - test->pressAt;
+            test->pressAt = 0;
+            Game_injectInput(&GAME_INPUT_IDLE, 0);
+            // let the paddle stop before the next one
+            test->nextPress = presented + 0.1 + 0.2 * random;
+        }
+    } else if (presented >= test->nextPress) {
+        // anywhere in the next frame, away from the nearest wall
+        test->restY = drawnY;
+        test->pressAt = presented + (period > 0 ? period : 1 / 60.0) * random;
+        GameInput press = { .dy = { 0, drawnY < 0.5 ? 1 : -1 } };
+        Game_injectInput(&press, test->pressAt);
+    }
+    if (test->count == test->presses) {
+        return true;
+    }
+    if (game->ended) {
+        Game_del(game);
+        *game = Game_init(ONE_PLAYER, newGameSeed());
+        GameClock_reset(clock, game);
+        LatencyTest_cancel(test, presented);
+    }
+    return false;
+}
+
+void LatencyTest_close(LatencyTest* test, bool low) {
+    int n = test->count;
+    if (n) {
+        qsort(test->latencies, n, sizeof(double), compareDouble);
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += test->latencies[i];
+        }
+        TraceLog(LOG_INFO,
+            "LATENCY: %d presses, %s loop, input to present mean %.1f ms, "
+            "p50 %.1f, p95 %.1f, max %.1f",
+            n, low ? "low" : "normal", sum / n * 1000,
+            test->latencies[n / 2] * 1000,
+            test->latencies[n * 95 / 100] * 1000,
+            test->latencies[n - 1] * 1000);
+    }
+    free(test->latencies);
+    *test = (LatencyTest) { .presses = 0 };
+}
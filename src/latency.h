@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include "game.h"
+
+// --latency-test presses the right paddle's key at random moments and
+// times how long the paddle takes to move on screen
+
+typedef struct {
+    int presses; // to time, 0 when not testing
+    int count;
+    double* latencies;
+    double pressAt; // 0 while released
+    double nextPress; // arms the next press once reached
+    float restY; // right paddle as drawn before the press
+    Rng rng;
+} LatencyTest;
+
+LatencyTest LatencyTest_new(int presses, uint64_t seed);
+// After presenting a frame of game, returns true once every press was
+// timed. An ended match is replaced by a new one, the end screen would
+// wait for a click. period is the frame time, 0 uncapped.
+bool LatencyTest_frame(
+    LatencyTest* test, Game* game, GameClock* clock, double presented,
+    double period);
+// Logs the latencies measured and frees them, low is the loop they ran in
+void LatencyTest_close(LatencyTest* test, bool low);
@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pacer.h"
+#include "rng.h"
+#include "timing.h"
+
+// Input to present latency of the two frame loops main can run, modeled
+// A virtual clock stands in for the window: a frame costs --work ms from
+// sampling input to presenting plus up to --jitter more, and presenting
+// returns at once. A key is pressed at random moments and a real Game is
+// stepped with what each loop sampled, drawn interpolated like main does.
+// A press counts from the moment it happens until the first presented
+// frame that shows the right paddle moved.
+//   normal  raylib's loop, input is polled as the wait for the frame
+//           rate ends, then the frame is worked and presented
+//   low     main --latency low, FramePacer waits before sampling while
+//           polling into an InputTimeline, and the ticks take the input
+//           of their own time
+//
+// usage: latency_bench [options]
+//   --fps N            frame rate (60)
+//   --tick-rate HZ     simulation rate (60)
+//   --work MS          frame cost (2)
+//   --jitter MS        extra frame cost, uniform up to this (1)
+//   --presses N        presses per loop (2000)
+
+#define LATENCY_BENCH_SEED 1
+
+typedef struct {
+    double fps;
+    double tickRate;
+    double work;
+    double jitter;
+    int presses;
+} Model;
+
+// The key being tested, pressed from pressAt on
+typedef struct {
+    Rng rng;
+    double pressAt;
+    double releasedAt;
+    bool pressing;
+    int8_t dy;
+} Key;
+
+static double uniform(Rng* rng) {
+    return Rng_next(rng) / 4294967296.0;
+}
+
+static GameInput Key_at(const Key* key, double time) {
+    GameInput input = GAME_INPUT_IDLE;
+    if (key->pressing && time >= key->pressAt) {
+        input.dy[1] = key->dy;
+    }
+    return input;
+}
+
+// Runs one loop until every press was seen, fills latencies
+static void run(const Model* model, bool low, double* latencies) {
+    double period = model->fps > 0 ? 1 / model->fps : 0;
+    double tickTime = 1 / model->tickRate;
+    Game game = Game_init(ONE_PLAYER, LATENCY_BENCH_SEED);
+    float prevY = game.players[1].y;
+    double accumulator = 0;
+    Key key = { .rng = Rng_init(LATENCY_BENCH_SEED, low), .pressing = false };
+    Rng workRng = Rng_init(LATENCY_BENCH_SEED, 2 + low);
+    FramePacer pacer = FramePacer_init(model->fps, 0);
+    InputTimeline timeline = { .count = 0 };
+    float restY = 0;
+
+    double time = 0; // virtual clock
+    double lastSample = 0;
+    int count = 0;
+    while (count < model->presses) {
+        if (!key.pressing && time >= key.releasedAt) {
+            // next press somewhere in the next few frames
+            key.pressing = true;
+            key.pressAt = time + (0.1 + uniform(&key.rng)) * 4 * period;
+            key.dy = game.players[1].y < 0.5 ? 1 : -1;
+            restY = prevY + (game.players[1].y - prevY) *
+                (accumulator * model->tickRate);
+        }
+
+        double frameStart = time;
+        if (low) {
+            double wake = FramePacer_wake(&pacer);
+            while (time < wake) {
+                InputTimeline_push(&timeline, time, Key_at(&key, time));
+                time += PACER_POLL < wake - time ? PACER_POLL : wake - time;
+            }
+        }
+        InputTimeline_push(&timeline, time, Key_at(&key, time));
+        GameInput sampled = Key_at(&key, time);
+        double frameTime = time - lastSample;
+        lastSample = time;
+
+        // same as Game_advance
+        double before = accumulator + frameTime;
+        accumulator = before;
+        for (int j = 0; accumulator >= tickTime; j++) {
+            GameInput input = low ?
+                InputTimeline_forTick(&timeline, time, before, tickTime, j) :
+                sampled;
+            prevY = game.players[1].y;
+            Game_step(&game, input, NULL);
+            if (game.ended) {
+                game = Game_init(ONE_PLAYER, LATENCY_BENCH_SEED);
+                prevY = game.players[1].y;
+                key.pressing = false;
+                key.releasedAt = time;
+            }
+            accumulator -= tickTime;
+        }
+        float alpha = accumulator * model->tickRate;
+        alpha = alpha > 1 ? 1 : alpha;
+        float drawnY = prevY + (game.players[1].y - prevY) * alpha;
+
+        double sampledAt = time;
+        time += (model->work + model->jitter * uniform(&workRng)) / 1000;
+        double presented = time;
+        if (key.pressing && presented >= key.pressAt && drawnY != restY) {
+            latencies[count++] = presented - key.pressAt;
+            key.pressing = false;
+            key.releasedAt = presented + 0.1;
+        }
+
+        if (low) {
+            FramePacer_presented(&pacer, sampledAt, presented);
+        } else if (time < frameStart + period) {
+            // EndDrawing waits out the frame, then polls
+            time = frameStart + period;
+        }
+    }
+}
+
+static void report(const char* name, double* latencies, int n) {
+    qsort(latencies, n, sizeof(double), compareDouble);
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += latencies[i];
+    }
+    printf("%-8s mean %5.1f ms  p50 %5.1f  p95 %5.1f  max %5.1f\n",
+        name, sum / n * 1000, latencies[n / 2] * 1000,
+        latencies[n * 95 / 100] * 1000, latencies[n - 1] * 1000);
+}
+
+int main(int argc, char** argv) {
+    Model model = {
+        .fps = 60,
+        .tickRate = 60,
+        .work = 2,
+        .jitter = 1,
+        .presses = 2000,
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--fps") == 0) {
+            model.fps = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--tick-rate") == 0) {
+            model.tickRate = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--work") == 0) {
+            model.work = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--jitter") == 0) {
+            model.jitter = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--presses") == 0) {
+            model.presses = atoi(argv[i + 1]);
+        }
+    }
+    if (model.fps <= 0 || model.tickRate <= 0 || model.presses <= 0) {
+        fprintf(stderr, "fps, tick rate and presses must be positive\n");
+        return 1;
+    }
+
+    double* latencies = malloc(model.presses * sizeof(double));
+    printf("%.0f fps, %.0f Hz ticks, frames take %.1f to %.1f ms\n",
+        model.fps, model.tickRate, model.work, model.work + model.jitter);
+    run(&model, false, latencies);
+    report("normal", latencies, model.presses);
+    run(&model, true, latencies);
+    report("low", latencies, model.presses);
+    free(latencies);
+    return 0;
+}
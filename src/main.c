@@ -1,56 +1,559 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <raylib.h>
 #include "game.h"
+#include "latency.h"
 #include "ui.h"
+#include "sfx.h"
+#include "prof.h"
 
 #define draw(...) \
     do { \
         BeginDrawing(); \
         ClearBackground(BLACK); \
         __VA_ARGS__ \
-        EndDrawing(); \
+        profile(PROF_PRESENT, EndDrawing();); \
     } while (0)
 
-int main() {
+// Seconds of cpu used by every thread of the process
+static double cpuTime(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Seconds since some fixed point, unlike GetTime usable before InitWindow
+static double wallTime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Every sound the game plays, packed into the bundle by make
+static const char* const sounds[] = { "assets/hitsound.mp3" };
+
+static void closeNet(NetSession* net) {
+    Rollback* rollback = &net->rollback;
+    TraceLog(LOG_INFO,
+        "NET: %u ticks, %llu rollbacks redoing %llu ticks, at most %u, "
+        "%llu stalls, %llu packets sent, %llu dropped, "
+        "%llu states checked%s",
+        rollback->tick, (unsigned long long)rollback->rollbacks,
+        (unsigned long long)rollback->resimulated, rollback->maxDepth,
+        (unsigned long long)net->stalls,
+        (unsigned long long)net->link.sent,
+        (unsigned long long)net->link.dropped,
+        (unsigned long long)net->checks,
+        net->desynced ? ", DESYNCED" : "");
+    NetSession_close(net);
+}
+
+static void closeSwarm(Swarm* swarm) {
+    TraceLog(LOG_INFO,
+        "SWARM: %zu balls, %llu ticks, %llu collisions, score %u:%u",
+        swarm->count, (unsigned long long)swarm->ticks,
+        (unsigned long long)swarm->contacts,
+        swarm->scores[0], swarm->scores[1]);
+    Swarm_del(swarm);
+}
+
+static void closePublisher(SpectatePublisher* pub) {
+    TraceLog(LOG_INFO,
+        "SPECTATE: %u ticks to %zu viewers, %llu packets, %llu datagrams, "
+        "%llu bytes, %llu keyframes resent",
+        pub->tick, pub->count, (unsigned long long)pub->packets,
+        (unsigned long long)pub->sent, (unsigned long long)pub->bytes,
+        (unsigned long long)pub->resent);
+    SpectatePublisher_close(pub);
+}
+
+static void closeViewer(SpectateViewer* viewer) {
+    TraceLog(LOG_INFO,
+        "SPECTATE: %llu packets, %llu bytes, %llu undecodable",
+        (unsigned long long)viewer->packets,
+        (unsigned long long)viewer->bytes,
+        (unsigned long long)viewer->undecodable);
+    SpectateViewer_close(viewer);
+}
+
+// Sleeps until the pacer's wake time polling input into inputs, returns
+// whether F3 was pressed meanwhile, IsKeyPressed only sees the last poll
+static bool waitForFrame(FramePacer* pacer, InputTimeline* inputs) {
+    bool f3 = IsKeyPressed(KEY_F3);
+    double wake = FramePacer_wake(pacer);
+    double time;
+    while ((time = GetTime()) < wake) {
+        PollInputEvents();
+        InputTimeline_push(inputs, GetTime(), Game_sampleInput());
+        f3 = f3 || IsKeyPressed(KEY_F3);
+        WaitTime(wake - time < PACER_POLL ? wake - time : PACER_POLL);
+    }
+    PollInputEvents();
+    InputTimeline_push(inputs, GetTime(), Game_sampleInput());
+    return f3 || IsKeyPressed(KEY_F3);
+}
+
+// usage: main [--fps N] [--tick-rate HZ] [--record PREFIX]
+//             [--collision discrete|swept] [--menu-wait on|off]
+//             [--profile FILE] [--net host|HOST:PORT] [--net-port PORT]
+//             [--net-loss PCT] [--net-latency MS] [--net-jitter MS]
+//             [--swarm BALLS] [--latency normal|low] [--latency-test N]
+//             [--assets BUNDLE] [--audio-init async|sync]
+//             [--broadcast PORT] [--watch HOST:PORT]
+// --fps 0 renders uncapped, gameplay speed doesn't depend on it
+// --tick-rate other than GAME_TICK_RATE steps a fraction or a multiple of
+// a tick each time with swept collision, so the match plays at the same
+// speed, except the arena which always steps at GAME_TICK_RATE
+// --record saves every match to PREFIX-N.replay
+// --collision swept finds exact contact times, the ball never tunnels
+// --menu-wait off keeps redrawing menus every frame instead of sleeping
+// until input arrives
+// --profile times each phase of every frame, F3 shows the overlay and the
+// samples are written to FILE on exit, as Chrome trace JSON if it ends in
+// .json and CSV otherwise
+// --net host waits for a player on --net-port (default 7777) and plays the
+// left paddle, --net HOST:PORT joins one and plays the right, either with
+// W/S or the arrows. Both need the same --tick-rate and --collision.
+// --net-loss, --net-latency and --net-jitter degrade our outgoing packets
+// to try bad connections on loopback
+// --swarm skips the menus for the arena mode, the cpu against W/S or the
+// arrows with BALLS balls at once
+// --latency low waits for the frame rate before sampling input instead of
+// after presenting, polling the keyboard while it waits so every tick gets
+// the input of its time, for local matches
+// --latency-test skips the menus for a match against the cpu, presses the
+// right paddle's key N times and logs how long until the paddle moved in a
+// presented frame
+// --assets maps sounds packed by pack from BUNDLE (target/assets.pak)
+// instead of decoding them, and missing ones are still decoded
+// --audio-init sync opens the audio device before the first frame instead
+// of on a thread while the title shows, to compare the startup times
+// --broadcast sends every local match to spectators on PORT
+// --watch skips the menus and shows the matches broadcast from HOST:PORT
+int main(int argc, char** argv) {
+    double launched = wallTime();
     const int screenWidth = 600;
     const int screenHeight = 400;
+    int fps = 60;
+    double tickRate = GAME_TICK_RATE;
+    const char* recordPrefix = NULL;
+    bool swept = false;
+    bool menuWait = true;
+    const char* profilePath = NULL;
+    const char* netPeer = NULL; // "host" to host
+    int netPort = -1;
+    NetShim shim = { .loss = 0, .latency = 0, .jitter = 0 };
+    size_t swarmBalls = 0;
+    bool lowLatency = false;
+    int latencyPresses = 0;
+    const char* assetsPath = "target/assets.pak";
+    bool audioAsync = true;
+    int broadcastPort = -1;
+    const char* watchPublisher = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--fps") == 0) {
+            fps = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--tick-rate") == 0) {
+            tickRate = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--record") == 0) {
+            recordPrefix = argv[i + 1];
+        } else if (strcmp(argv[i], "--collision") == 0) {
+            swept = strcmp(argv[i + 1], "swept") == 0;
+        } else if (strcmp(argv[i], "--menu-wait") == 0) {
+            menuWait = strcmp(argv[i + 1], "off") != 0;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profilePath = argv[i + 1];
+        } else if (strcmp(argv[i], "--net") == 0) {
+            netPeer = argv[i + 1];
+        } else if (strcmp(argv[i], "--net-port") == 0) {
+            netPort = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--net-loss") == 0) {
+            shim.loss = atof(argv[i + 1]) / 100;
+        } else if (strcmp(argv[i], "--net-latency") == 0) {
+            shim.latency = atof(argv[i + 1]) / 1000;
+        } else if (strcmp(argv[i], "--net-jitter") == 0) {
+            shim.jitter = atof(argv[i + 1]) / 1000;
+        } else if (strcmp(argv[i], "--swarm") == 0) {
+            swarmBalls = strtoull(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            lowLatency = strcmp(argv[i + 1], "low") == 0;
+        } else if (strcmp(argv[i], "--latency-test") == 0) {
+            latencyPresses = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--assets") == 0) {
+            assetsPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--audio-init") == 0) {
+            audioAsync = strcmp(argv[i + 1], "sync") != 0;
+        } else if (strcmp(argv[i], "--broadcast") == 0) {
+            broadcastPort = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watchPublisher = argv[i + 1];
+        }
+    }
+    if (tickRate <= 0) {
+        tickRate = GAME_TICK_RATE;
+    }
+    // the discrete step only moves whole ticks
+    float stepDt = GAME_TICK_RATE / tickRate;
+    swept = swept || stepDt != 1;
+    if (swarmBalls || latencyPresses > 0) {
+        // the arena and the latency test are local only
+        netPeer = NULL;
+    }
+    if (latencyPresses > 0) {
+        swarmBalls = 0;
+    }
+    if (watchPublisher) {
+        // only watching
+        netPeer = NULL;
+        swarmBalls = 0;
+        latencyPresses = 0;
+        broadcastPort = -1;
+    }
+    Prof_enable(profilePath != NULL);
+
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(screenWidth, screenHeight, "Pong");
-    InitAudioDevice();
-    AttachAudioMixedProcessor(processHitSound);
+    double windowShown = wallTime();
+    size_t soundCount = sizeof(sounds) / sizeof(*sounds);
+    double audioInit = 0; // seconds, when not on a thread
+    if (audioAsync) {
+        Sfx_openAsync(assetsPath, sounds, soundCount);
+    } else {
+        Sfx_mapBundle(assetsPath);
+        InitAudioDevice();
+        Sfx_open();
+        audioInit = wallTime() - windowShown;
+    }
+    bool assetsLoaded = false;
+    double firstFrame = 0;
 
-    SetTargetFPS(60);
+    SetTargetFPS(fps);
     SetExitKey(KEY_NULL);
 
     UI ui = UI_init(screenWidth, screenHeight);
+    NetSession net;
+    bool netActive = false;
+    bool netWaiting = false;
+    if (netPeer) {
+        bool host = strcmp(netPeer, "host") == 0;
+        if (netPort < 0) {
+            netPort = host ? 7777 : 0;
+        }
+        netActive = NetSession_open(
+            &net, netPort, host ? NULL : netPeer, newGameSeed(), shim);
+        netWaiting = netActive;
+        // the session is polled every frame
+        menuWait = false;
+    }
+    SpectatePublisher publisher;
+    bool broadcasting = false;
+    if (broadcastPort >= 0) {
+        broadcasting = SpectatePublisher_open(&publisher, broadcastPort);
+        if (broadcasting) {
+            Game_broadcast(&publisher);
+            // subscriptions are read every frame
+            menuWait = false;
+        }
+    }
+    SpectateViewer viewer;
+    bool watching = false;
+    if (watchPublisher) {
+        watching = SpectateViewer_open(&viewer, watchPublisher);
+    }
+    SpectateClock spectateClock = { .tick = 0, .playing = false };
     Game game = { .init = false };
+    DrawList drawList = DrawList_new(DRAW_LIST_CAPACITY, DRAW_LIST_TEXT_BYTES);
+    DrawList overlay = DrawList_new(64, 1024);
+    Swarm swarm = { .count = 0 };
+    if (swarmBalls) {
+        swarm = Swarm_new(swarmBalls, newGameSeed());
+        swarm.cpu[1] = false;
+        // a rect per ball
+        DrawList_del(&drawList);
+        drawList = DrawList_new(
+            swarmBalls + DRAW_LIST_CAPACITY, DRAW_LIST_TEXT_BYTES);
+    }
+    LatencyTest latencyTest = LatencyTest_new(latencyPresses, newGameSeed());
+    FramePacer pacer;
+    InputTimeline inputs = { .count = 0 };
+    bool pacing = false; // the pacer waits instead of EndDrawing
+    bool showOverlay = false;
+    DrawBackend backend = DrawBackend_raylib();
+    GameClock clock = GameClock_init(tickRate, GAME_MAX_TICKS_PER_FRAME);
+    ReplayWriter writer = { .file = NULL };
+    int recordedMatches = 0;
+    enum Screen lastScreen = ui.screen;
+    if (latencyTest.presses) {
+        // straight into a match, started like one from the menu
+        game = Game_init(ONE_PLAYER, newGameSeed());
+        ui.screen = SCREEN_GAME;
+    }
+    bool menuDrawn = false; // drawList holds the current menu
+    bool waiting = false;
+    // time spent on menus, to check they idle
+    double menuTime = 0;
+    double menuCpu = 0;
+    int menuFrames = 0;
+    double lastTime = GetTime();
     while (!WindowShouldClose()) {
         int w = GetScreenWidth();
         int h = GetScreenHeight();
+        if (!assetsLoaded && Sfx_opened()) {
+            // silent until here, a click this early is unlikely
+            Game_loadAssets();
+            UI_loadAssets();
+            assetsLoaded = true;
+        }
+        bool pace = lowLatency && ui.screen == SCREEN_GAME && !netActive &&
+            !swarm.count;
+        if (pace != pacing) {
+            SetTargetFPS(pace ? 0 : fps);
+            pacer = FramePacer_init(fps, GetTime());
+            inputs.count = 0;
+            pacing = pace;
+        }
+        bool f3 = pacing ?
+            waitForFrame(&pacer, &inputs) :
+            IsKeyPressed(KEY_F3);
+        double time = GetTime();
+        double frameTime = time - lastTime;
+        lastTime = time;
+        double frameCpu = cpuTime();
+        uint64_t frameStart = Prof_begin();
+        Prof_frame();
+        if (Prof_enabled() && f3) {
+            showOverlay = !showOverlay;
+        }
+        DrawList_reset(&overlay);
+        if (showOverlay) {
+            Prof_render(&overlay, w, h);
+        }
+
+        if (broadcasting) {
+            SpectatePublisher_poll(&publisher, time);
+        }
 
-        if (ui.screen == SCREEN_GAME) {
-            Game_update(&game);
+        if (watching) {
+            profile(PROF_GAME_UPDATE, {
+                SpectateViewer_poll(&viewer, time);
+                SpectateClock_advance(
+                    &spectateClock, &viewer, frameTime * tickRate);
+            });
+            profile(PROF_GAME_RENDER, {
+                DrawList_reset(&drawList);
+                Game shown = { .init = false };
+                if (spectateClock.playing &&
+                    SpectateViewer_at(&viewer, spectateClock.tick, &shown))
+                {
+                    Game_draw(&drawList, &shown, Game_view(&shown),
+                        GAME_RENDER_ALL, w, h);
+                } else {
+                    DrawList_text(&drawList, "WAITING FOR BROADCAST",
+                        w / 2.f, h * 0.45f, h * 0.09f, DRAW_ALIGN_CENTER,
+                        DRAW_WHITE);
+                }
+            });
+            draw({
+                profile(PROF_SUBMIT, {
+                    DrawBackend_submit(&backend, &drawList, w, h);
+                    DrawBackend_submit(&backend, &overlay, w, h);
+                });
+            });
+        } else if (swarm.count) {
+            profile(PROF_GAME_UPDATE, {
+                Game_advanceSwarm(&swarm, &clock, frameTime);
+            });
+            profile(PROF_GAME_RENDER, {
+                DrawList_reset(&drawList);
+                Swarm_draw(&drawList, &swarm, w, h);
+            });
+            draw({
+                profile(PROF_SUBMIT, {
+                    DrawBackend_submit(&backend, &drawList, w, h);
+                    DrawBackend_submit(&backend, &overlay, w, h);
+                });
+            });
+        } else if (netWaiting) {
+            NetSession_poll(&net, time);
+            NetSession_send(&net, time);
+            if (net.started) {
+                game = Game_init(TWO_PLAYERS, net.seed);
+                ui.screen = SCREEN_GAME;
+                netWaiting = false;
+            }
+            DrawList_reset(&drawList);
+            DrawList_text(&drawList, "WAITING FOR PLAYER", w / 2.f,
+                h * 0.45f, h * 0.09f, DRAW_ALIGN_CENTER, DRAW_WHITE);
             draw({
-                Game_render(&game, GAME_RENDER_ALL, w, h);
+                DrawBackend_submit(&backend, &drawList, w, h);
+            });
+        } else if (ui.screen == SCREEN_GAME) {
+            if (lastScreen != SCREEN_GAME) {
+                // time waiting on the menu isn't owed to the simulation
+                frameTime = 0;
+                Game_setSwept(&game, swept);
+                Game_setStepDt(&game, stepDt);
+                GameClock_reset(&clock, &game);
+                if (recordPrefix && !netActive) {
+                    char path[512];
+                    snprintf(path, sizeof(path), "%s-%d.replay",
+                        recordPrefix, ++recordedMatches);
+                    enum Mode mode =
+                        game.players[0].isCpu ? ONE_PLAYER : TWO_PLAYERS;
+                    if (ReplayWriter_open(&writer, path, mode, &game)) {
+                        Game_record(&writer);
+                    }
+                }
+            }
+            profile(PROF_GAME_UPDATE, {
+                if (netActive) {
+                    Game_advanceNet(&game, &clock, frameTime, &net, time);
+                } else {
+                    Game_advance(&game, &clock, frameTime,
+                        pacing ? &inputs : NULL, time);
+                }
             });
+            profile(PROF_GAME_RENDER, {
+                DrawList_reset(&drawList);
+                Game_render(&drawList, &game, &clock, GAME_RENDER_ALL, w, h);
+            });
+            draw({
+                profile(PROF_SUBMIT, {
+                    DrawBackend_submit(&backend, &drawList, w, h);
+                    DrawBackend_submit(&backend, &overlay, w, h);
+                });
+            });
+            double presented = GetTime();
+            if (pacing) {
+                FramePacer_presented(&pacer, time, presented);
+            }
+            if (latencyTest.presses && LatencyTest_frame(&latencyTest,
+                &game, &clock, presented, fps > 0 ? 1.0 / fps : 0))
+            {
+                break;
+            }
+            // an ended match may still be rolled back until it settles
+            bool ended = game.ended &&
+                (!netActive || Rollback_settled(&net.rollback));
             ui.screen =
-                (game.players[0]->score == 11 || game.players[1]->score == 11) ?
+                ended ?
                     SCREEN_END :
                     SCREEN_GAME;
+            menuDrawn = false;
         } else {
-            UI_update(&ui, &game, w, h);
+            if (netActive) {
+                // the peer may still be missing our last inputs
+                NetSession_poll(&net, time);
+                NetSession_send(&net, time);
+                if (ui.screen != SCREEN_END) {
+                    closeNet(&net);
+                    netActive = false;
+                }
+            }
+            // menus only change on input, record them again only then
+            bool changed;
+            profile(PROF_UI_UPDATE, {
+                changed = UI_update(&ui, &game, w, h);
+            });
+            if (changed || !menuDrawn) {
+                profile(PROF_UI_RENDER, {
+                    DrawList_reset(&drawList);
+                    UI_render(&drawList, &ui, &game, w, h);
+                });
+                menuDrawn = ui.screen != SCREEN_GAME;
+            }
+            // EndDrawing sleeps until the next input event while waiting,
+            // turn it off before the frame that starts a match
+            bool wait = menuWait && ui.screen != SCREEN_GAME;
+            if (wait != waiting) {
+                if (wait) {
+                    EnableEventWaiting();
+                } else {
+                    DisableEventWaiting();
+                }
+                waiting = wait;
+            }
             draw({
-                UI_render(&ui, &game, w, h);
+                profile(PROF_SUBMIT, {
+                    DrawBackend_submit(&backend, &drawList, w, h);
+                    DrawBackend_submit(&backend, &overlay, w, h);
+                });
             });
+            menuTime += GetTime() - time;
+            menuCpu += cpuTime() - frameCpu;
+            menuFrames++;
+        }
+        if (lastScreen == SCREEN_GAME && ui.screen != SCREEN_GAME &&
+            writer.file)
+        {
+            Game_record(NULL);
+            ReplayWriter_close(&writer, &game);
+        }
+        lastScreen = ui.screen;
+        Prof_end(PROF_FRAME, frameStart);
+        if (!firstFrame) {
+            firstFrame = wallTime();
         }
     }
 
+    if (writer.file) {
+        Game_record(NULL);
+        ReplayWriter_close(&writer, &game);
+    }
+    if (netActive) {
+        closeNet(&net);
+    }
+    if (swarm.count) {
+        closeSwarm(&swarm);
+    }
+    if (broadcasting) {
+        Game_broadcast(NULL);
+        closePublisher(&publisher);
+    }
+    if (watching) {
+        closeViewer(&viewer);
+    }
+    LatencyTest_close(&latencyTest, lowLatency);
+    if (firstFrame) {
+        // the thread starts with the window shown
+        SfxStats sfx = Sfx_stats();
+        double audio = audioAsync ? sfx.openTime : audioInit;
+        TraceLog(LOG_INFO,
+            "STARTUP: window %.1f ms, first frame %.1f ms, audio ready "
+            "%.1f ms %s, %zu sounds mapped from the bundle, %zu decoded",
+            (windowShown - launched) * 1000, (firstFrame - launched) * 1000,
+            (windowShown - launched + audio) * 1000,
+            audioAsync ? "on a thread" : "before the first frame",
+            sfx.mapped, sfx.decodes);
+    }
+    if (menuTime > 0) {
+        TraceLog(LOG_INFO,
+            "MENU: %d frames in %.1f s, %.2f%% of a core",
+            menuFrames, menuTime, menuCpu / menuTime * 100);
+    }
+
     if (game.init) {
         Game_del(&game);
     }
+    DrawBackend_del(&backend);
+    DrawList_del(&overlay);
+    DrawList_del(&drawList);
     UI_del(&ui);
+    Game_unloadAssets();
+    Sfx_close();
+    if (profilePath) {
+        FILE* file = fopen(profilePath, "w");
+        size_t length = strlen(profilePath);
+        bool json = length >= 5 &&
+            strcmp(profilePath + length - 5, ".json") == 0;
+        if (!file || !(json ? Prof_writeTrace(file) : Prof_writeCsv(file))) {
+            fprintf(stderr, "can't write %s\n", profilePath);
+        }
+        if (file) {
+            fclose(file);
+        }
+    }
 
-    DetachAudioMixedProcessor(processHitSound);
     CloseAudioDevice();
     CloseWindow();
     return 0;
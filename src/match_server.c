@@ -0,0 +1,124 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "server.h"
+
+// Hosts two player matches for clients over UDP, see server.h
+// Prints every shard's matches and tick times each --report seconds.
+//
+// usage: match_server [options]
+//   --port PORT        lobby port (7900)
+//   --shards N         threads, 0 for one per cpu (0)
+//   --capacity N       matches per shard (2048)
+//   --seed S           seed, match m uses rng stream m (1)
+//   --pin on|off       pin shard i to cpu i (on)
+//   --report S         seconds between reports, 0 for none (1)
+// Runs until SIGINT or SIGTERM.
+
+static Server* served = NULL;
+static volatile sig_atomic_t stopped = 0;
+
+static void stop(int signal) {
+    (void)signal;
+    stopped = 1;
+    Server_stop(served);
+}
+
+static void* serve(void* server) {
+    Server_serve(server);
+    return NULL;
+}
+
+static void report(Server* server) {
+    size_t matches = 0;
+    double worst = 0;
+    for (int s = 0; s < Server_shards(server); s++) {
+        ServerShardStats stats = Server_stats(server, s);
+        printf("shard %2d  %5zu/%zu matches  tick mean %.3f p50 %.2f "
+            "p99 %.2f max %.2f ms  %llu late  %llu in  %llu out\n",
+            s, stats.matches, stats.capacity, stats.mean * 1000,
+            stats.p50 * 1000, stats.p99 * 1000, stats.max * 1000,
+            (unsigned long long)stats.late,
+            (unsigned long long)stats.received,
+            (unsigned long long)stats.sent);
+        matches += stats.matches;
+        worst = stats.p99 > worst ? stats.p99 : worst;
+    }
+    printf("total     %5zu matches, worst p99 %.2f ms of %.2f\n\n",
+        matches, worst * 1000, 1000.0 / SERVER_TICK_RATE);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    ServerConfig config = {
+        .port = 7900,
+        .shards = 0,
+        .capacity = 2048,
+        .seed = 1,
+        .pin = true,
+    };
+    double interval = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* val = argv[i + 1];
+        bool ok = true;
+        if (strcmp(opt, "--port") == 0) {
+            config.port = atoi(val);
+        } else if (strcmp(opt, "--shards") == 0) {
+            config.shards = atoi(val);
+        } else if (strcmp(opt, "--capacity") == 0) {
+            config.capacity = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--seed") == 0) {
+            config.seed = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--pin") == 0) {
+            config.pin = strcmp(val, "off") != 0;
+        } else if (strcmp(opt, "--report") == 0) {
+            interval = atof(val);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "bad option %s %s\n", opt, val);
+            return 1;
+        }
+    }
+
+    // only this thread takes the signals, so they cut its sleep short
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    Server* server = Server_new(config);
+    if (!server) {
+        return 1;
+    }
+    printf("serving on port %d with %d shards of %zu matches\n",
+        config.port, Server_shards(server), config.capacity);
+    fflush(stdout);
+    served = server;
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    pthread_t lobby;
+    pthread_create(&lobby, NULL, serve, server);
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+    struct timespec sleep = {
+        .tv_sec = interval,
+        .tv_nsec = (interval - (long)interval) * 1e9,
+    };
+    while (!stopped) {
+        if (interval <= 0) {
+            pause();
+        } else if (nanosleep(&sleep, NULL) == 0) {
+            // not cut short by the signal
+            report(server);
+        }
+    }
+    pthread_join(lobby, NULL);
+    Server_del(server);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+#include "net.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "udp.h"
+
+#define NET_MAGIC "PNG2"
+#define NET_HEADER 33
+
+static bool NetLink_open(NetLink* link, int port, const char* peer) {
+    memset(link, 0, sizeof(*link));
+    link->fd = Udp_open(port, NULL);
+    if (link->fd < 0) {
+        return false;
+    }
+    if (!peer) {
+        return true;
+    }
+    if (!Udp_resolve(peer, link->peer)) {
+        close(link->fd);
+        link->fd = -1;
+        return false;
+    }
+    link->peerSize = UDP_ADDR_SIZE;
+    return true;
+}
+
+static void NetLink_write(NetLink* link, const uint8_t* data, int size) {
+    sendto(link->fd, data, size, 0,
+        (struct sockaddr*)link->peer, link->peerSize);
+    link->sent++;
+}
+
+static void NetLink_send(
+    NetLink* link, const uint8_t* data, int size, double now)
+{
+    NetShim* shim = &link->shim;
+    if (shim->loss > 0 && Rng_next(&link->rng) < shim->loss * 4294967296.0) {
+        link->dropped++;
+        return;
+    }
+    double delay = shim->latency;
+    if (shim->jitter > 0) {
+        delay += shim->jitter * (Rng_next(&link->rng) / 4294967296.0);
+    }
+    if (delay <= 0 || link->delayedCount == NET_SHIM_QUEUE) {
+        NetLink_write(link, data, size);
+        return;
+    }
+    NetDelayed* delayed = &link->delayed[link->delayedCount++];
+    delayed->due = now + delay;
+    delayed->size = size;
+    memcpy(delayed->data, data, size);
+}
+
+static void NetLink_flush(NetLink* link, double now) {
+    for (int i = 0; i < link->delayedCount;) {
+        NetDelayed* delayed = &link->delayed[i];
+        if (delayed->due > now) {
+            i++;
+            continue;
+        }
+        NetLink_write(link, delayed->data, delayed->size);
+        *delayed = link->delayed[--link->delayedCount];
+    }
+}
+
+bool NetSession_open(
+    NetSession* session, int port, const char* peer, uint64_t seed,
+    NetShim shim)
+{
+    memset(session, 0, sizeof(*session));
+    if (!NetLink_open(&session->link, port, peer)) {
+        return false;
+    }
+    session->side = peer ? 1 : 0;
+    // 0 means not known yet
+    session->seed = peer ? 0 : seed ? seed : 1;
+    session->link.shim = shim;
+    session->link.rng = Rng_init(seed ^ port, session->side);
+    Rollback_init(&session->rollback, session->side);
+    session->checkTick = UINT32_MAX;
+    return true;
+}
+
+void NetSession_close(NetSession* session) {
+    if (session->link.fd >= 0) {
+        close(session->link.fd);
+        session->link.fd = -1;
+    }
+}
+
+static void NetSession_receive(
+    NetSession* session, const uint8_t* data, int size)
+{
+    if (size < NET_HEADER || memcmp(data, NET_MAGIC, 4) != 0) {
+        return;
+    }
+    uint64_t seed = get64(data + 4);
+    uint32_t ack = get32(data + 12);
+    uint32_t checkTick = get32(data + 16);
+    uint64_t checkHash = get64(data + 20);
+    uint32_t first = get32(data + 28);
+    int count = data[32];
+    if (count > size - NET_HEADER) {
+        return;
+    }
+    session->link.received++;
+    if (!session->started) {
+        if (session->side == 0) {
+            session->started = true;
+        } else if (seed) {
+            session->seed = seed;
+            session->started = true;
+        }
+    }
+    if (ack > session->peerAck) {
+        session->peerAck = ack;
+    }
+    // newer ones would often be ahead of our tick too, keep the one we have
+    // until it's compared
+    if (session->checkTick == UINT32_MAX) {
+        session->checkTick = checkTick;
+        session->checkHash = checkHash;
+    }
+    for (int i = 0; i < count; i++) {
+        Rollback_remote(
+            &session->rollback, first + i, (int8_t)data[NET_HEADER + i]);
+    }
+}
+
+// Once our inputs before the peer's checkTick are confirmed too
+static void NetSession_check(NetSession* session) {
+    Rollback* rollback = &session->rollback;
+    uint64_t hash;
+    if (session->checkTick == UINT32_MAX ||
+        !Rollback_hash(rollback, session->checkTick, &hash))
+    {
+        // fell out of the ring, wait for a newer one
+        if (session->checkTick != UINT32_MAX &&
+            (int32_t)(rollback->tick - session->checkTick) > ROLLBACK_RING)
+        {
+            session->checkTick = UINT32_MAX;
+        }
+        return;
+    }
+    session->checks++;
+    if (hash != session->checkHash) {
+        session->desynced = true;
+    }
+    session->checkTick = UINT32_MAX;
+}
+
+void NetSession_poll(NetSession* session, double now) {
+    NetLink* link = &session->link;
+    uint8_t data[NET_PACKET_MAX + 1];
+    for (;;) {
+        uint8_t from[128];
+        socklen_t fromSize = sizeof(from);
+        ssize_t size = recvfrom(link->fd, data, sizeof(data), 0,
+            (struct sockaddr*)from, &fromSize);
+        if (size < 0) {
+            break;
+        }
+        // the host answers whoever speaks first
+        if (!link->peerSize && session->side == 0) {
+            memcpy(link->peer, from, fromSize);
+            link->peerSize = fromSize;
+        }
+        NetSession_receive(session, data, size);
+    }
+    NetSession_check(session);
+    NetLink_flush(link, now);
+}
+
+void NetSession_send(NetSession* session, double now) {
+    if (!session->link.peerSize) {
+        return;
+    }
+    Rollback* rollback = &session->rollback;
+    uint32_t first = session->peerAck;
+    if (rollback->tick - first > ROLLBACK_MAX_TICKS) {
+        first = rollback->tick - ROLLBACK_MAX_TICKS;
+    }
+    int count = rollback->tick - first;
+    // the latest state both sides can have computed alike
+    uint32_t checkTick = rollback->confirmed < rollback->tick ?
+        rollback->confirmed :
+        rollback->tick - 1;
+    uint64_t checkHash = 0;
+    if (!rollback->tick || !Rollback_hash(rollback, checkTick, &checkHash)) {
+        checkTick = UINT32_MAX;
+    }
+
+    uint8_t data[NET_PACKET_MAX];
+    memcpy(data, NET_MAGIC, 4);
+    put64(data + 4, session->seed);
+    put32(data + 12, rollback->confirmed);
+    put32(data + 16, checkTick);
+    put64(data + 20, checkHash);
+    put32(data + 28, first);
+    data[32] = count;
+    for (int i = 0; i < count; i++) {
+        data[NET_HEADER + i] = Rollback_localInput(rollback, first + i);
+    }
+    NetLink_send(&session->link, data, NET_HEADER + count, now);
+}
+
+bool NetSession_canStep(NetSession* session) {
+    Rollback* rollback = &session->rollback;
+    bool can = session->started && Rollback_canStep(rollback) &&
+        (int32_t)(rollback->tick - session->peerAck) < ROLLBACK_MAX_TICKS;
+    if (session->started && !can) {
+        session->stalls++;
+    }
+    return can;
+}
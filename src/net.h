@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rng.h"
+#include "rollback.h"
+
+// Two player matches over UDP, IPv4
+// Every packet carries the sender's inputs the peer hasn't acknowledged
+// yet, up to ROLLBACK_MAX_TICKS of them, so a lost packet is covered by
+// the next one and nothing is ever resent on a timer. The host picks the
+// match seed and sends it in every packet. Packets also carry the hash of
+// the sender's latest confirmed state, a peer whose own state for that tick
+// hashes differently has desynced. A shim can drop and delay
+// outgoing packets to test bad connections on one machine.
+
+#define NET_PACKET_MAX (33 + ROLLBACK_MAX_TICKS)
+#define NET_SHIM_QUEUE 256 // packets in flight through the shim
+
+typedef struct {
+    float loss; // chance each packet is dropped, 0 to 1
+    double latency; // seconds added to every packet
+    double jitter; // up to this many more seconds, reorders packets
+} NetShim;
+
+typedef struct {
+    double due;
+    int size;
+    uint8_t data[NET_PACKET_MAX];
+} NetDelayed;
+
+typedef struct {
+    int fd;
+    _Alignas(8) uint8_t peer[128]; // sockaddr
+    uint32_t peerSize; // 0 until the host hears from the peer
+    NetShim shim;
+    Rng rng;
+    NetDelayed delayed[NET_SHIM_QUEUE];
+    int delayedCount;
+
+    uint64_t sent;
+    uint64_t received;
+    uint64_t dropped; // by the shim
+} NetLink;
+
+typedef struct {
+    NetLink link;
+    Rollback rollback;
+    int side; // 0 hosts and plays the left paddle
+    bool started; // both sides know the seed
+    uint64_t seed;
+    uint32_t peerAck; // the peer has our inputs for ticks below this
+    uint64_t stalls; // ticks held back waiting on the peer
+
+    // the peer's hash of its state before checkTick, UINT32_MAX once ours
+    // was compared with it
+    uint32_t checkTick;
+    uint64_t checkHash;
+    uint64_t checks; // states compared with the peer's
+    bool desynced; // one of them differed
+} NetSession;
+
+// Listens on port, peer is "host:port" to join or NULL to host
+// seed is only used when hosting
+bool NetSession_open(
+    NetSession* session, int port, const char* peer, uint64_t seed,
+    NetShim shim);
+void NetSession_close(NetSession* session);
+
+// Reads every waiting packet, checks the peer's state hash and sends the
+// ones the shim held back, now is in seconds on any monotonic clock
+void NetSession_poll(NetSession* session, double now);
+// Sends the inputs the peer is missing, once a frame
+void NetSession_send(NetSession* session, double now);
+
+// False while either side is waiting on the other
+bool NetSession_canStep(NetSession* session);
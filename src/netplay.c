@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "net.h"
+#include "timing.h"
+
+// Plays a networked match between two scripted peers over UDP loopback
+// usage: netplay [loss %] [latency ms] [jitter ms] [port] [seed]
+// Both peers live in this process and share a simulated 60 Hz clock, the
+// shim degrades the packets of both. Each side only sees its own input in
+// time, so every change of the other paddle is a misprediction. When the
+// match ends both final states have to be identical, and so must every
+// state the peers compared along the way.
+
+#define NETPLAY_FRAME (1 / 60.0)
+#define NETPLAY_MAX_FRAMES (60 * 60 * 30)
+
+typedef struct {
+    NetSession session;
+    Game game;
+    bool playing;
+    Rng rng; // scripted input
+    int8_t dy;
+    int hold; // ticks until the input changes
+    double maxCorrect; // slowest rollback, seconds
+} Peer;
+
+// Follows the ball with a reaction delay and the odd wrong move
+int8_t Peer_input(Peer* peer) {
+    if (peer->hold-- <= 0) {
+        int side = peer->session.side;
+        peer->dy = Rng_range(&peer->rng, 0, 9) == 0 ?
+            Rng_range(&peer->rng, -1, 1) :
+            Game_followBall(&peer->game, side);
+        peer->hold = Rng_range(&peer->rng, 0, 12);
+    }
+    return peer->dy;
+}
+
+void Peer_frame(Peer* peer, double time) {
+    NetSession* session = &peer->session;
+    NetSession_poll(session, time);
+    if (!peer->playing && session->started) {
+        peer->game = Game_init(TWO_PLAYERS, session->seed);
+        peer->playing = true;
+    }
+    if (peer->playing) {
+        double start = now();
+        Rollback_correct(&session->rollback, &peer->game);
+        double elapsed = now() - start;
+        if (elapsed > peer->maxCorrect) {
+            peer->maxCorrect = elapsed;
+        }
+        if (!peer->game.ended && NetSession_canStep(session)) {
+            int8_t dy = Peer_input(peer);
+            Rollback_step(&session->rollback, &peer->game, dy, NULL);
+        }
+    }
+    NetSession_send(session, time);
+}
+
+bool Peer_done(const Peer* peer) {
+    return peer->playing && peer->game.ended &&
+        Rollback_settled(&peer->session.rollback);
+}
+
+void Peer_print(const Peer* peer, const char* name) {
+    const NetSession* session = &peer->session;
+    const Rollback* rollback = &session->rollback;
+    printf("%-5s ticks %u, rollbacks %llu, redone %llu (at most %u), "
+        "stalls %llu, slowest rollback %.1f us\n",
+        name, rollback->tick, (unsigned long long)rollback->rollbacks,
+        (unsigned long long)rollback->resimulated, rollback->maxDepth,
+        (unsigned long long)session->stalls, peer->maxCorrect * 1e6);
+    printf("      states checked with the peer %llu%s\n",
+        (unsigned long long)session->checks,
+        session->desynced ? ", DESYNC" : "");
+    printf("      packets sent %llu, received %llu, dropped %llu\n",
+        (unsigned long long)session->link.sent,
+        (unsigned long long)session->link.received,
+        (unsigned long long)session->link.dropped);
+}
+
+int main(int argc, char** argv) {
+    NetShim shim = {
+        .loss = argc > 1 ? atof(argv[1]) / 100 : 0.1,
+        .latency = argc > 2 ? atof(argv[2]) / 1000 : 0.05,
+        .jitter = argc > 3 ? atof(argv[3]) / 1000 : 0.02,
+    };
+    int port = argc > 4 ? atoi(argv[4]) : 7777;
+    uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 0) : 1;
+
+    Peer host = { .rng = Rng_init(seed, 1) };
+    Peer guest = { .rng = Rng_init(seed, 2) };
+    char peer[64];
+    snprintf(peer, sizeof(peer), "127.0.0.1:%d", port);
+    if (!NetSession_open(&host.session, port, NULL, seed, shim) ||
+        !NetSession_open(&guest.session, port + 1, peer, seed, shim))
+    {
+        return 1;
+    }
+
+    double time = 0;
+    long frames = 0;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 20000 };
+    for (; frames < NETPLAY_MAX_FRAMES; frames++) {
+        time += NETPLAY_FRAME;
+        Peer_frame(&host, time);
+        // loopback delivery isn't instant
+        nanosleep(&pause, NULL);
+        Peer_frame(&guest, time);
+        nanosleep(&pause, NULL);
+        if (Peer_done(&host) && Peer_done(&guest)) {
+            break;
+        }
+    }
+
+    printf("shim          %.0f%% loss, %.0f ms latency, %.0f ms jitter\n",
+        shim.loss * 100, shim.latency * 1000, shim.jitter * 1000);
+    printf("frames        %ld, %.1f s of play\n", frames, time);
+    Peer_print(&host, "host");
+    Peer_print(&guest, "guest");
+
+    int status = 0;
+    if (!Peer_done(&host) || !Peer_done(&guest)) {
+        printf("match didn't finish\n");
+        status = 1;
+    } else {
+        bool same = Game_hash(&host.game) == Game_hash(&guest.game) &&
+            !host.session.desynced && !guest.session.desynced;
+        printf("final state   %s, %u : %u\n",
+            same ? "identical" : "DESYNC",
+            host.game.players[0].score, host.game.players[1].score);
+        status = same ? 0 : 1;
+    }
+
+    if (host.playing) {
+        Game_del(&host.game);
+    }
+    if (guest.playing) {
+        Game_del(&guest.game);
+    }
+    NetSession_close(&host.session);
+    NetSession_close(&guest.session);
+    return status;
+}
@@ -0,0 +1,74 @@
+#include "pacer.h"
+#include <string.h>
+
+FramePacer FramePacer_init(double fps, double now) {
+    double period = fps > 0 ? 1 / fps : 0;
+    return (FramePacer) {
+        .period = period,
+        .work = 0,
+        .next = now + period,
+    };
+}
+
+double FramePacer_wake(const FramePacer* pacer) {
+    return pacer->next - pacer->work - PACER_MARGIN;
+}
+
+void FramePacer_presented(FramePacer* pacer, double sampled, double presented) {
+    // up at once after a slow frame, down slowly, so one fast frame doesn't
+    // make the next late
+    double work = presented - sampled;
+    if (work > pacer->work) {
+        pacer->work = work;
+    } else {
+        pacer->work += (work - pacer->work) * PACER_DECAY;
+    }
+    pacer->next += pacer->period;
+    if (pacer->next < presented) {
+        // missed, start over from now instead of rushing to catch up
+        pacer->next = presented + pacer->period;
+    }
+}
+
+void InputTimeline_push(InputTimeline* timeline, double time, GameInput input) {
+    if (timeline->count) {
+        GameInput last = timeline->samples[timeline->count - 1].input;
+        if (memcmp(&last, &input, sizeof(input)) == 0) {
+            return;
+        }
+    }
+    if (timeline->count == INPUT_TIMELINE_SIZE) {
+        memmove(timeline->samples, timeline->samples + 1,
+            (INPUT_TIMELINE_SIZE - 1) * sizeof(InputSample));
+        timeline->count--;
+    }
+    timeline->samples[timeline->count++] = (InputSample) {
+        .time = time,
+        .input = input,
+    };
+}
+
+GameInput InputTimeline_at(const InputTimeline* timeline, double time) {
+    if (!timeline->count) {
+        return GAME_INPUT_IDLE;
+    }
+    // latest first, usually the one asked for
+    for (int i = timeline->count - 1; i > 0; i--) {
+        if (timeline->samples[i].time <= time) {
+            return timeline->samples[i].input;
+        }
+    }
+    return timeline->samples[0].input;
+}
+
+GameInput InputTimeline_forTick(
+    const InputTimeline* timeline, double now, double accumulator,
+    double tickTime, int j)
+{
+    double end = now - accumulator + (j + 1) * tickTime;
+    if (now - end < tickTime) {
+        // the last tick this frame, nothing polled since may wait a frame
+        return InputTimeline_at(timeline, now);
+    }
+    return InputTimeline_at(timeline, end);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include "sim.h"
+
+// Low latency frame loop, no raylib here
+// raylib waits for the frame rate after presenting, so a key pressed during
+// that wait sits until the next frame has done all its work. The pacer
+// waits before sampling input instead, as long as the frame's work is
+// expected to leave spare, and input polled while waiting goes into a
+// timeline so every tick can use the input of its own time.
+
+#define PACER_MARGIN 0.001 // seconds kept spare besides the expected work
+#define PACER_DECAY 0.02 // how fast the work estimate follows faster frames
+#define PACER_POLL 0.001 // input polling interval while waiting
+#define INPUT_TIMELINE_SIZE 64
+
+typedef struct {
+    double period; // seconds per frame, 0 uncapped
+    double work; // expected seconds from sampling input to presenting
+    double next; // when the next frame should be presented
+} FramePacer;
+
+FramePacer FramePacer_init(double fps, double now);
+// When to sample input for the next frame
+double FramePacer_wake(const FramePacer* pacer);
+// After presenting, sampled is when input was sampled
+void FramePacer_presented(FramePacer* pacer, double sampled, double presented);
+
+typedef struct {
+    double time;
+    GameInput input;
+} InputSample;
+
+// Input changes, oldest first, the oldest are dropped once full
+typedef struct {
+    InputSample samples[INPUT_TIMELINE_SIZE];
+    int count;
+} InputTimeline;
+
+// Only kept if it differs from the latest
+void InputTimeline_push(InputTimeline* timeline, double time, GameInput input);
+// Input held at time, the oldest known before any sample
+GameInput InputTimeline_at(const InputTimeline* timeline, double time);
+// Input for tick j of those a frame runs at now, with accumulator seconds
+// not simulated before the first. A tick uses what was held when it ended,
+// so catching up several ticks replays input changes between them instead
+// of giving them all the last sample, and the last tick takes the latest.
+GameInput InputTimeline_forTick(
+    const InputTimeline* timeline, double now, double accumulator,
+    double tickTime, int j);
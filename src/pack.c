@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "bundle.h"
+
+// Decodes sound files into a bundle for the game to map at startup
+// Every file becomes mono floats at one sample rate, the device's usual
+// one, and is found in the bundle by the path it was given here. Uses
+// raylib's decoders but opens no window or audio device.
+//
+// usage: pack OUT [--rate HZ] FILE...
+//   --rate HZ          sample rate, the game resamples on load when its
+//                      device runs at another (48000)
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: pack OUT [--rate HZ] FILE...\n");
+        return 1;
+    }
+    const char* out = argv[1];
+    int rate = 48000;
+    int first = 2;
+    if (strcmp(argv[first], "--rate") == 0 && first + 1 < argc) {
+        rate = atoi(argv[first + 1]);
+        first += 2;
+    }
+    size_t count = argc - first;
+    if (rate <= 0 || count == 0) {
+        fprintf(stderr, "need a positive rate and at least one file\n");
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    const char** names = malloc(count * sizeof(char*));
+    float** samples = malloc(count * sizeof(float*));
+    size_t* frames = malloc(count * sizeof(size_t));
+    bool ok = true;
+    size_t bytes = 0;
+    size_t loaded = 0;
+    for (; loaded < count; loaded++) {
+        const char* path = argv[first + loaded];
+        Wave wave = LoadWave(path);
+        if (wave.frameCount == 0) {
+            fprintf(stderr, "can't decode %s\n", path);
+            ok = false;
+            break;
+        }
+        WaveFormat(&wave, rate, 32, 1);
+        names[loaded] = path;
+        samples[loaded] = LoadWaveSamples(wave);
+        frames[loaded] = wave.frameCount;
+        bytes += wave.frameCount * sizeof(float);
+        UnloadWave(wave);
+    }
+    if (ok) {
+        ok = Bundle_write(out, rate, count, names,
+            (const float* const*)samples, frames);
+        if (ok) {
+            printf("packed %zu sounds at %d Hz into %s, %zu KiB of samples\n",
+                count, rate, out, bytes / 1024);
+        } else {
+            fprintf(stderr, "can't write %s\n", out);
+        }
+    }
+    for (size_t i = 0; i < loaded; i++) {
+        UnloadWaveSamples(samples[i]);
+    }
+    free(frames);
+    free(samples);
+    free(names);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Chase-Lev deque over a fixed power of two ring
+// Tasks are pushed before the workers are woken, so it never grows mid run
+typedef struct {
+    _Alignas(64) atomic_llong top;
+    _Alignas(64) atomic_llong bottom;
+    atomic_size_t* tasks;
+    size_t mask;
+} Deque;
+
+struct Pool {
+    int threads;
+    pthread_t* handles;
+    Deque* deques;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    int running; // workers still inside the current run
+    bool quit;
+
+    PoolTask task;
+    void* arg;
+};
+
+typedef struct {
+    Pool* pool;
+    int worker;
+} WorkerArgs;
+
+#define DEQUE_EMPTY SIZE_MAX
+#define DEQUE_ABORT (SIZE_MAX - 1)
+
+static void Deque_reserve(Deque* deque, size_t count) {
+    size_t capacity = 1;
+    while (capacity < count) {
+        capacity <<= 1;
+    }
+    if (deque->tasks && deque->mask + 1 >= capacity) {
+        return;
+    }
+    free(deque->tasks);
+    deque->tasks = malloc(capacity * sizeof(*deque->tasks));
+    deque->mask = capacity - 1;
+}
+
+static void Deque_push(Deque* deque, size_t task) {
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(
+        &deque->tasks[b & deque->mask], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+static size_t Deque_pop(Deque* deque) {
+    long long b =
+        atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return DEQUE_EMPTY;
+    }
+    size_t task = atomic_load_explicit(
+        &deque->tasks[b & deque->mask], memory_order_relaxed);
+    if (t == b) {
+        // last task, race the thieves for it
+        bool won = atomic_compare_exchange_strong_explicit(
+            &deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return won ? task : DEQUE_EMPTY;
+    }
+    return task;
+}
+
+static size_t Deque_steal(Deque* deque) {
+    long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) {
+        return DEQUE_EMPTY;
+    }
+    size_t task = atomic_load_explicit(
+        &deque->tasks[t & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed))
+    {
+        return DEQUE_ABORT;
+    }
+    return task;
+}
+
+// xorshift, only picks steal victims
+static uint32_t nextVictim(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void Pool_work(Pool* pool, int worker) {
+    Deque* own = &pool->deques[worker];
+    uint32_t rng = 0x9e3779b9u * (worker + 1);
+    for (;;) {
+        size_t task = Deque_pop(own);
+        if (task == DEQUE_EMPTY) {
+            // everything was pushed up front, so once every deque is seen
+            // empty the run is over for this worker
+            bool sawWork = false;
+            for (int tries = 0; tries < pool->threads * 2; tries++) {
+                int victim = nextVictim(&rng) % pool->threads;
+                task = Deque_steal(&pool->deques[victim]);
+                if (task != DEQUE_EMPTY) {
+                    sawWork = true;
+                    if (task != DEQUE_ABORT) {
+                        break;
+                    }
+                }
+            }
+            if (task == DEQUE_EMPTY || task == DEQUE_ABORT) {
+                for (int v = 0; v < pool->threads && !sawWork; v++) {
+                    Deque* deque = &pool->deques[v];
+                    sawWork =
+                        atomic_load(&deque->top) < atomic_load(&deque->bottom);
+                }
+                if (!sawWork) {
+                    return;
+                }
+                continue;
+            }
+        }
+        pool->task(pool->arg, task, worker);
+    }
+}
+
+static void* Pool_worker(void* argsPtr) {
+    WorkerArgs args = *(WorkerArgs*)argsPtr;
+    free(argsPtr);
+    Pool* pool = args.pool;
+
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->quit && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        Pool_work(pool, args.worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+Pool* Pool_new(int threads) {
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? n : 1;
+    }
+    Pool* pool = calloc(1, sizeof(*pool));
+    pool->threads = threads;
+    pool->handles = malloc(threads * sizeof(*pool->handles));
+    pool->deques = calloc(threads, sizeof(*pool->deques));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int i = 0; i < threads; i++) {
+        WorkerArgs* args = malloc(sizeof(*args));
+        *args = (WorkerArgs){ .pool = pool, .worker = i };
+        pthread_create(&pool->handles[i], NULL, Pool_worker, args);
+    }
+    return pool;
+}
+
+void Pool_del(Pool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_join(pool->handles[i], NULL);
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->deques);
+    free(pool->handles);
+    free(pool);
+}
+
+int Pool_threads(const Pool* pool) {
+    return pool->threads;
+}
+
+void Pool_run(Pool* pool, size_t count, PoolTask task, void* arg) {
+    if (count == 0) {
+        return;
+    }
+
+    // workers are parked, deal the tasks out in contiguous blocks so each
+    // worker starts on its own neighbourhood and only steals at the end
+    size_t perWorker = (count + pool->threads - 1) / pool->threads;
+    for (int w = 0; w < pool->threads; w++) {
+        Deque* deque = &pool->deques[w];
+        Deque_reserve(deque, perWorker);
+        atomic_store(&deque->top, 0);
+        atomic_store(&deque->bottom, 0);
+        size_t begin = w * perWorker;
+        size_t end = begin + perWorker < count ? begin + perWorker : count;
+        // pushed in reverse so the owner pops them in ascending order
+        for (size_t i = end; i > begin; i--) {
+            Deque_push(deque, i - 1);
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->running = pool->threads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+
+// Work-stealing thread pool
+// Each worker owns a deque of task indices, pops from its own bottom and
+// steals from the top of a random victim once it runs dry.
+
+typedef struct Pool Pool;
+
+// index is the task, worker is in [0, Pool_threads)
+typedef void (*PoolTask)(void* arg, size_t index, int worker);
+
+// threads <= 0 uses one thread per online cpu
+Pool* Pool_new(int threads);
+void Pool_del(Pool* pool);
+int Pool_threads(const Pool* pool);
+// Runs task(arg, i, worker) for every i in [0, count), blocks until done
+void Pool_run(Pool* pool, size_t count, PoolTask task, void* arg);
@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 199309L
+#include "prof.h"
+
+#ifdef PONG_PROFILE
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { PROF_MAIN, PROF_AUDIO_THREAD, PROF_THREADS };
+
+static const char* phaseNames[PROF_PHASES] = {
+    [PROF_FRAME] = "frame",
+    [PROF_GAME_UPDATE] = "game update",
+    [PROF_ROLLBACK] = "rollback",
+    [PROF_GAME_RENDER] = "game render",
+    [PROF_UI_UPDATE] = "ui update",
+    [PROF_UI_RENDER] = "ui render",
+    [PROF_SUBMIT] = "submit",
+    [PROF_PRESENT] = "present",
+    [PROF_AUDIO] = "audio",
+};
+
+// Single producer, single consumer, the producer drops samples when full
+typedef struct {
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+    atomic_size_t dropped;
+    ProfSample items[PROF_RING_SIZE];
+} ProfRing;
+
+static atomic_bool enabled = false;
+static ProfRing rings[PROF_THREADS];
+
+// main thread only from here on
+static float window[PROF_PHASES][PROF_WINDOW]; // ms
+static size_t windowCount[PROF_PHASES];
+static ProfSample* history = NULL;
+static size_t historyCount = 0;
+static size_t historyCapacity = 0;
+static size_t historyDropped = 0;
+static uint64_t origin = 0;
+static size_t frames = 0;
+// overlay numbers, sorting every frame would cost about 1% of it
+static float percentiles[PROF_PHASES][3];
+static size_t percentilesFrame = 0;
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void Prof_enable(bool on) {
+    if (on && !origin) {
+        origin = nowNs();
+    }
+    atomic_store_explicit(&enabled, on, memory_order_relaxed);
+}
+
+bool Prof_enabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+uint64_t Prof_begin(void) {
+    return Prof_enabled() ? nowNs() : 0;
+}
+
+void Prof_end(enum ProfPhase phase, uint64_t start) {
+    if (!start) {
+        return;
+    }
+    ProfRing* ring = &rings[phase == PROF_AUDIO ? PROF_AUDIO_THREAD : PROF_MAIN];
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == PROF_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->items[tail & (PROF_RING_SIZE - 1)] = (ProfSample) {
+        .start = start,
+        .end = nowNs(),
+        .phase = phase,
+    };
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static void Prof_keep(const ProfSample* sample) {
+    float ms = (sample->end - sample->start) * 1e-6f;
+    size_t n = windowCount[sample->phase]++;
+    window[sample->phase][n % PROF_WINDOW] = ms;
+
+    if (historyCount == historyCapacity) {
+        if (historyCapacity == PROF_LOG_MAX) {
+            historyDropped++;
+            return;
+        }
+        size_t capacity = historyCapacity ? historyCapacity * 2 : 4096;
+        ProfSample* grown = realloc(history, capacity * sizeof(ProfSample));
+        if (!grown) {
+            historyDropped++;
+            return;
+        }
+        history = grown;
+        historyCapacity = capacity;
+    }
+    history[historyCount++] = *sample;
+}
+
+void Prof_frame(void) {
+    for (int t = 0; t < PROF_THREADS; t++) {
+        ProfRing* ring = &rings[t];
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        for (; head != tail; head++) {
+            Prof_keep(&ring->items[head & (PROF_RING_SIZE - 1)]);
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+    frames++;
+}
+
+static int compareFloat(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void Prof_percentiles(void) {
+    for (int p = 0; p < PROF_PHASES; p++) {
+        size_t n = windowCount[p] < PROF_WINDOW ? windowCount[p] : PROF_WINDOW;
+        if (n == 0) {
+            continue;
+        }
+        float sorted[PROF_WINDOW];
+        memcpy(sorted, window[p], n * sizeof(float));
+        qsort(sorted, n, sizeof(float), compareFloat);
+        percentiles[p][0] = sorted[n / 2];
+        percentiles[p][1] = sorted[(n * 99) / 100];
+        percentiles[p][2] = sorted[n - 1];
+    }
+    percentilesFrame = frames;
+}
+
+void Prof_render(DrawList* list, int w, int h) {
+    if (frames - percentilesFrame >= PROF_OVERLAY_REFRESH || !percentilesFrame) {
+        Prof_percentiles();
+    }
+    float size = h / 30.f;
+    if (size < 10) {
+        size = 10;
+    }
+    float x = size / 2;
+    float y = size / 2;
+    DrawList_text(list, "PHASE        P50    P99    MAX MS", x, y, size,
+        DRAW_ALIGN_LEFT, DRAW_LIGHTGRAY);
+    for (int p = 0; p < PROF_PHASES; p++) {
+        if (windowCount[p] == 0) {
+            continue;
+        }
+        y += size * 1.2f;
+        DrawList_textf(list, x, y, size, DRAW_ALIGN_LEFT, DRAW_LIGHTGRAY,
+            "%-11s %6.2f %6.2f %6.2f", phaseNames[p],
+            percentiles[p][0], percentiles[p][1], percentiles[p][2]);
+    }
+}
+
+// Samples that never made it into the history
+static size_t Prof_dropped(void) {
+    size_t dropped = historyDropped;
+    for (int t = 0; t < PROF_THREADS; t++) {
+        dropped += atomic_load_explicit(&rings[t].dropped, memory_order_relaxed);
+    }
+    return dropped;
+}
+
+bool Prof_writeCsv(FILE* out) {
+    Prof_frame();
+    fprintf(out, "phase,start_us,duration_us\n");
+    for (size_t i = 0; i < historyCount; i++) {
+        const ProfSample* s = &history[i];
+        fprintf(out, "%s,%.3f,%.3f\n", phaseNames[s->phase],
+            (s->start - origin) * 1e-3, (s->end - s->start) * 1e-3);
+    }
+    if (Prof_dropped()) {
+        fprintf(stderr, "profile: %zu samples dropped\n", Prof_dropped());
+    }
+    return !ferror(out);
+}
+
+bool Prof_writeTrace(FILE* out) {
+    Prof_frame();
+    fprintf(out, "{\"traceEvents\":[\n");
+    fprintf(out,
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+        "\"args\":{\"name\":\"main\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+        "\"args\":{\"name\":\"audio\"}}",
+        PROF_MAIN, PROF_AUDIO_THREAD);
+    for (size_t i = 0; i < historyCount; i++) {
+        const ProfSample* s = &history[i];
+        fprintf(out,
+            ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            phaseNames[s->phase],
+            s->phase == PROF_AUDIO ? PROF_AUDIO_THREAD : PROF_MAIN,
+            (s->start - origin) * 1e-3, (s->end - s->start) * 1e-3);
+    }
+    fprintf(out, "\n],\"otherData\":{\"dropped\":%zu}}\n", Prof_dropped());
+    return !ferror(out);
+}
+
+#endif
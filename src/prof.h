@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "draw.h"
+
+// Frame time profiler
+// profile(phase, { ... }) times the block into a lock-free ring per thread,
+// which Prof_frame drains once a frame into a window of recent samples and
+// a log for export. Built with PONG_PROFILE (make PROFILE=1, the default),
+// otherwise every call compiles to nothing. Off until Prof_enable.
+
+enum ProfPhase {
+    PROF_FRAME,
+    PROF_GAME_UPDATE,
+    PROF_ROLLBACK, // ticks redone after a misprediction, inside game update
+    PROF_GAME_RENDER,
+    PROF_UI_UPDATE,
+    PROF_UI_RENDER,
+    PROF_SUBMIT,
+    PROF_PRESENT, // EndDrawing, includes the vsync and event wait
+    PROF_AUDIO, // audio thread
+    PROF_PHASES,
+};
+
+#define PROF_RING_SIZE 1024 // power of two, samples per thread between frames
+#define PROF_WINDOW 256 // samples per phase behind the overlay
+#define PROF_OVERLAY_REFRESH 15 // frames between overlay updates
+#define PROF_LOG_MAX (1 << 20) // samples kept for export
+
+#ifdef PONG_PROFILE
+
+typedef struct {
+    uint64_t start; // ns
+    uint64_t end;
+    uint32_t phase;
+} ProfSample;
+
+void Prof_enable(bool enabled);
+bool Prof_enabled(void);
+// 0 while disabled
+uint64_t Prof_begin(void);
+void Prof_end(enum ProfPhase phase, uint64_t start);
+
+#define profile(phase, ...) \
+    do { \
+        uint64_t profStart_ = Prof_begin(); \
+        __VA_ARGS__ \
+        Prof_end(phase, profStart_); \
+    } while (0)
+
+// Main thread, once a frame
+void Prof_frame(void);
+// p50, p99 and max of each phase over the last PROF_WINDOW samples
+void Prof_render(DrawList* list, int w, int h);
+// One row per sample: phase,start_us,duration_us
+bool Prof_writeCsv(FILE* out);
+// Chrome trace event JSON, open in chrome://tracing or Perfetto
+bool Prof_writeTrace(FILE* out);
+
+#else
+
+#define profile(phase, ...) do { __VA_ARGS__ } while (0)
+
+static inline void Prof_enable(bool enabled) { (void)enabled; }
+static inline bool Prof_enabled(void) { return false; }
+static inline uint64_t Prof_begin(void) { return 0; }
+static inline void Prof_end(enum ProfPhase phase, uint64_t start) {
+    (void)phase; (void)start;
+}
+static inline void Prof_frame(void) {}
+static inline void Prof_render(DrawList* list, int w, int h) {
+    (void)list; (void)w; (void)h;
+}
+static inline bool Prof_writeCsv(FILE* out) { (void)out; return false; }
+static inline bool Prof_writeTrace(FILE* out) { (void)out; return false; }
+
+#endif
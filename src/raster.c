@@ -0,0 +1,340 @@
+#include "raster.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#endif
+
+// 5x7 glyphs, one byte per row, bit 4 is the leftmost pixel
+// Lowercase letters draw as capitals, anything else as a space
+static const uint8_t font[][7] = {
+    ['0'] = { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },
+    ['1'] = { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },
+    ['2'] = { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },
+    ['3'] = { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },
+    ['4'] = { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },
+    ['5'] = { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },
+    ['6'] = { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },
+    ['7'] = { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+    ['8'] = { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },
+    ['9'] = { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },
+    ['A'] = { 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11 },
+    ['B'] = { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },
+    ['C'] = { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },
+    ['D'] = { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c },
+    ['E'] = { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },
+    ['F'] = { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 },
+    ['G'] = { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f },
+    ['H'] = { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },
+    ['I'] = { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },
+    ['J'] = { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c },
+    ['K'] = { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+    ['L'] = { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f },
+    ['M'] = { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 },
+    ['N'] = { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+    ['O'] = { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },
+    ['P'] = { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 },
+    ['Q'] = { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d },
+    ['R'] = { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },
+    ['S'] = { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },
+    ['T'] = { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+    ['U'] = { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },
+    ['V'] = { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 },
+    ['W'] = { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a },
+    ['X'] = { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 },
+    ['Y'] = { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 },
+    ['Z'] = { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f },
+    ['Z' + 1] = { 0 },
+};
+
+#define GLYPH_W 5
+#define GLYPH_H 7
+#define GLYPH_ADVANCE 6 // in font pixels, one column of spacing
+#define LINE_HEIGHT 10 // font size that draws font pixels 1:1
+#define GLYPH_COUNT ((int)(sizeof(font) / sizeof(font[0])))
+
+// Glyph rows baked into horizontal runs, so a row at any scale is at most
+// three span fills
+typedef struct {
+    uint8_t count;
+    uint8_t start[3];
+    uint8_t length[3];
+} GlyphRow;
+
+static GlyphRow atlas[GLYPH_COUNT][GLYPH_H];
+static bool atlasBaked = false;
+
+static void bakeAtlas(void) {
+    for (int g = 0; g < GLYPH_COUNT; g++) {
+        for (int row = 0; row < GLYPH_H; row++) {
+            GlyphRow* out = &atlas[g][row];
+            out->count = 0;
+            int col = 0;
+            while (col < GLYPH_W) {
+                if (!(font[g][row] >> (GLYPH_W - 1 - col) & 1)) {
+                    col++;
+                    continue;
+                }
+                int start = col;
+                while (col < GLYPH_W && font[g][row] >> (GLYPH_W - 1 - col) & 1) {
+                    col++;
+                }
+                out->start[out->count] = start;
+                out->length[out->count] = col - start;
+                out->count++;
+            }
+        }
+    }
+    atlasBaked = true;
+}
+
+static uint32_t packColor(DrawColor c) {
+    uint32_t p;
+    memcpy(&p, &c, sizeof(p));
+    return p;
+}
+
+typedef void (*SpanFill)(uint32_t* dst, size_t n, uint32_t color);
+
+static void fillSpanScalar(uint32_t* dst, size_t n, uint32_t color) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+#ifdef RASTER_X86
+
+__attribute__((target("avx2")))
+static void fillSpanAvx2(uint32_t* dst, size_t n, uint32_t color) {
+    __m256i c = _mm256_set1_epi32(color);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+    }
+    if (i < n) {
+        __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i mask = _mm256_cmpgt_epi32(
+            _mm256_set1_epi32((int)(n - i)), lane);
+        _mm256_maskstore_epi32((int*)(dst + i), mask, c);
+    }
+}
+
+#endif
+
+static SpanFill fillSpan = NULL;
+static const char* fillSpanName = NULL;
+
+static void selectKernel(void) {
+#ifdef RASTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fillSpan = fillSpanAvx2;
+        fillSpanName = "avx2";
+        return;
+    }
+#endif
+    fillSpan = fillSpanScalar;
+    fillSpanName = "scalar";
+}
+
+const char* Raster_kernel(void) {
+    if (!fillSpan) {
+        selectKernel();
+    }
+    return fillSpanName;
+}
+
+bool Raster_setKernel(const char* name) {
+    if (strcmp(name, "scalar") == 0) {
+        fillSpan = fillSpanScalar;
+        fillSpanName = "scalar";
+        return true;
+    }
+#ifdef RASTER_X86
+    if (strcmp(name, "avx2") == 0) {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) {
+            return false;
+        }
+        fillSpan = fillSpanAvx2;
+        fillSpanName = "avx2";
+        return true;
+    }
+#endif
+    return false;
+}
+
+Framebuffer Framebuffer_new(int w, int h) {
+    return (Framebuffer) {
+        .w = w,
+        .h = h,
+        .pixels = malloc((size_t)w * h * sizeof(uint32_t)),
+    };
+}
+
+void Framebuffer_del(Framebuffer* fb) {
+    free(fb->pixels);
+    *fb = (Framebuffer) { .pixels = NULL };
+}
+
+void Framebuffer_resize(Framebuffer* fb, int w, int h) {
+    if (fb->pixels && fb->w == w && fb->h == h) {
+        return;
+    }
+    free(fb->pixels);
+    *fb = Framebuffer_new(w, h);
+}
+
+void Framebuffer_clear(Framebuffer* fb, DrawColor color) {
+    if (!fillSpan) {
+        selectKernel();
+    }
+    fillSpan(fb->pixels, (size_t)fb->w * fb->h, packColor(color));
+}
+
+// Source over for translucent colors
+static void blendSpan(uint32_t* dst, size_t n, DrawColor color) {
+    unsigned a = color.a;
+    for (size_t i = 0; i < n; i++) {
+        DrawColor d;
+        memcpy(&d, &dst[i], sizeof(d));
+        d.r = (color.r * a + d.r * (255 - a) + 127) / 255;
+        d.g = (color.g * a + d.g * (255 - a) + 127) / 255;
+        d.b = (color.b * a + d.b * (255 - a) + 127) / 255;
+        d.a = a + (d.a * (255 - a) + 127) / 255;
+        memcpy(&dst[i], &d, sizeof(d));
+    }
+}
+
+// Pixel rect [x0, x1) x [y0, y1)
+static void Framebuffer_fill(
+    Framebuffer* fb, int x0, int y0, int x1, int y1, DrawColor color)
+{
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > fb->w ? fb->w : x1;
+    y1 = y1 > fb->h ? fb->h : y1;
+    if (x0 >= x1 || y0 >= y1 || color.a == 0) {
+        return;
+    }
+    if (!fillSpan) {
+        selectKernel();
+    }
+    uint32_t packed = packColor(color);
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = fb->pixels + (size_t)y * fb->w + x0;
+        if (color.a == 255) {
+            fillSpan(row, x1 - x0, packed);
+        } else {
+            blendSpan(row, x1 - x0, color);
+        }
+    }
+}
+
+void Framebuffer_rect(
+    Framebuffer* fb, float x, float y, float w, float h, DrawColor color)
+{
+    int x0 = floorf(x + 0.5f);
+    int y0 = floorf(y + 0.5f);
+    int x1 = floorf(x + w + 0.5f);
+    int y1 = floorf(y + h + 0.5f);
+    Framebuffer_fill(fb, x0, y0, x1, y1, color);
+}
+
+// Size of one font pixel in screen pixels
+static int fontScale(float size) {
+    int scale = floorf(size / LINE_HEIGHT + 0.5f);
+    return scale < 1 ? 1 : scale;
+}
+
+static int glyphIndex(char c) {
+    if (c >= 'a' && c <= 'z') {
+        c = c - 'a' + 'A';
+    }
+    int g = (unsigned char)c;
+    return g < GLYPH_COUNT ? g : ' ';
+}
+
+int Raster_measureText(const char* text, float size) {
+    size_t n = strlen(text);
+    return n ? (n * GLYPH_ADVANCE - 1) * fontScale(size) : 0;
+}
+
+void Framebuffer_text(
+    Framebuffer* fb, const char* text, float x, float y, float size,
+    DrawColor color)
+{
+    if (!atlasBaked) {
+        bakeAtlas();
+    }
+    int scale = fontScale(size);
+    int penX = floorf(x + 0.5f);
+    // glyphs sit in the middle of the line
+    int top = floorf(y + 0.5f) + (LINE_HEIGHT - GLYPH_H) / 2 * scale;
+    for (const char* c = text; *c; c++) {
+        const GlyphRow* rows = atlas[glyphIndex(*c)];
+        for (int row = 0; row < GLYPH_H; row++) {
+            int y0 = top + row * scale;
+            for (int r = 0; r < rows[row].count; r++) {
+                int x0 = penX + rows[row].start[r] * scale;
+                Framebuffer_fill(fb,
+                    x0, y0, x0 + rows[row].length[r] * scale, y0 + scale,
+                    color);
+            }
+        }
+        penX += GLYPH_ADVANCE * scale;
+    }
+}
+
+bool Framebuffer_writePpm(const Framebuffer* fb, FILE* out) {
+    if (fprintf(out, "P6\n%d %d\n255\n", fb->w, fb->h) < 0) {
+        return false;
+    }
+    uint8_t* row = malloc((size_t)fb->w * 3);
+    bool ok = true;
+    for (int y = 0; y < fb->h && ok; y++) {
+        const uint8_t* in = (const uint8_t*)(fb->pixels + (size_t)y * fb->w);
+        for (int x = 0; x < fb->w; x++) {
+            row[x * 3 + 0] = in[x * 4 + 0];
+            row[x * 3 + 1] = in[x * 4 + 1];
+            row[x * 3 + 2] = in[x * 4 + 2];
+        }
+        ok = fwrite(row, 3, fb->w, out) == (size_t)fb->w;
+    }
+    free(row);
+    return ok;
+}
+
+bool Framebuffer_writeRaw(const Framebuffer* fb, FILE* out) {
+    size_t n = (size_t)fb->w * fb->h;
+    return fwrite(fb->pixels, sizeof(uint32_t), n, out) == n;
+}
+
+static void rasterSubmit(
+    DrawBackend* backend, const DrawList* list, int w, int h)
+{
+    Framebuffer* fb = backend->data;
+    Framebuffer_resize(fb, w, h);
+    Framebuffer_clear(fb, DRAW_BLACK);
+    // layers are drawn inline, a cached copy would cost a full frame blend
+    for (size_t i = 0; i < list->count; i++) {
+        const DrawCommand* c = &list->commands[i];
+        if (c->type == DRAW_RECT) {
+            Framebuffer_rect(fb, c->x, c->y, c->w, c->h, c->color);
+        } else if (c->type == DRAW_TEXT) {
+            float x = c->x;
+            if (c->align != DRAW_ALIGN_LEFT) {
+                float width = Raster_measureText(c->text, c->h);
+                x -= c->align == DRAW_ALIGN_CENTER ? width / 2.f : width;
+            }
+            Framebuffer_text(fb, c->text, x, c->y, c->h, c->color);
+        }
+    }
+}
+
+DrawBackend DrawBackend_raster(Framebuffer* fb) {
+    return (DrawBackend) { .submit = rasterSubmit, .data = fb };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "draw.h"
+
+// Software rasterizer for DrawLists, no GL context needed
+// Rects are filled span by span, with AVX2 when the cpu has it. Text uses a
+// built in 5x7 font of digits and capitals scaled by whole pixels, so it
+// doesn't match raylib's font but is the same on every machine.
+
+// Pixels are RGBA bytes, row major, top row first
+typedef struct {
+    int w;
+    int h;
+    uint32_t* pixels;
+} Framebuffer;
+
+Framebuffer Framebuffer_new(int w, int h);
+void Framebuffer_del(Framebuffer* fb);
+// Keeps the buffer if the size is unchanged
+void Framebuffer_resize(Framebuffer* fb, int w, int h);
+
+void Framebuffer_clear(Framebuffer* fb, DrawColor color);
+// Edges round to the nearest pixel boundary, clipped to the framebuffer
+void Framebuffer_rect(
+    Framebuffer* fb, float x, float y, float w, float h, DrawColor color);
+// x is the left edge of the text, y the top of the line
+void Framebuffer_text(
+    Framebuffer* fb, const char* text, float x, float y, float size,
+    DrawColor color);
+// Width Framebuffer_text covers
+int Raster_measureText(const char* text, float size);
+
+// Binary PPM (P6), frames can be concatenated into a stream
+bool Framebuffer_writePpm(const Framebuffer* fb, FILE* out);
+// Plain RGBA rows, for ffmpeg -f rawvideo -pix_fmt rgba
+bool Framebuffer_writeRaw(const Framebuffer* fb, FILE* out);
+
+// "avx2" or "scalar"
+const char* Raster_kernel(void);
+bool Raster_setKernel(const char* name);
+
+// Clears to black and draws every submitted list into fb, resizing it to
+// the frame size
+DrawBackend DrawBackend_raster(Framebuffer* fb);
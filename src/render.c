@@ -0,0 +1,105 @@
+#include "render.h"
+
+void Player_render(DrawList* list, float paddles[2], int w, int h);
+void Ball_render(DrawList* list, Vec2 pos, int w, int h);
+
+// net and scores and additional stuff if have
+void renderNet(DrawList* list, int w, int h);
+void renderScores(
+    DrawList* list, uint32_t score0, uint32_t score1, int w, int h);
+
+GameView Game_view(const Game* game) {
+    return (GameView) {
+        .ball = game->ball.pos,
+        .paddles = { game->players[0].y, game->players[1].y },
+    };
+}
+
+void Game_draw(
+    DrawList* list, const Game* game, GameView view,
+    GameRenderComponents components, int w, int h)
+{
+    if (components.net || components.scores) {
+        uint64_t key =
+            components.net |
+            components.scores << 1 |
+            (uint64_t)game->players[0].score << 2 |
+            (uint64_t)game->players[1].score << 33;
+        DrawList_beginLayer(list, RENDER_LAYER_STATIC, key);
+        components.net ? renderNet(list, w, h) : 0;
+        components.scores ?
+            renderScores(list,
+                game->players[0].score, game->players[1].score, w, h) :
+            0;
+        DrawList_endLayer(list);
+    }
+    components.ball ? Ball_render(list, view.ball, w, h) : 0;
+    components.boards ? Player_render(list, view.paddles, w, h) : 0;
+}
+
+void Player_render(DrawList* list, float paddles[2], int w, int h) {
+    // center
+    int player0x = p0x * w;
+    int player0y = paddles[0] * h;
+    int player1x = p1x * w;
+    int player1y = paddles[1] * h;
+
+    int boardW = boardHalfWidth * 2 * w;
+    int boardH = boardHeight * h;
+
+    DrawList_rect(list,
+        player0x - boardW / 2, player0y - boardH / 2, boardW, boardH,
+        DRAW_WHITE);
+    DrawList_rect(list,
+        player1x - boardW / 2, player1y - boardH / 2, boardW, boardH,
+        DRAW_WHITE);
+}
+
+void Ball_render(DrawList* list, Vec2 pos, int w, int h) {
+    int x = pos.x * w;
+    int y = pos.y * h;
+    int width = ballWidth * w;
+    DrawList_rect(list,
+        x - width / 2, y - width / 2, width, width, DRAW_WHITE);
+}
+
+void renderNet(DrawList* list, int w, int h) {
+    for (float y = 0; y < h; y += (ballWidth * 2) * w) {
+        int x = (0.5 - ballWidth / 2) * w;
+        int width = ballWidth * w;
+        DrawList_rect(list, x, (int)y, width, width, DRAW_WHITE);
+    }
+}
+
+void renderScores(
+    DrawList* list, uint32_t score0, uint32_t score1, int w, int h)
+{
+    float fontSize = 0.13 * h;
+    DrawList_textf(list,
+        (0.5 - 0.1) * w, 0.1 * h, fontSize, DRAW_ALIGN_RIGHT, DRAW_WHITE,
+        "%u", score0);
+    DrawList_textf(list,
+        (0.5 + 0.1) * w, 0.1 * h, fontSize, DRAW_ALIGN_LEFT, DRAW_WHITE,
+        "%u", score1);
+}
+
+void Swarm_draw(DrawList* list, const Swarm* swarm, int w, int h) {
+    // net and scores, like Game_draw's key
+    uint64_t key =
+        3 | (uint64_t)swarm->scores[0] << 2 | (uint64_t)swarm->scores[1] << 33;
+    DrawList_beginLayer(list, RENDER_LAYER_STATIC, key);
+    renderNet(list, w, h);
+    renderScores(list, swarm->scores[0], swarm->scores[1], w, h);
+    DrawList_endLayer(list);
+
+    // at least a pixel, however many balls there are
+    float width = swarm->size * w;
+    width = width < 1 ? 1 : width;
+    for (size_t i = 0; i < swarm->count; i++) {
+        DrawList_rect(list,
+            swarm->x[i] * w - width / 2, swarm->y[i] * h - width / 2,
+            width, width, DRAW_WHITE);
+    }
+    float paddles[2] = { swarm->paddles[0], swarm->paddles[1] };
+    Player_render(list, paddles, w, h);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "draw.h"
+#include "sim.h"
+#include "swarm.h"
+
+// Playfield rendering into a DrawList, no raylib needed
+
+typedef struct {
+    bool boards;
+    bool scores;
+    bool ball;
+    bool net;
+} GameRenderComponents;
+
+static const GameRenderComponents GAME_RENDER_ALL = {
+    .boards = true,
+    .scores = true, 
+    .ball = true,
+    .net = true,
+};
+
+// What Game_render draws, blended between two ticks
+typedef struct {
+    Vec2 ball;
+    float paddles[2];
+} GameView;
+
+// Net and scores, redrawn by a caching backend on a point or a resize
+#define RENDER_LAYER_STATIC 0
+
+GameView Game_view(const Game* game);
+// Records the playfield as seen in view
+void Game_draw(
+    DrawList* list, const Game* game, GameView view,
+    GameRenderComponents components, int w, int h);
+// Arena mode, list needs room for a rect per ball
+void Swarm_draw(DrawList* list, const Swarm* swarm, int w, int h);
@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "raster.h"
+#include "render.h"
+#include "timing.h"
+
+// Records playfield frames of a headless match without a window
+// usage: render_bench [frames] [backend] [width] [height] [avx2|scalar]
+//   null    only records and counts, for measuring the render code
+//   text    prints every frame's commands, for golden frame diffs
+//   raster  draws into a framebuffer in memory
+//   ppm     streams rasterized frames to stdout as concatenated PPMs
+//   raw     streams rasterized frames to stdout as RGBA
+// e.g. to encode a match, as one shell command:
+//   render_bench 3600 raw |
+//   ffmpeg -f rawvideo -pix_fmt rgba -s 600x400 -r 60 -i - match.mp4
+
+int main(int argc, char** argv) {
+    long frames = argc > 1 ? atol(argv[1]) : 1000000;
+    const char* name = argc > 2 ? argv[2] : "null";
+    int w = argc > 3 ? atoi(argv[3]) : 600;
+    int h = argc > 4 ? atoi(argv[4]) : 400;
+    if (argc > 5 && !Raster_setKernel(argv[5])) {
+        fprintf(stderr, "kernel %s not available\n", argv[5]);
+        return 1;
+    }
+
+    bool ppm = strcmp(name, "ppm") == 0;
+    bool raw = strcmp(name, "raw") == 0;
+    bool quiet = ppm || raw || strcmp(name, "text") == 0;
+    Framebuffer fb = Framebuffer_new(w, h);
+    DrawBackend backend;
+    if (strcmp(name, "text") == 0) {
+        backend = DrawBackend_serializer(stdout);
+    } else if (ppm || raw || strcmp(name, "raster") == 0) {
+        backend = DrawBackend_raster(&fb);
+    } else if (strcmp(name, "null") == 0) {
+        backend = DrawBackend_null();
+    } else {
+        fprintf(stderr, "unknown backend %s\n", name);
+        return 1;
+    }
+
+    DrawList list = DrawList_new(DRAW_LIST_CAPACITY, DRAW_LIST_TEXT_BYTES);
+    Game game = Game_init(ONE_PLAYER, 1);
+    size_t commands = 0;
+    size_t dropped = 0;
+
+    double start = now();
+    for (long f = 0; f < frames; f++) {
+        if (game.ended) {
+            Game_del(&game);
+            game = Game_initMatch(ONE_PLAYER, 1, f);
+        }
+        GameInput input = { .dy = { 0, Game_followBall(&game, 1) } };
+        Game_step(&game, input, NULL);
+
+        DrawList_reset(&list);
+        Game_draw(&list, &game, Game_view(&game), GAME_RENDER_ALL, w, h);
+        DrawBackend_submit(&backend, &list, w, h);
+        if (ppm) {
+            Framebuffer_writePpm(&fb, stdout);
+        } else if (raw) {
+            Framebuffer_writeRaw(&fb, stdout);
+        }
+        commands += list.count;
+        dropped += list.dropped;
+    }
+    double elapsed = now() - start;
+
+    if (!quiet) {
+        printf("backend       %s", name);
+        if (strcmp(name, "raster") == 0) {
+            printf(", %s spans", Raster_kernel());
+        }
+        printf("\n");
+        printf("frames        %ld at %dx%d\n", frames, w, h);
+        printf("commands      %.1f per frame\n", (double)commands / frames);
+        printf("dropped       %zu\n", dropped);
+        printf("elapsed       %.3f s\n", elapsed);
+        printf("frames/s      %.0f\n", frames / elapsed);
+    }
+    Game_del(&game);
+    DrawBackend_del(&backend);
+    DrawList_del(&list);
+    Framebuffer_del(&fb);
+    return 0;
+}
@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+#include "replay.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Input symbol, 0 idle, 1 up, 2 down per paddle
+static int encodeInput(GameInput input) {
+    #define code(dy) ((dy) < 0 ? 1 : (dy) > 0 ? 2 : 0)
+    return code(input.dy[0]) + 3 * code(input.dy[1]);
+    #undef code
+}
+
+static GameInput decodeInput(int symbol) {
+    static const int8_t dy[3] = { 0, -1, 1 };
+    return (GameInput) { .dy = { dy[symbol % 3], dy[symbol / 3 % 3] } };
+}
+
+#define SYMBOL_BITS 4
+
+static void ReplayWriter_putBit(ReplayWriter* writer, int bit) {
+    if (writer->bitCount == writer->bitCapacity * 8) {
+        size_t capacity = writer->bitCapacity ? writer->bitCapacity * 2 : 256;
+        writer->bits = realloc(writer->bits, capacity);
+        memset(writer->bits + writer->bitCapacity, 0,
+            capacity - writer->bitCapacity);
+        writer->bitCapacity = capacity;
+    }
+    if (bit) {
+        writer->bits[writer->bitCount / 8] |= 1 << (writer->bitCount % 8);
+    }
+    writer->bitCount++;
+}
+
+// Elias gamma, n >= 1
+static void ReplayWriter_putGamma(ReplayWriter* writer, uint64_t n) {
+    int top = 63 - __builtin_clzll(n);
+    for (int i = 0; i < top; i++) {
+        ReplayWriter_putBit(writer, 0);
+    }
+    for (int i = top; i >= 0; i--) {
+        ReplayWriter_putBit(writer, n >> i & 1);
+    }
+}
+
+static void ReplayWriter_flushRun(ReplayWriter* writer) {
+    if (writer->runLength == 0) {
+        return;
+    }
+    for (int i = 0; i < SYMBOL_BITS; i++) {
+        ReplayWriter_putBit(writer, writer->runSymbol >> i & 1);
+    }
+    ReplayWriter_putGamma(writer, writer->runLength);
+    writer->runLength = 0;
+}
+
+bool ReplayWriter_open(
+    ReplayWriter* writer, const char* path, enum Mode mode, const Game* game)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    *writer = (ReplayWriter) {
+        .file = file,
+        .mode = mode,
+        .rng = game->rng,
+        .keyframeInterval = REPLAY_KEYFRAME_INTERVAL,
+        .tick = 0,
+        .runSymbol = -1,
+        .runLength = 0,
+    };
+    return true;
+}
+
+static void ReplayWriter_keyframe(ReplayWriter* writer, const Game* game) {
+    ReplayWriter_flushRun(writer);
+    if (writer->keyframeCount == writer->keyframeCapacity) {
+        writer->keyframeCapacity = writer->keyframeCapacity ?
+            writer->keyframeCapacity * 2 : 16;
+        writer->keyframes = realloc(writer->keyframes,
+            writer->keyframeCapacity * sizeof(*writer->keyframes));
+    }
+    ReplayKeyframe* keyframe = &writer->keyframes[writer->keyframeCount++];
+    memset(keyframe, 0, sizeof(*keyframe));
+    keyframe->tick = writer->tick;
+    keyframe->bitOffset = writer->bitCount;
+    keyframe->state = Game_snapshot(game);
+}
+
+void ReplayWriter_tick(
+    ReplayWriter* writer, const Game* game, GameInput input)
+{
+    if (writer->tick % writer->keyframeInterval == 0) {
+        ReplayWriter_keyframe(writer, game);
+    }
+
+    int symbol = encodeInput(input);
+    if (symbol != writer->runSymbol) {
+        ReplayWriter_flushRun(writer);
+        writer->runSymbol = symbol;
+    }
+    writer->runLength++;
+    writer->tick++;
+}
+
+bool ReplayWriter_close(ReplayWriter* writer, const Game* game) {
+    ReplayWriter_flushRun(writer);
+    if (writer->keyframeCount == 0) {
+        // quit before the first tick, game is still the tick 0 state
+        ReplayWriter_keyframe(writer, game);
+    }
+
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.mode = writer->mode;
+    header.keyframeInterval = writer->keyframeInterval;
+    header.seed = writer->rng.key;
+    header.matchId = writer->rng.stream;
+    header.tickCount = writer->tick;
+    header.keyframeCount = writer->keyframeCount;
+    header.inputBits = writer->bitCount;
+    header.final = Game_snapshot(game);
+
+    size_t bytes = (writer->bitCount + 7) / 8;
+    bool ok =
+        fwrite(&header, sizeof(header), 1, writer->file) == 1 &&
+        fwrite(writer->keyframes, sizeof(*writer->keyframes),
+            writer->keyframeCount, writer->file) == writer->keyframeCount &&
+        fwrite(writer->bits, 1, bytes, writer->file) == bytes;
+    ok = fclose(writer->file) == 0 && ok;
+
+    free(writer->bits);
+    free(writer->keyframes);
+    *writer = (ReplayWriter) { .file = NULL };
+    return ok;
+}
+
+bool Replay_open(Replay* replay, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ReplayHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    // sizes are checked before multiplying, a broken header can't wrap
+    const ReplayHeader* header = map;
+    size_t rest = st.st_size - sizeof(*header);
+    bool ok = memcmp(header->magic, REPLAY_MAGIC, sizeof(header->magic)) == 0 &&
+        header->keyframeInterval != 0 &&
+        header->keyframeCount != 0 &&
+        header->keyframeCount <= rest / sizeof(ReplayKeyframe);
+    size_t keyframesSize = 0;
+    if (ok) {
+        keyframesSize = header->keyframeCount * sizeof(ReplayKeyframe);
+        rest -= keyframesSize;
+        ok = header->inputBits / 8 + (header->inputBits % 8 != 0) <= rest;
+    }
+    const ReplayKeyframe* keyframes = (const ReplayKeyframe*)(header + 1);
+    for (uint64_t k = 0; ok && k < header->keyframeCount; k++) {
+        ok = keyframes[k].bitOffset <= header->inputBits;
+    }
+    if (!ok) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    *replay = (Replay) {
+        .map = map,
+        .size = st.st_size,
+        .header = header,
+        .keyframes = keyframes,
+        .bits = (const uint8_t*)(header + 1) + keyframesSize,
+    };
+    return true;
+}
+
+void Replay_close(Replay* replay) {
+    munmap(replay->map, replay->size);
+    *replay = (Replay) { .map = NULL };
+}
+
+static int Replay_getBit(Replay* replay) {
+    uint64_t pos = replay->bitPos++;
+    return replay->bits[pos / 8] >> (pos % 8) & 1;
+}
+
+static bool Replay_nextRun(Replay* replay) {
+    if (replay->bitPos + SYMBOL_BITS > replay->header->inputBits) {
+        return false;
+    }
+    int symbol = 0;
+    for (int i = 0; i < SYMBOL_BITS; i++) {
+        symbol |= Replay_getBit(replay) << i;
+    }
+    // Elias gamma, a length fits in 64 bits and the input ends after it
+    int zeros = 0;
+    for (;;) {
+        if (replay->bitPos >= replay->header->inputBits || zeros > 63) {
+            return false;
+        }
+        if (Replay_getBit(replay)) {
+            break;
+        }
+        zeros++;
+    }
+    if (replay->bitPos + zeros > replay->header->inputBits) {
+        return false;
+    }
+    uint64_t length = 1;
+    for (int i = 0; i < zeros; i++) {
+        length = length << 1 | Replay_getBit(replay);
+    }
+    replay->runSymbol = symbol;
+    replay->runLeft = length;
+    return true;
+}
+
+Game Replay_newGame(Replay* replay) {
+    const ReplayHeader* header = replay->header;
+    Game game = Game_initMatch(header->mode, header->seed, header->matchId);
+    Replay_seek(replay, &game, 0);
+    return game;
+}
+
+bool Replay_seek(Replay* replay, Game* game, uint64_t tick) {
+    if (tick > replay->header->tickCount) {
+        return false;
+    }
+    // keyframes are evenly spaced
+    uint64_t k = tick / replay->header->keyframeInterval;
+    k = k < replay->header->keyframeCount ? k : replay->header->keyframeCount - 1;
+    const ReplayKeyframe* keyframe = &replay->keyframes[k];
+
+    Game_restore(game, &keyframe->state);
+    replay->tick = keyframe->tick;
+    replay->bitPos = keyframe->bitOffset;
+    replay->runLeft = 0;
+    while (replay->tick < tick) {
+        if (!Replay_step(replay, game, NULL)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Replay_step(Replay* replay, Game* game, GameEvents* events) {
+    if (replay->tick >= replay->header->tickCount) {
+        return false;
+    }
+    if (replay->runLeft == 0 && !Replay_nextRun(replay)) {
+        return false;
+    }
+    Game_step(game, decodeInput(replay->runSymbol), events);
+    replay->runLeft--;
+    replay->tick++;
+    return true;
+}
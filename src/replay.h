@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdio.h>
+#include "sim.h"
+
+// Match replays
+//
+// File layout, native byte order:
+//   ReplayHeader
+//   ReplayKeyframe[keyframeCount]
+//   input stream, bit packed
+//
+// The input stream is a list of runs. A run is a 4 bit symbol for both
+// paddles' input followed by its length in ticks, Elias gamma coded. Idle
+// stretches compress to a few bytes. Each keyframe starts a new run, so
+// playback can restore the keyframe and decode from its bit offset.
+
+#define REPLAY_MAGIC "PONGRPL5"
+#define REPLAY_KEYFRAME_INTERVAL 600 // ticks, 10 s at 60 Hz
+
+typedef struct {
+    char magic[8];
+    uint32_t mode;
+    uint32_t keyframeInterval;
+    uint64_t seed;
+    uint64_t matchId;
+    uint64_t tickCount;
+    uint64_t keyframeCount;
+    uint64_t inputBits;
+    GameSnapshot final; // state after the last tick, for regression checks
+} ReplayHeader;
+
+typedef struct {
+    uint64_t tick;
+    uint64_t bitOffset;
+    GameSnapshot state; // before the tick is stepped
+} ReplayKeyframe;
+
+typedef struct {
+    FILE* file;
+    enum Mode mode;
+    Rng rng;
+    uint32_t keyframeInterval;
+    uint64_t tick;
+
+    uint8_t* bits;
+    size_t bitCount;
+    size_t bitCapacity;
+
+    ReplayKeyframe* keyframes;
+    size_t keyframeCount;
+    size_t keyframeCapacity;
+
+    int runSymbol; // -1 before the first tick
+    uint64_t runLength;
+} ReplayWriter;
+
+// Recording starts from game's current state
+bool ReplayWriter_open(
+    ReplayWriter* writer, const char* path, enum Mode mode, const Game* game);
+// Call before stepping game with input
+void ReplayWriter_tick(ReplayWriter* writer, const Game* game, GameInput input);
+// Writes the file, game is the state after the last tick
+bool ReplayWriter_close(ReplayWriter* writer, const Game* game);
+
+typedef struct {
+    void* map;
+    size_t size;
+    const ReplayHeader* header;
+    const ReplayKeyframe* keyframes;
+    const uint8_t* bits;
+
+    uint64_t tick;
+    uint64_t bitPos;
+    int runSymbol;
+    uint64_t runLeft;
+} Replay;
+
+bool Replay_open(Replay* replay, const char* path);
+void Replay_close(Replay* replay);
+// Game to play the replay with, at tick 0
+Game Replay_newGame(Replay* replay);
+// Restores the nearest keyframe at or before tick and steps up to tick
+bool Replay_seek(Replay* replay, Game* game, uint64_t tick);
+// Steps one tick, false once the replay is over
+bool Replay_step(Replay* replay, Game* game, GameEvents* events);
@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "replay.h"
+#include "timing.h"
+
+// Replay tool
+// usage:
+//   replay record FILE [seed]   record a headless cpu match
+//   replay info FILE
+//   replay seek FILE TICK       print the state at TICK
+//   replay check FILE...        play every replay to its end and compare the
+//                               final state with the recorded one
+
+void printGame(const Game* game) {
+    printf(
+        "score %u:%u, ball (%f, %f) vel (%f, %f), paddles %f %f\n",
+        game->players[0].score, game->players[1].score,
+        game->ball.pos.x, game->ball.pos.y,
+        game->ball.vel.x, game->ball.vel.y,
+        game->players[0].y, game->players[1].y);
+}
+
+int record(const char* path, uint64_t seed) {
+    Game game = Game_init(ONE_PLAYER, seed);
+    ReplayWriter writer;
+    if (!ReplayWriter_open(&writer, path, ONE_PLAYER, &game)) {
+        perror(path);
+        return 1;
+    }
+    while (!game.ended) {
+        GameInput input = { .dy = { 0, Game_followBall(&game, 1) } };
+        ReplayWriter_tick(&writer, &game, input);
+        Game_step(&game, input, NULL);
+    }
+    bool ok = ReplayWriter_close(&writer, &game);
+    printGame(&game);
+    Game_del(&game);
+    return ok ? 0 : 1;
+}
+
+int info(const char* path) {
+    Replay replay;
+    if (!Replay_open(&replay, path)) {
+        fprintf(stderr, "%s: not a replay\n", path);
+        return 1;
+    }
+    const ReplayHeader* h = replay.header;
+    double seconds = h->tickCount / 60.0;
+    printf("mode          %u\n", h->mode);
+    printf("seed          %llu, match %llu\n",
+        (unsigned long long)h->seed, (unsigned long long)h->matchId);
+    printf("ticks         %llu (%.1f s at 60 Hz)\n",
+        (unsigned long long)h->tickCount, seconds);
+    printf("keyframes     %llu every %u ticks\n",
+        (unsigned long long)h->keyframeCount, h->keyframeInterval);
+    printf("input stream  %llu bytes, %.2f bytes/s\n",
+        (unsigned long long)(h->inputBits + 7) / 8,
+        seconds > 0 ? (h->inputBits + 7) / 8 / seconds : 0);
+    printf("file          %zu bytes\n", replay.size);
+    printf("final score   %u:%u\n",
+        h->final.players[0].score, h->final.players[1].score);
+    Replay_close(&replay);
+    return 0;
+}
+
+int seek(const char* path, uint64_t tick) {
+    Replay replay;
+    if (!Replay_open(&replay, path)) {
+        fprintf(stderr, "%s: not a replay\n", path);
+        return 1;
+    }
+    Game game = Replay_newGame(&replay);
+    double start = now();
+    bool ok = Replay_seek(&replay, &game, tick);
+    double elapsed = now() - start;
+    if (ok) {
+        printf("tick %llu in %.3f ms: ", (unsigned long long)tick, elapsed * 1e3);
+        printGame(&game);
+    } else {
+        fprintf(stderr, "tick %llu is past the end\n", (unsigned long long)tick);
+    }
+    Game_del(&game);
+    Replay_close(&replay);
+    return ok ? 0 : 1;
+}
+
+int check(int count, char** paths) {
+    int failed = 0;
+    uint64_t ticks = 0;
+    double start = now();
+    for (int i = 0; i < count; i++) {
+        Replay replay;
+        if (!Replay_open(&replay, paths[i])) {
+            printf("FAIL %s: not a replay\n", paths[i]);
+            failed++;
+            continue;
+        }
+        Game game = Replay_newGame(&replay);
+        while (Replay_step(&replay, &game, NULL)) {
+        }
+        ticks += replay.tick;
+
+        bool same =
+            replay.tick == replay.header->tickCount &&
+            Game_hash(&game) == Game_hash(&replay.header->final);
+        if (!same) {
+            printf("FAIL %s: diverged, ", paths[i]);
+            printGame(&game);
+            failed++;
+        }
+        Game_del(&game);
+        Replay_close(&replay);
+    }
+    double elapsed = now() - start;
+    printf(
+        "%d/%d replays match, %llu ticks in %.3f s, %.0fx real time\n",
+        count - failed, count, (unsigned long long)ticks, elapsed,
+        ticks / 60.0 / elapsed);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+        return record(argv[2], argc > 3 ? strtoull(argv[3], NULL, 0) : 1);
+    } else if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return info(argv[2]);
+    } else if (argc == 4 && strcmp(argv[1], "seek") == 0) {
+        return seek(argv[2], strtoull(argv[3], NULL, 0));
+    } else if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+        return check(argc - 2, argv + 2);
+    }
+    fprintf(stderr,
+        "usage: replay record FILE [seed] | info FILE | seek FILE TICK | "
+        "check FILE...\n");
+    return 1;
+}
@@ -0,0 +1,139 @@
+#include "rng.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RNG_X86 1
+#endif
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+Rng Rng_init(uint64_t seed, uint64_t stream) {
+    return (Rng) { .key = seed, .stream = stream, .counter = 0 };
+}
+
+void Rng_skip(Rng* rng, uint64_t draws) {
+    rng->counter += draws;
+}
+
+void Rng_philox(
+    uint64_t key, uint64_t stream, uint64_t counter, uint32_t out[4])
+{
+    uint32_t c0 = counter;
+    uint32_t c1 = counter >> 32;
+    uint32_t c2 = stream;
+    uint32_t c3 = stream >> 32;
+    uint32_t k0 = key;
+    uint32_t k1 = key >> 32;
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n1 = (uint32_t)p1;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        uint32_t n3 = (uint32_t)p0;
+        c0 = n0;
+        c1 = n1;
+        c2 = n2;
+        c3 = n3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+uint32_t Rng_next(Rng* rng) {
+    uint32_t block[4];
+    Rng_philox(rng->key, rng->stream, rng->counter++, block);
+    return block[0];
+}
+
+static void Rng_nextBatchScalar(Rng* rngs, size_t n, uint32_t* out) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = Rng_next(&rngs[i]);
+    }
+}
+
+#ifdef RNG_X86
+
+// 8 lanes of 32x32 -> 64 bit products, split into high and low words
+__attribute__((target("avx2")))
+static inline void mulhilo8(__m256i a, __m256i m, __m256i* hi, __m256i* lo) {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+__attribute__((target("avx2")))
+static void Rng_nextBatchAvx2(Rng* rngs, size_t n, uint32_t* out) {
+    const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+    const __m256i w0 = _mm256_set1_epi32(PHILOX_W0);
+    const __m256i w1 = _mm256_set1_epi32(PHILOX_W1);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t lanes[6][8];
+        for (int l = 0; l < 8; l++) {
+            Rng* rng = &rngs[i + l];
+            lanes[0][l] = rng->counter;
+            lanes[1][l] = rng->counter >> 32;
+            lanes[2][l] = rng->stream;
+            lanes[3][l] = rng->stream >> 32;
+            lanes[4][l] = rng->key;
+            lanes[5][l] = rng->key >> 32;
+            rng->counter++;
+        }
+        __m256i c0 = _mm256_loadu_si256((const __m256i*)lanes[0]);
+        __m256i c1 = _mm256_loadu_si256((const __m256i*)lanes[1]);
+        __m256i c2 = _mm256_loadu_si256((const __m256i*)lanes[2]);
+        __m256i c3 = _mm256_loadu_si256((const __m256i*)lanes[3]);
+        __m256i k0 = _mm256_loadu_si256((const __m256i*)lanes[4]);
+        __m256i k1 = _mm256_loadu_si256((const __m256i*)lanes[5]);
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+            __m256i hi0, lo0, hi1, lo1;
+            mulhilo8(c0, m0, &hi0, &lo0);
+            mulhilo8(c2, m1, &hi1, &lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), k0);
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), k1);
+            c3 = lo0;
+            k0 = _mm256_add_epi32(k0, w0);
+            k1 = _mm256_add_epi32(k1, w1);
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), c0);
+    }
+    Rng_nextBatchScalar(rngs + i, n - i, out + i);
+}
+
+#endif
+
+#ifdef RNG_X86
+static int hasAvx2 = 0;
+static pthread_once_t detected = PTHREAD_ONCE_INIT;
+
+static void detectAvx2(void) {
+    __builtin_cpu_init();
+    hasAvx2 = __builtin_cpu_supports("avx2");
+}
+#endif
+
+void Rng_nextBatch(Rng* rngs, size_t n, uint32_t* out) {
+#ifdef RNG_X86
+    // batch workers get here first all at once
+    pthread_once(&detected, detectAvx2);
+    if (hasAvx2) {
+        Rng_nextBatchAvx2(rngs, n, out);
+        return;
+    }
+#endif
+    Rng_nextBatchScalar(rngs, n, out);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Counter-based random numbers, Philox4x32-10
+// A draw is a pure function of (key, stream, counter), so every match owns
+// an independent stream, can skip ahead in O(1) and gives the same numbers
+// no matter which thread steps it or in what order.
+
+typedef struct {
+    uint64_t key; // seed
+    uint64_t stream; // match id
+    uint64_t counter; // draws taken so far
+} Rng;
+
+Rng Rng_init(uint64_t seed, uint64_t stream);
+void Rng_skip(Rng* rng, uint64_t draws);
+
+// Full 128 bit block for one counter value
+void Rng_philox(uint64_t key, uint64_t stream, uint64_t counter, uint32_t out[4]);
+
+uint32_t Rng_next(Rng* rng);
+// Same draw for n generators at once, out[i] comes from rngs[i]
+// Vectorized with AVX2 when the cpu has it
+void Rng_nextBatch(Rng* rngs, size_t n, uint32_t* out);
+
+// Maps a draw onto [min, max] by multiply and shift, no division
+static inline int Rng_rangeOf(uint32_t draw, int min, int max) {
+    uint64_t span = (uint64_t)(max - min) + 1;
+    return min + (int)((draw * span) >> 32);
+}
+
+// Same contract as raylib's GetRandomValue, min and max inclusive
+static inline int Rng_range(Rng* rng, int min, int max) {
+    return Rng_rangeOf(Rng_next(rng), min, max);
+}
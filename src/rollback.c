@@ -0,0 +1,105 @@
+#include "rollback.h"
+
+#define slot(tick) ((tick) & (ROLLBACK_RING - 1))
+
+void Rollback_init(Rollback* rollback, int local) {
+    *rollback = (Rollback) {
+        .local = local,
+        .tick = 0,
+        .confirmed = 0,
+        .rollbackTo = UINT32_MAX,
+    };
+}
+
+// Remote inputs can arrive ahead of our own tick
+bool Rollback_canStep(const Rollback* rollback) {
+    return (int32_t)(rollback->tick - rollback->confirmed) < ROLLBACK_MAX_TICKS;
+}
+
+// The remote paddle keeps doing what it was last seen doing
+static int8_t Rollback_predict(const Rollback* rollback) {
+    int remote = 1 - rollback->local;
+    return rollback->confirmed ?
+        rollback->inputs[slot(rollback->confirmed - 1)][remote] :
+        0;
+}
+
+void Rollback_remote(Rollback* rollback, uint32_t tick, int8_t dy) {
+    // ticks past tick + ROLLBACK_RING would overwrite unconfirmed ones, the
+    // sender can't be that far ahead since it runs at most as far ahead of us
+    if (tick != rollback->confirmed || (tick > rollback->tick &&
+        tick - rollback->tick + ROLLBACK_MAX_TICKS >= ROLLBACK_RING))
+    {
+        return;
+    }
+    int remote = 1 - rollback->local;
+    int8_t* input = &rollback->inputs[slot(tick)][remote];
+    if (tick < rollback->tick && *input != dy &&
+        tick < rollback->rollbackTo)
+    {
+        rollback->rollbackTo = tick;
+    }
+    *input = dy;
+    rollback->confirmed++;
+}
+
+static void Rollback_simulate(
+    Rollback* rollback, Game* game, uint32_t tick, GameEvents* events)
+{
+    rollback->states[slot(tick)] = Game_snapshot(game);
+    if (tick >= rollback->confirmed) {
+        rollback->inputs[slot(tick)][1 - rollback->local] =
+            Rollback_predict(rollback);
+    }
+    int8_t* dy = rollback->inputs[slot(tick)];
+    GameInput input = { .dy = { dy[0], dy[1] } };
+    Game_step(game, input, events);
+}
+
+int Rollback_correct(Rollback* rollback, Game* game) {
+    uint32_t from = rollback->rollbackTo;
+    if (from == UINT32_MAX) {
+        return 0;
+    }
+    rollback->rollbackTo = UINT32_MAX;
+    Game_restore(game, &rollback->states[slot(from)]);
+    // sounds of the first run already played
+    for (uint32_t tick = from; tick < rollback->tick; tick++) {
+        Rollback_simulate(rollback, game, tick, NULL);
+    }
+    int depth = rollback->tick - from;
+    rollback->rollbacks++;
+    rollback->resimulated += depth;
+    if ((uint32_t)depth > rollback->maxDepth) {
+        rollback->maxDepth = depth;
+    }
+    return depth;
+}
+
+void Rollback_step(
+    Rollback* rollback, Game* game, int8_t dy, GameEvents* events)
+{
+    rollback->inputs[slot(rollback->tick)][rollback->local] = dy;
+    Rollback_simulate(rollback, game, rollback->tick, events);
+    rollback->tick++;
+}
+
+bool Rollback_settled(const Rollback* rollback) {
+    return rollback->confirmed >= rollback->tick &&
+        rollback->rollbackTo == UINT32_MAX;
+}
+
+int8_t Rollback_localInput(const Rollback* rollback, uint32_t tick) {
+    return rollback->inputs[slot(tick)][rollback->local];
+}
+
+bool Rollback_hash(const Rollback* rollback, uint32_t tick, uint64_t* hash) {
+    // a pending rollback before tick leaves its state stale
+    if (tick > rollback->confirmed || tick >= rollback->tick ||
+        rollback->tick - tick > ROLLBACK_RING || tick >= rollback->rollbackTo)
+    {
+        return false;
+    }
+    *hash = Game_hash(&rollback->states[slot(tick)]);
+    return true;
+}
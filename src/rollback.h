@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sim.h"
+
+// Rollback for two player matches where the other paddle is remote
+// The local paddle never waits for the network. Until the remote input for
+// a tick arrives it is predicted to repeat the last confirmed one. When a
+// confirmed input differs from its prediction, the game is restored to the
+// state before that tick and every tick since is simulated again.
+
+#define ROLLBACK_MAX_TICKS 16 // furthest ahead of the remote inputs we run
+#define ROLLBACK_RING 32 // power of two, > ROLLBACK_MAX_TICKS
+
+typedef struct {
+    int local; // paddle this side controls
+    uint32_t tick; // next tick to simulate
+    uint32_t confirmed; // remote inputs are known for ticks below this
+    uint32_t rollbackTo; // earliest mispredicted tick, UINT32_MAX if none
+    int8_t inputs[ROLLBACK_RING][2]; // per tick, remote ones maybe predicted
+    GameSnapshot states[ROLLBACK_RING]; // before each tick
+
+    uint64_t rollbacks;
+    uint64_t resimulated; // ticks simulated again
+    uint32_t maxDepth; // most ticks one rollback redid
+} Rollback;
+
+void Rollback_init(Rollback* rollback, int local);
+// False while ROLLBACK_MAX_TICKS ahead of the remote inputs
+bool Rollback_canStep(const Rollback* rollback);
+// Remote input for tick, must come in order, earlier ticks are ignored
+void Rollback_remote(Rollback* rollback, uint32_t tick, int8_t dy);
+// Redoes the ticks since the earliest misprediction, returns how many
+int Rollback_correct(Rollback* rollback, Game* game);
+// Steps the next tick with the local input, call Rollback_correct first
+void Rollback_step(
+    Rollback* rollback, Game* game, int8_t dy, GameEvents* events);
+// Every simulated tick used confirmed inputs only
+bool Rollback_settled(const Rollback* rollback);
+// Local input of an already stepped tick, for sending
+int8_t Rollback_localInput(const Rollback* rollback, uint32_t tick);
+// Game_hash of the state before tick, false unless every input before it
+// is confirmed and the state is still in the ring
+bool Rollback_hash(const Rollback* rollback, uint32_t tick, uint64_t* hash);
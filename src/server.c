@@ -0,0 +1,747 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+#include "udp.h"
+#include "timing.h"
+
+#define SERVER_TICK_SIZE 34 // of a 'T' packet
+#define SERVER_RECV_BATCH 256 // datagrams per recvmmsg
+#define SERVER_COST_DECAY 0.05 // of a shard's cost per match estimate
+
+// Epoll data of a shard's descriptors
+enum { SERVER_SOCKET, SERVER_TIMER, SERVER_WAKE };
+
+typedef struct {
+    uint32_t id; // 0 for a free slot
+    _Alignas(8) uint8_t addrs[2][16]; // sockaddr_in, zeroed until heard
+    uint64_t tokens[2]; // each player's, from its 'A' packet
+    double heard[2];
+    uint64_t endedAt; // shard tick, 0 while playing
+} ServerMatch;
+
+// A match the lobby placed and the shard hasn't started yet
+typedef struct {
+    uint16_t slot;
+    uint32_t id;
+    uint64_t tokens[2];
+} ServerPlacement;
+
+typedef struct {
+    Server* server;
+    int index;
+    int fd;
+    int port;
+    int epoll;
+    int timer;
+    int wake; // eventfd, the lobby placed matches
+    pthread_t thread;
+
+    GameBatch batch; // a lane per slot, free ones ended
+    GameInput* inputs;
+    ServerMatch* matches;
+    uint64_t tick;
+    uint8_t* packets; // SERVER_TICK_SIZE per slot
+    struct iovec* iovs; // per slot
+    struct mmsghdr* messages; // two per slot
+    uint16_t* freed; // slots freed by a tick
+
+    // shared with the lobby
+    pthread_mutex_t lock;
+    uint16_t* freeSlots;
+    size_t freeCount;
+    ServerPlacement* inbox;
+    size_t inboxCount;
+    double cost; // cpu seconds of tick per match, 0 until measured
+    ServerShardStats stats;
+    double tickSum; // seconds, over the interval
+    uint32_t histogram[SERVER_HISTOGRAM];
+} ServerShard;
+
+// A client that joined, by address
+typedef struct {
+    uint64_t key; // 0 for an empty entry
+    uint32_t nonce;
+    double at; // last join
+    int shard; // -1 while waiting for an opponent
+    uint16_t slot;
+    uint32_t id;
+    uint8_t side;
+    uint64_t token;
+} ServerJoin;
+
+struct Server {
+    ServerConfig config;
+    int fd; // lobby
+    int epoll;
+    _Atomic bool stopping;
+    ServerShard* shards;
+    int shardCount;
+
+    ServerJoin* joins; // open addressing on the key
+    size_t joinCount;
+    size_t joinSize; // power of two
+    uint64_t waiting; // key of the client without an opponent, 0 for none
+    uint32_t nextId;
+    double swept;
+};
+
+static int openSocket(int port, int* bound) {
+    int fd = Udp_open(port, bound);
+    if (fd >= 0) {
+        // a tick's states leave in one burst
+        Udp_setBuffers(fd, 1 << 22);
+    }
+    return fd;
+}
+
+static void addEpoll(int epoll, int fd, uint32_t data) {
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = data };
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+static bool ServerShard_open(ServerShard* shard, Server* server, int index) {
+    size_t capacity = server->config.capacity;
+    shard->server = server;
+    shard->index = index;
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->fd = openSocket(0, &shard->port);
+    shard->epoll = epoll_create1(0);
+    shard->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    shard->wake = eventfd(0, EFD_NONBLOCK);
+    if (shard->fd < 0 || shard->epoll < 0 || shard->timer < 0 ||
+        shard->wake < 0)
+    {
+        return false;
+    }
+    addEpoll(shard->epoll, shard->fd, SERVER_SOCKET);
+    addEpoll(shard->epoll, shard->timer, SERVER_TIMER);
+    addEpoll(shard->epoll, shard->wake, SERVER_WAKE);
+
+    shard->batch = GameBatch_init(capacity, TWO_PLAYERS, server->config.seed);
+    for (size_t i = 0; i < capacity; i++) {
+        // free slots don't move
+        shard->batch.ended[i] = UINT32_MAX;
+    }
+    shard->inputs = calloc(capacity, sizeof(GameInput));
+    shard->matches = calloc(capacity, sizeof(ServerMatch));
+    shard->packets = calloc(capacity, SERVER_TICK_SIZE);
+    shard->iovs = calloc(capacity, sizeof(struct iovec));
+    shard->messages = calloc(capacity * 2, sizeof(struct mmsghdr));
+    shard->freed = malloc(capacity * sizeof(uint16_t));
+    shard->freeSlots = malloc(capacity * sizeof(uint16_t));
+    shard->inbox = malloc(capacity * sizeof(ServerPlacement));
+    if (!shard->inputs || !shard->matches || !shard->packets ||
+        !shard->iovs || !shard->messages || !shard->freed ||
+        !shard->freeSlots || !shard->inbox)
+    {
+        return false;
+    }
+    // lowest slots first
+    for (size_t i = 0; i < capacity; i++) {
+        shard->freeSlots[i] = capacity - 1 - i;
+        shard->iovs[i] = (struct iovec) {
+            .iov_base = shard->packets + i * SERVER_TICK_SIZE,
+            .iov_len = SERVER_TICK_SIZE,
+        };
+    }
+    shard->freeCount = capacity;
+    shard->stats.capacity = capacity;
+    return true;
+}
+
+static void ServerShard_close(ServerShard* shard) {
+    int fds[] = { shard->fd, shard->epoll, shard->timer, shard->wake };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(*fds); i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    GameBatch_del(&shard->batch);
+    free(shard->inputs);
+    free(shard->matches);
+    free(shard->packets);
+    free(shard->iovs);
+    free(shard->messages);
+    free(shard->freed);
+    free(shard->freeSlots);
+    free(shard->inbox);
+    pthread_mutex_destroy(&shard->lock);
+}
+
+// Starts the matches the lobby placed
+static void ServerShard_admit(ServerShard* shard, double time) {
+    uint64_t value;
+    while (read(shard->wake, &value, sizeof(value)) > 0) {
+    }
+    pthread_mutex_lock(&shard->lock);
+    for (size_t i = 0; i < shard->inboxCount; i++) {
+        ServerPlacement placed = shard->inbox[i];
+        shard->matches[placed.slot] = (ServerMatch) {
+            .id = placed.id,
+            .tokens = { placed.tokens[0], placed.tokens[1] },
+            .heard = { time, time },
+            .endedAt = 0,
+        };
+        shard->inputs[placed.slot] = GAME_INPUT_IDLE;
+        GameBatch_reset(&shard->batch, placed.slot,
+            shard->server->config.seed, placed.id);
+        shard->stats.started++;
+    }
+    shard->inboxCount = 0;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+// Reads every waiting input
+static void ServerShard_receive(ServerShard* shard, double time) {
+    uint8_t data[SERVER_RECV_BATCH][SERVER_PACKET_MAX];
+    _Alignas(8) uint8_t names[SERVER_RECV_BATCH][sizeof(struct sockaddr_in)];
+    struct iovec iovs[SERVER_RECV_BATCH];
+    struct mmsghdr messages[SERVER_RECV_BATCH];
+    size_t capacity = shard->server->config.capacity;
+    uint64_t received = 0;
+    for (;;) {
+        for (int i = 0; i < SERVER_RECV_BATCH; i++) {
+            iovs[i] = (struct iovec) {
+                .iov_base = data[i],
+                .iov_len = SERVER_PACKET_MAX,
+            };
+            messages[i] = (struct mmsghdr) {
+                .msg_hdr = {
+                    .msg_name = names[i],
+                    .msg_namelen = sizeof(names[i]),
+                    .msg_iov = &iovs[i],
+                    .msg_iovlen = 1,
+                },
+            };
+        }
+        int count = recvmmsg(
+            shard->fd, messages, SERVER_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (count <= 0) {
+            break;
+        }
+        received += count;
+        for (int i = 0; i < count; i++) {
+            const uint8_t* p = data[i];
+            if (messages[i].msg_len < 21 ||
+                memcmp(p, SERVER_MAGIC, 4) != 0 || p[4] != 'I' ||
+                messages[i].msg_hdr.msg_namelen != sizeof(names[i]))
+            {
+                continue;
+            }
+            uint16_t slot = get16(p + 5);
+            uint32_t id = get32(p + 7);
+            uint8_t side = p[11];
+            int8_t dy = p[12];
+            if (slot >= capacity || side > 1 ||
+                shard->matches[slot].id != id || id == 0)
+            {
+                continue;
+            }
+            ServerMatch* match = &shard->matches[slot];
+            if (get64(p + 13) != match->tokens[side]) {
+                continue;
+            }
+            // the side belongs to the first address heard with its token
+            struct sockaddr_in* bound = (struct sockaddr_in*)match->addrs[side];
+            const struct sockaddr_in* from =
+                (const struct sockaddr_in*)names[i];
+            if (bound->sin_family != AF_INET) {
+                memcpy(bound, from, sizeof(*bound));
+            } else if (bound->sin_port != from->sin_port ||
+                bound->sin_addr.s_addr != from->sin_addr.s_addr)
+            {
+                continue;
+            }
+            match->heard[side] = time;
+            shard->inputs[slot].dy[side] = dy < 0 ? -1 : dy > 0;
+        }
+        if (count < SERVER_RECV_BATCH) {
+            break;
+        }
+    }
+    pthread_mutex_lock(&shard->lock);
+    shard->stats.received += received;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static void ServerShard_encode(
+    const ServerShard* shard, size_t slot, uint8_t* p)
+{
+    const GameBatch* batch = &shard->batch;
+    memcpy(p, SERVER_MAGIC, 4);
+    p[4] = 'T';
+    put16(p + 5, slot);
+    put32(p + 7, shard->matches[slot].id);
+    put32(p + 11, shard->tick);
+    putFloat(p + 15, batch->ballX[slot]);
+    putFloat(p + 19, batch->ballY[slot]);
+    putFloat(p + 23, batch->p0y[slot]);
+    putFloat(p + 27, batch->p1y[slot]);
+    p[31] = batch->score0[slot];
+    p[32] = batch->score1[slot];
+    p[33] = batch->ended[slot] != 0;
+}
+
+// Steps every match, sends their states and frees the finished ones
+static void ServerShard_tick(
+    ServerShard* shard, uint64_t expirations, double time)
+{
+    double start = now();
+    double cpuStart = threadCpu();
+    uint64_t run =
+        expirations < SERVER_CATCH_UP ? expirations : SERVER_CATCH_UP;
+    for (uint64_t r = 0; r < run; r++) {
+        GameBatch_step(&shard->batch, shard->inputs);
+    }
+    shard->tick += run;
+
+    size_t capacity = shard->server->config.capacity;
+    size_t count = 0;
+    size_t matches = 0;
+    uint64_t finished = 0;
+    uint64_t timedOut = 0;
+    size_t freedCount = 0;
+    for (size_t slot = 0; slot < capacity; slot++) {
+        ServerMatch* match = &shard->matches[slot];
+        if (!match->id) {
+            continue;
+        }
+        if (shard->batch.ended[slot] && !match->endedAt) {
+            match->endedAt = shard->tick;
+            finished++;
+        }
+        double heard = match->heard[0] > match->heard[1] ?
+            match->heard[0] : match->heard[1];
+        bool silent = time - heard > SERVER_TIMEOUT;
+        if (silent ||
+            (match->endedAt && shard->tick - match->endedAt > SERVER_LINGER))
+        {
+            timedOut += silent && !match->endedAt;
+            match->id = 0;
+            shard->batch.ended[slot] = UINT32_MAX;
+            shard->freed[freedCount++] = slot;
+            continue;
+        }
+        matches++;
+        ServerShard_encode(
+            shard, slot, shard->packets + slot * SERVER_TICK_SIZE);
+        for (int side = 0; side < 2; side++) {
+            const struct sockaddr_in* addr =
+                (const struct sockaddr_in*)match->addrs[side];
+            if (addr->sin_family != AF_INET) {
+                continue;
+            }
+            shard->messages[count++] = (struct mmsghdr) {
+                .msg_hdr = {
+                    .msg_name = match->addrs[side],
+                    .msg_namelen = sizeof(struct sockaddr_in),
+                    .msg_iov = &shard->iovs[slot],
+                    .msg_iovlen = 1,
+                },
+            };
+        }
+    }
+    uint64_t failed = Udp_sendAll(shard->fd, shard->messages, count);
+
+    double elapsed = now() - start;
+    double cpu = threadCpu() - cpuStart;
+    size_t bucket = elapsed / SERVER_BUCKET;
+    bucket = bucket < SERVER_HISTOGRAM ? bucket : SERVER_HISTOGRAM - 1;
+    pthread_mutex_lock(&shard->lock);
+    // back to the lobby in one go
+    for (size_t i = 0; i < freedCount; i++) {
+        shard->freeSlots[shard->freeCount++] = shard->freed[i];
+    }
+    ServerShardStats* stats = &shard->stats;
+    stats->ticks += run;
+    stats->late += expirations - 1;
+    stats->skipped += expirations - run;
+    stats->sent += count - failed;
+    stats->failed += failed;
+    stats->finished += finished;
+    stats->timedOut += timedOut;
+    stats->interval++;
+    stats->max = elapsed > stats->max ? elapsed : stats->max;
+    shard->tickSum += elapsed;
+    shard->histogram[bucket]++;
+    if (matches) {
+        // cpu time, placement shouldn't chase a preemption
+        double perMatch = cpu / matches;
+        shard->cost = shard->cost ?
+            shard->cost + (perMatch - shard->cost) * SERVER_COST_DECAY :
+            perMatch;
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static void* ServerShard_run(void* arg) {
+    ServerShard* shard = arg;
+    Server* server = shard->server;
+    if (server->config.pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->index % sysconf(_SC_NPROCESSORS_ONLN), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    struct itimerspec period = {
+        .it_interval.tv_nsec = 1000000000 / SERVER_TICK_RATE,
+        .it_value.tv_nsec = 1000000000 / SERVER_TICK_RATE,
+    };
+    timerfd_settime(shard->timer, 0, &period, NULL);
+    while (!atomic_load(&server->stopping)) {
+        struct epoll_event events[3];
+        int ready = epoll_wait(shard->epoll, events, 3, 100);
+        bool readable = false;
+        bool woken = false;
+        uint64_t expirations = 0;
+        for (int i = 0; i < ready; i++) {
+            switch (events[i].data.u32) {
+            case SERVER_SOCKET:
+                readable = true;
+                break;
+            case SERVER_WAKE:
+                woken = true;
+                break;
+            case SERVER_TIMER:
+                if (read(shard->timer, &expirations, sizeof(expirations)) !=
+                    sizeof(expirations))
+                {
+                    expirations = 0;
+                }
+                break;
+            }
+        }
+        // placements and inputs first, so the tick sees them
+        double time = now();
+        if (woken) {
+            ServerShard_admit(shard, time);
+        }
+        if (readable) {
+            ServerShard_receive(shard, time);
+        }
+        if (expirations) {
+            ServerShard_tick(shard, expirations, time);
+        }
+    }
+    return NULL;
+}
+
+static uint64_t addressKey(const uint8_t* addr) {
+    const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+    return (uint64_t)in->sin_addr.s_addr << 16 | in->sin_port | 1ull << 48;
+}
+
+static size_t joinSlot(const Server* server, uint64_t key) {
+    return (key * 0x9E3779B97F4A7C15ull >> 32) & (server->joinSize - 1);
+}
+
+static ServerJoin* Server_findJoin(Server* server, uint64_t key) {
+    size_t slot = joinSlot(server, key);
+    while (server->joins[slot].key && server->joins[slot].key != key) {
+        slot = (slot + 1) & (server->joinSize - 1);
+    }
+    return &server->joins[slot];
+}
+
+// Keeps the joins heard from within SERVER_JOIN_TTL in a table of size
+static bool Server_rehash(Server* server, size_t size, double time) {
+    ServerJoin* joins = calloc(size, sizeof(ServerJoin));
+    if (!joins) {
+        return false;
+    }
+    ServerJoin* old = server->joins;
+    size_t oldSize = server->joinSize;
+    server->joins = joins;
+    server->joinSize = size;
+    server->joinCount = 0;
+    for (size_t i = 0; i < oldSize; i++) {
+        if (old[i].key && time - old[i].at < SERVER_JOIN_TTL) {
+            *Server_findJoin(server, old[i].key) = old[i];
+            server->joinCount++;
+        }
+    }
+    free(old);
+    return true;
+}
+
+// The shard whose tick is predicted to stay shortest with one more match,
+// from its measured cost per match. -1 when every shard is full.
+static int Server_place(Server* server) {
+    // shards that haven't ticked a match yet cost the average
+    double known = 0;
+    int measured = 0;
+    for (int s = 0; s < server->shardCount; s++) {
+        ServerShard* shard = &server->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        known += shard->cost;
+        measured += shard->cost > 0;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    double fallback = measured ? known / measured : 1;
+    int best = -1;
+    double bestLoad = 0;
+    for (int s = 0; s < server->shardCount; s++) {
+        ServerShard* shard = &server->shards[s];
+        pthread_mutex_lock(&shard->lock);
+        // placed but not started yet count too
+        size_t matches = server->config.capacity - shard->freeCount;
+        bool full = shard->freeCount == 0;
+        double cost = shard->cost > 0 ? shard->cost : fallback;
+        pthread_mutex_unlock(&shard->lock);
+        double load = (matches + 1) * cost;
+        if (!full && (best < 0 || load < bestLoad)) {
+            best = s;
+            bestLoad = load;
+        }
+    }
+    return best;
+}
+
+static void Server_assign(Server* server, const ServerJoin* join) {
+    const ServerShard* shard = &server->shards[join->shard];
+    uint8_t data[26];
+    memcpy(data, SERVER_MAGIC, 4);
+    data[4] = 'A';
+    put32(data + 5, join->nonce);
+    put16(data + 9, shard->port);
+    put16(data + 11, join->slot);
+    put32(data + 13, join->id);
+    data[17] = join->side;
+    put64(data + 18, join->token);
+    struct sockaddr_in to = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = join->key >> 16,
+        .sin_port = join->key,
+    };
+    sendto(server->fd, data, sizeof(data), 0,
+        (struct sockaddr*)&to, sizeof(to));
+}
+
+// Starts a match between the two on the least loaded shard
+static void Server_pair(Server* server, ServerJoin* a, ServerJoin* b) {
+    int s = Server_place(server);
+    if (s < 0) {
+        // full, they keep retrying
+        return;
+    }
+    // ids are sequential, the tokens keep others off the paddles
+    uint64_t tokens[2];
+    if (getrandom(tokens, sizeof(tokens), 0) != sizeof(tokens)) {
+        perror("getrandom");
+        return;
+    }
+    ServerShard* shard = &server->shards[s];
+    uint32_t id = ++server->nextId ? server->nextId : ++server->nextId;
+    pthread_mutex_lock(&shard->lock);
+    uint16_t slot = shard->freeSlots[--shard->freeCount];
+    shard->inbox[shard->inboxCount++] = (ServerPlacement) {
+        .slot = slot,
+        .id = id,
+        .tokens = { tokens[0], tokens[1] },
+    };
+    pthread_mutex_unlock(&shard->lock);
+    uint64_t one = 1;
+    if (write(shard->wake, &one, sizeof(one)) < 0) {
+        perror("eventfd");
+    }
+    ServerJoin* sides[2] = { a, b };
+    for (int side = 0; side < 2; side++) {
+        sides[side]->shard = s;
+        sides[side]->slot = slot;
+        sides[side]->id = id;
+        sides[side]->side = side;
+        sides[side]->token = tokens[side];
+        Server_assign(server, sides[side]);
+    }
+    server->waiting = 0;
+}
+
+static void Server_join(
+    Server* server, const uint8_t* from, uint32_t nonce, double time)
+{
+    if (server->joinCount + 1 > server->joinSize / 2 &&
+        !Server_rehash(server, server->joinSize * 2, time))
+    {
+        return;
+    }
+    uint64_t key = addressKey(from);
+    ServerJoin* join = Server_findJoin(server, key);
+    if (join->key == key && join->nonce == nonce) {
+        join->at = time;
+        if (join->shard >= 0) {
+            // the assignment was lost
+            Server_assign(server, join);
+            return;
+        }
+    } else {
+        if (!join->key) {
+            server->joinCount++;
+        }
+        *join = (ServerJoin) {
+            .key = key,
+            .nonce = nonce,
+            .at = time,
+            .shard = -1,
+        };
+    }
+    if (server->waiting == key) {
+        return;
+    }
+    ServerJoin* other = NULL;
+    if (server->waiting) {
+        other = Server_findJoin(server, server->waiting);
+        // gone if it stopped retrying
+        if (other->key != server->waiting || other->shard >= 0 ||
+            time - other->at > 2 * SERVER_JOIN_RETRY)
+        {
+            other = NULL;
+        }
+    }
+    if (other) {
+        Server_pair(server, other, join);
+    } else {
+        server->waiting = key;
+    }
+}
+
+Server* Server_new(ServerConfig config) {
+    if (config.shards <= 0) {
+        config.shards = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    // slots are 16 bit in packets
+    if (config.capacity == 0 || config.capacity > UINT16_MAX) {
+        fprintf(stderr, "capacity must be 1 to %d\n", UINT16_MAX);
+        return NULL;
+    }
+    Server* server = calloc(1, sizeof(Server));
+    server->config = config;
+    server->epoll = -1;
+    server->shardCount = config.shards;
+    server->shards = calloc(config.shards, sizeof(ServerShard));
+    server->joinSize = 1024;
+    server->joins = calloc(server->joinSize, sizeof(ServerJoin));
+    server->swept = now();
+    int port;
+    server->fd = openSocket(config.port, &port);
+    server->epoll = epoll_create1(0);
+    bool ok = server->fd >= 0 && server->epoll >= 0 && server->joins;
+    if (ok) {
+        addEpoll(server->epoll, server->fd, SERVER_SOCKET);
+    }
+    int opened = 0;
+    for (; ok && opened < config.shards; opened++) {
+        ok = ServerShard_open(&server->shards[opened], server, opened);
+    }
+    if (!ok) {
+        server->shardCount = opened;
+        Server_del(server);
+        return NULL;
+    }
+    for (int s = 0; s < config.shards; s++) {
+        pthread_create(&server->shards[s].thread, NULL, ServerShard_run,
+            &server->shards[s]);
+    }
+    return server;
+}
+
+void Server_serve(Server* server) {
+    while (!atomic_load(&server->stopping)) {
+        struct epoll_event event;
+        int ready = epoll_wait(server->epoll, &event, 1, 100);
+        double time = now();
+        for (; ready > 0;) {
+            uint8_t data[SERVER_PACKET_MAX];
+            _Alignas(8) uint8_t from[sizeof(struct sockaddr_in)];
+            socklen_t fromSize = sizeof(from);
+            ssize_t size = recvfrom(server->fd, data, sizeof(data), 0,
+                (struct sockaddr*)from, &fromSize);
+            if (size < 0) {
+                break;
+            }
+            if (size >= 9 && memcmp(data, SERVER_MAGIC, 4) == 0 &&
+                data[4] == 'J' && fromSize == sizeof(from))
+            {
+                Server_join(server, from, get32(data + 5), time);
+            }
+        }
+        if (time - server->swept >= SERVER_JOIN_TTL) {
+            // forget old joins, shrinking once most are gone
+            size_t size = server->joinSize;
+            while (size > 1024 && server->joinCount * 8 < size) {
+                size /= 2;
+            }
+            Server_rehash(server, size, time);
+            server->swept = time;
+        }
+    }
+}
+
+void Server_stop(Server* server) {
+    // async signal safe, everything polls the flag at least every 100 ms
+    atomic_store(&server->stopping, true);
+}
+
+void Server_del(Server* server) {
+    Server_stop(server);
+    for (int s = 0; s < server->shardCount; s++) {
+        if (server->shards[s].thread) {
+            pthread_join(server->shards[s].thread, NULL);
+        }
+        ServerShard_close(&server->shards[s]);
+    }
+    if (server->fd >= 0) {
+        close(server->fd);
+    }
+    if (server->epoll >= 0) {
+        close(server->epoll);
+    }
+    free(server->shards);
+    free(server->joins);
+    free(server);
+}
+
+int Server_shards(const Server* server) {
+    return server->shardCount;
+}
+
+ServerShardStats Server_stats(Server* server, int index) {
+    ServerShard* shard = &server->shards[index];
+    pthread_mutex_lock(&shard->lock);
+    ServerShardStats stats = shard->stats;
+    stats.matches = stats.capacity - shard->freeCount;
+    stats.cost = shard->cost;
+    stats.mean = stats.interval ? shard->tickSum / stats.interval : 0;
+    // upper edges of the buckets the percentiles fall in
+    uint64_t seen = 0;
+    for (size_t b = 0; b < SERVER_HISTOGRAM && stats.interval; b++) {
+        uint64_t before = seen;
+        seen += shard->histogram[b];
+        if (before * 2 < stats.interval && seen * 2 >= stats.interval) {
+            stats.p50 = (b + 1) * SERVER_BUCKET;
+        }
+        if (before * 100 < stats.interval * 99 &&
+            seen * 100 >= stats.interval * 99)
+        {
+            stats.p99 = (b + 1) * SERVER_BUCKET;
+        }
+    }
+    shard->stats.interval = 0;
+    shard->stats.max = 0;
+    shard->tickSum = 0;
+    memset(shard->histogram, 0, sizeof(shard->histogram));
+    pthread_mutex_unlock(&shard->lock);
+    return stats;
+}
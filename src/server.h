@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sim.h"
+
+// Headless two player match server over UDP, IPv4
+// Clients join through the lobby socket, which pairs them and places the
+// match on the least loaded shard. A shard is a thread with its own epoll
+// loop, socket and tick timer. Its matches live in one GameBatch and all
+// of them are stepped in one pass each tick, then every player is sent
+// the new state with sendmmsg. The server is authoritative: a player
+// sends its paddle input when it changes, at least every
+// SERVER_KEEPALIVE, and the latest one is held until the next.
+//
+// Packets, little endian, after the 4 byte magic and a type byte:
+//   'J' join      nonce u32, any value, new for every match wanted. Sent
+//                 every SERVER_JOIN_RETRY until assigned.
+//   'A' assigned  nonce u32, shard port u16, slot u16, match id u32,
+//                 side u8, token u64. The lobby answers repeated joins
+//                 with the same assignment until SERVER_JOIN_TTL.
+//   'I' input     slot u16, match id u32, side u8, dy i8, token u64, to
+//                 the shard. The token is random and only sent to the
+//                 player, and the first address heard with it owns the
+//                 side for the rest of the match, others are ignored.
+//   'T' tick      slot u16, match id u32, tick u32, ballX f32, ballY f32,
+//                 paddle0 f32, paddle1 f32, score0 u8, score1 u8,
+//                 ended u8, from the shard to both players every tick
+// A match is dropped once both players were silent for SERVER_TIMEOUT,
+// or SERVER_LINGER ticks after it ended.
+
+#define SERVER_MAGIC "PMS2"
+#define SERVER_TICK_RATE 60
+#define SERVER_PACKET_MAX 64
+#define SERVER_TIMEOUT 5.0 // seconds
+#define SERVER_KEEPALIVE 1.0 // seconds between a player's inputs at most
+#define SERVER_JOIN_RETRY 0.5 // seconds between a client's joins
+#define SERVER_JOIN_TTL 10.0 // seconds an assignment is remembered
+#define SERVER_LINGER 30 // ticks the final state is sent
+#define SERVER_CATCH_UP 4 // ticks run back to back at most after a stall
+#define SERVER_HISTOGRAM 2000 // tick time buckets
+#define SERVER_BUCKET 10e-6 // seconds per bucket, the last one holds more
+
+// Tick times of one shard since the last Server_stats, and totals
+typedef struct {
+    size_t matches; // now
+    size_t capacity;
+    uint64_t ticks;
+    uint64_t late; // timer expirations the shard was too busy for
+    uint64_t skipped; // ticks dropped past SERVER_CATCH_UP
+    uint64_t received;
+    uint64_t sent; // datagrams
+    uint64_t failed; // sends the kernel refused
+    uint64_t started; // matches
+    uint64_t finished;
+    uint64_t timedOut;
+    double mean; // seconds per tick, over the interval
+    double p50;
+    double p99;
+    double max;
+    double cost; // cpu seconds of a tick per match, what placement uses
+    uint64_t interval; // ticks in the interval
+} ServerShardStats;
+
+typedef struct {
+    int port; // of the lobby, the shards take any free ones
+    int shards; // threads, one per online cpu if <= 0
+    size_t capacity; // matches per shard
+    uint64_t seed; // match m plays rng stream m
+    bool pin; // pin shard i to cpu i
+} ServerConfig;
+
+typedef struct Server Server;
+
+// Binds every socket and starts the shards, NULL on failure
+Server* Server_new(ServerConfig config);
+// Runs the lobby until Server_stop, from any thread or a signal handler
+void Server_serve(Server* server);
+void Server_stop(Server* server);
+// Stops the shards and closes every socket
+void Server_del(Server* server);
+int Server_shards(const Server* server);
+// Copies shard's counters and starts its next interval
+ServerShardStats Server_stats(Server* server, int shard);
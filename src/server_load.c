@@ -0,0 +1,384 @@
+#define _GNU_SOURCE
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "server.h"
+#include "udp.h"
+#include "timing.h"
+
+// Plays many clients against a match server over loopback
+// Every client has its own socket, joins, follows the ball with a random
+// aim that misses now and then, and joins again once its match ended.
+// Without --server a server runs in this process and its shards' tick
+// times are printed every second, with the worst of every shard at the
+// end. Clients report the ticks they got and stalls, gaps of more than
+// LOAD_STALL between two ticks of a match.
+//
+// usage: server_load [options]
+//   --clients N        clients, two per match (2000)
+//   --seconds S        length (10)
+//   --threads N        client threads (1)
+//   --server HOST:PORT lobby to load, instead of one in this process
+//   --port PORT        lobby port of the server in this process (7900)
+//   --shards N         its shards, 0 for one per cpu (0)
+//   --capacity N       its matches per shard (2048)
+
+#define LOAD_SEED 1
+#define LOAD_STALL 0.1 // seconds
+#define LOAD_SWEEP 0.1 // seconds between retries and keepalives
+
+typedef struct {
+    int fd;
+    bool playing;
+    uint32_t nonce;
+    double sentAt; // last join or input
+    double joinedAt; // first join for this match
+    double heardAt; // last tick
+    _Alignas(8) uint8_t shard[16]; // sockaddr_in
+    uint16_t slot;
+    uint32_t id;
+    uint8_t side;
+    uint64_t token;
+    int8_t dy;
+    float aim; // offset from the ball, new every point
+    uint8_t scores[2];
+} Client;
+
+typedef struct {
+    const uint8_t* lobby; // sockaddr_in
+    Client* clients;
+    size_t count;
+    _Atomic bool* done;
+    Rng rng;
+
+    uint64_t ticks;
+    uint64_t stalls;
+    uint64_t matches; // played to the end
+    uint64_t joins;
+    uint64_t rejoins; // after the match went silent
+    double joinTime; // total
+    double joinMax;
+} LoadThread;
+
+static void Client_join(Client* client, const LoadThread* thread, double time) {
+    uint8_t data[9];
+    memcpy(data, SERVER_MAGIC, 4);
+    data[4] = 'J';
+    put32(data + 5, client->nonce);
+    sendto(client->fd, data, sizeof(data), 0,
+        (const struct sockaddr*)thread->lobby, sizeof(struct sockaddr_in));
+    client->sentAt = time;
+}
+
+static void Client_rejoin(Client* client, LoadThread* thread, double time) {
+    client->playing = false;
+    client->nonce = Rng_next(&thread->rng);
+    client->joinedAt = time;
+    Client_join(client, thread, time);
+}
+
+static void Client_input(Client* client, double time) {
+    uint8_t data[21];
+    memcpy(data, SERVER_MAGIC, 4);
+    data[4] = 'I';
+    put16(data + 5, client->slot);
+    put32(data + 7, client->id);
+    data[11] = client->side;
+    data[12] = client->dy;
+    put64(data + 13, client->token);
+    sendto(client->fd, data, sizeof(data), 0,
+        (const struct sockaddr*)client->shard, sizeof(struct sockaddr_in));
+    client->sentAt = time;
+}
+
+static void Client_newAim(Client* client, LoadThread* thread) {
+    // wider than the paddle, so some points are lost
+    client->aim = (Rng_next(&thread->rng) / 4294967296.0f * 2 - 1) *
+        boardHeight;
+}
+
+static void Client_receive(
+    Client* client, LoadThread* thread, const uint8_t* data, int size,
+    double time)
+{
+    if (size < 5 || memcmp(data, SERVER_MAGIC, 4) != 0) {
+        return;
+    }
+    if (data[4] == 'A' && size >= 26 && !client->playing &&
+        get32(data + 5) == client->nonce)
+    {
+        client->playing = true;
+        memcpy(client->shard, thread->lobby, sizeof(client->shard));
+        ((struct sockaddr_in*)client->shard)->sin_port =
+            htons(get16(data + 9));
+        client->slot = get16(data + 11);
+        client->id = get32(data + 13);
+        client->side = data[17];
+        client->token = get64(data + 18);
+        client->dy = 0;
+        client->scores[0] = client->scores[1] = 0;
+        Client_newAim(client, thread);
+        client->heardAt = time;
+        double waited = time - client->joinedAt;
+        thread->joins++;
+        thread->joinTime += waited;
+        thread->joinMax = waited > thread->joinMax ? waited : thread->joinMax;
+        // the shard only sends to players it heard from
+        Client_input(client, time);
+        return;
+    }
+    if (data[4] != 'T' || size < 34 || !client->playing ||
+        get16(data + 5) != client->slot || get32(data + 7) != client->id)
+    {
+        return;
+    }
+    thread->ticks++;
+    if (time - client->heardAt > LOAD_STALL) {
+        thread->stalls++;
+    }
+    client->heardAt = time;
+    if (data[33]) {
+        thread->matches++;
+        Client_rejoin(client, thread, time);
+        return;
+    }
+    if (data[31] != client->scores[0] || data[32] != client->scores[1]) {
+        client->scores[0] = data[31];
+        client->scores[1] = data[32];
+        Client_newAim(client, thread);
+    }
+    float ballY = getFloat(data + 19);
+    float paddle = getFloat(data + 23 + 4 * client->side);
+    float dy = ballY + client->aim - paddle;
+    int8_t move = dy < -pdy ? -1 : dy > pdy ? 1 : 0;
+    if (move != client->dy || time - client->sentAt >= SERVER_KEEPALIVE / 2) {
+        client->dy = move;
+        Client_input(client, time);
+    }
+}
+
+static void* LoadThread_run(void* arg) {
+    LoadThread* thread = arg;
+    int epoll = epoll_create1(0);
+    double start = now();
+    for (size_t i = 0; i < thread->count; i++) {
+        Client* client = &thread->clients[i];
+        struct epoll_event event = { .events = EPOLLIN, .data.u64 = i };
+        epoll_ctl(epoll, EPOLL_CTL_ADD, client->fd, &event);
+        Client_rejoin(client, thread, start);
+    }
+    double swept = start;
+    struct epoll_event events[256];
+    while (!atomic_load(thread->done)) {
+        int ready = epoll_wait(epoll, events, 256, 10);
+        double time = now();
+        for (int e = 0; e < ready; e++) {
+            Client* client = &thread->clients[events[e].data.u64];
+            uint8_t data[SERVER_PACKET_MAX];
+            ssize_t size;
+            while ((size = recv(client->fd, data, sizeof(data), 0)) >= 0) {
+                Client_receive(client, thread, data, size, time);
+            }
+        }
+        if (time - swept < LOAD_SWEEP) {
+            continue;
+        }
+        for (size_t i = 0; i < thread->count; i++) {
+            Client* client = &thread->clients[i];
+            if (!client->playing) {
+                if (time - client->sentAt >= SERVER_JOIN_RETRY) {
+                    Client_join(client, thread, time);
+                }
+            } else if (time - client->heardAt > SERVER_TIMEOUT) {
+                // the server dropped the match
+                thread->rejoins++;
+                Client_rejoin(client, thread, time);
+            } else if (time - client->sentAt >= SERVER_KEEPALIVE / 2) {
+                // also covers a first input that was lost
+                Client_input(client, time);
+            }
+        }
+        swept = time;
+    }
+    close(epoll);
+    return NULL;
+}
+
+static void* serve(void* server) {
+    Server_serve(server);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    size_t count = 2000;
+    double seconds = 10;
+    int threads = 1;
+    const char* address = NULL;
+    ServerConfig config = {
+        .port = 7900,
+        .shards = 0,
+        .capacity = 2048,
+        .seed = LOAD_SEED,
+        .pin = false,
+    };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--clients") == 0) {
+            count = strtoull(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--server") == 0) {
+            address = argv[i + 1];
+        } else if (strcmp(argv[i], "--port") == 0) {
+            config.port = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--shards") == 0) {
+            config.shards = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--capacity") == 0) {
+            config.capacity = strtoull(argv[i + 1], NULL, 0);
+        }
+    }
+    threads = threads > 0 ? threads : 1;
+
+    // a socket per client
+    struct rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    if (files.rlim_cur < count + 256 && files.rlim_max > files.rlim_cur) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    if (count + 256 > files.rlim_cur) {
+        count = files.rlim_cur > 256 ? files.rlim_cur - 256 : 2;
+        printf("only %zu clients fit the open file limit\n", count);
+    }
+
+    Server* server = NULL;
+    pthread_t lobby;
+    char local[32];
+    if (!address) {
+        server = Server_new(config);
+        if (!server) {
+            return 1;
+        }
+        pthread_create(&lobby, NULL, serve, server);
+        snprintf(local, sizeof(local), "127.0.0.1:%d", config.port);
+        address = local;
+    }
+    _Alignas(8) uint8_t lobbyAddr[UDP_ADDR_SIZE];
+    if (!Udp_resolve(address, lobbyAddr)) {
+        return 1;
+    }
+
+    Client* clients = calloc(count, sizeof(Client));
+    for (size_t i = 0; i < count; i++) {
+        clients[i].fd = Udp_open(0, NULL);
+        if (clients[i].fd < 0) {
+            return 1;
+        }
+    }
+    _Atomic bool done = false;
+    LoadThread* loads = calloc(threads, sizeof(LoadThread));
+    pthread_t* ids = calloc(threads, sizeof(pthread_t));
+    for (int t = 0; t < threads; t++) {
+        size_t first = count * t / threads;
+        loads[t] = (LoadThread) {
+            .lobby = lobbyAddr,
+            .clients = clients + first,
+            .count = count * (t + 1) / threads - first,
+            .done = &done,
+            .rng = Rng_init(LOAD_SEED, t),
+        };
+        pthread_create(&ids[t], NULL, LoadThread_run, &loads[t]);
+    }
+
+    int shards = server ? Server_shards(server) : 0;
+    ServerShardStats* worst = calloc(shards ? shards : 1, sizeof(*worst));
+    double start = now();
+    for (int second = 1; second <= seconds; second++) {
+        struct timespec until = {
+            .tv_sec = (time_t)(start + second),
+            .tv_nsec = (start + second - (time_t)(start + second)) * 1e9,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+        if (!server) {
+            continue;
+        }
+        printf("%3d s", second);
+        for (int s = 0; s < shards; s++) {
+            ServerShardStats stats = Server_stats(server, s);
+            printf("  [%d] %zu p99 %.2f", s, stats.matches, stats.p99 * 1000);
+            // the first second fills up
+            if (second > 1 && stats.p99 > worst[s].p99) {
+                worst[s].p99 = stats.p99;
+            }
+            if (second > 1 && stats.max > worst[s].max) {
+                worst[s].max = stats.max;
+            }
+            worst[s].matches = stats.matches;
+            worst[s].ticks = stats.ticks;
+            worst[s].late = stats.late;
+            worst[s].started = stats.started;
+            worst[s].failed = stats.failed;
+            worst[s].cost = stats.cost;
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    atomic_store(&done, true);
+    double elapsed = now() - start;
+    LoadThread total = { .joinMax = 0 };
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        total.ticks += loads[t].ticks;
+        total.stalls += loads[t].stalls;
+        total.matches += loads[t].matches;
+        total.joins += loads[t].joins;
+        total.rejoins += loads[t].rejoins;
+        total.joinTime += loads[t].joinTime;
+        if (loads[t].joinMax > total.joinMax) {
+            total.joinMax = loads[t].joinMax;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        close(clients[i].fd);
+    }
+
+    printf("clients       %zu on %d threads, %.1f s\n",
+        count, threads, elapsed);
+    printf("joins         %llu, waited %.1f ms on average, %.1f at most, "
+        "%llu matches finished, %llu dropped by the server\n",
+        (unsigned long long)total.joins,
+        total.joins ? total.joinTime / total.joins * 1000 : 0.0,
+        total.joinMax * 1000, (unsigned long long)total.matches,
+        (unsigned long long)total.rejoins);
+    printf("ticks         %.1f per client per second of %d, %llu stalls\n",
+        total.ticks / (double)count / elapsed, SERVER_TICK_RATE,
+        (unsigned long long)total.stalls);
+    for (int s = 0; s < shards; s++) {
+        printf("shard %2d      %zu matches, %llu started, %llu ticks, "
+            "%llu late, %llu sends failed, worst p99 %.2f ms, max %.2f ms, "
+            "%.1f us of cpu per match\n",
+            s, worst[s].matches, (unsigned long long)worst[s].started,
+            (unsigned long long)worst[s].ticks,
+            (unsigned long long)worst[s].late,
+            (unsigned long long)worst[s].failed,
+            worst[s].p99 * 1000, worst[s].max * 1000, worst[s].cost * 1e6);
+    }
+    if (server) {
+        Server_stop(server);
+        pthread_join(lobby, NULL);
+        Server_del(server);
+    }
+    free(worst);
+    free(loads);
+    free(ids);
+    free(clients);
+    return 0;
+}
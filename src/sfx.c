@@ -0,0 +1,220 @@
+#include "sfx.h"
+#include "bundle.h"
+#include "prof.h"
+#include <pthread.h>
+#include <raylib.h>
+#include <string.h>
+
+// raylib mixes float stereo (AUDIO_DEVICE_CHANNELS)
+#define SFX_CHANNELS 2
+
+typedef struct {
+    char path[256];
+    int refs; // 0 for a free slot
+    bool mapped; // samples point into the bundle
+    AudioClip clip;
+} SfxEntry;
+
+static SfxEntry entries[SFX_CACHE_SIZE];
+static AudioMixer mixer;
+static unsigned int sampleRate = 0;
+static bool attached = false;
+static SfxStats stats;
+static Bundle bundle = { .map = NULL };
+static pthread_t opener;
+static bool opening = false;
+static _Atomic bool openDone = false;
+static const char* const* preloads;
+static size_t preloadCount = 0;
+static const AudioClip* preloaded[SFX_CACHE_SIZE]; // released by Sfx_close
+
+static void processSfx(void* buffer, unsigned int frames) {
+    profile(PROF_AUDIO, {
+        AudioMixer_process(&mixer, buffer, frames, SFX_CHANNELS);
+    });
+}
+
+bool Sfx_mapBundle(const char* path) {
+    if (!Bundle_open(&bundle, path)) {
+        TraceLog(LOG_WARNING, "SFX: no bundle at %s, decoding files", path);
+        return false;
+    }
+    // the audio thread mustn't wait on the disk for a first play
+    Bundle_prefault(&bundle);
+    return true;
+}
+
+void Sfx_open(void) {
+    AudioMixer_init(&mixer);
+    // raylib converts sounds to the device rate, so a loaded one tells it
+    float silence = 0;
+    Wave wave = {
+        .frameCount = 1,
+        .sampleRate = 44100,
+        .sampleSize = 32,
+        .channels = 1,
+        .data = &silence,
+    };
+    Sound probe = LoadSoundFromWave(wave);
+    sampleRate = probe.stream.sampleRate;
+    UnloadSound(probe);
+    AttachAudioMixedProcessor(processSfx);
+    attached = true;
+}
+
+static void* Sfx_openThread(void* bundlePath) {
+    double start = GetTime();
+    if (bundlePath) {
+        Sfx_mapBundle(bundlePath);
+    }
+    InitAudioDevice();
+    Sfx_open();
+    for (size_t i = 0; i < preloadCount; i++) {
+        preloaded[i] = Sfx_acquire(preloads[i]);
+    }
+    stats.openTime = GetTime() - start;
+    atomic_store(&openDone, true);
+    return NULL;
+}
+
+void Sfx_openAsync(
+    const char* bundlePath, const char* const* preload, size_t count)
+{
+    preloads = preload;
+    preloadCount = count < SFX_CACHE_SIZE ? count : SFX_CACHE_SIZE;
+    opening = pthread_create(
+        &opener, NULL, Sfx_openThread, (void*)bundlePath) == 0;
+    if (!opening) {
+        Sfx_openThread((void*)bundlePath);
+    }
+}
+
+bool Sfx_opened(void) {
+    if (opening && atomic_load(&openDone)) {
+        pthread_join(opener, NULL);
+        opening = false;
+    }
+    return !opening && attached;
+}
+
+void Sfx_close(void) {
+    if (opening) {
+        pthread_join(opener, NULL);
+        opening = false;
+    }
+    for (size_t i = 0; i < preloadCount; i++) {
+        Sfx_release(preloaded[i]);
+    }
+    preloadCount = 0;
+    if (attached) {
+        // detaching doesn't wait for a callback already running, closing
+        // the mixer does, so nothing reads the clips or the bundle after
+        DetachAudioMixedProcessor(processSfx);
+        AudioMixer_close(&mixer);
+        attached = false;
+    }
+    SfxStats total = Sfx_stats();
+    TraceLog(LOG_INFO,
+        "SFX: %zu decodes in %.1f ms, %zu mapped from the bundle, "
+        "%zu cache hits, %zu plays dropped, %zu voices stolen",
+        total.decodes, total.decodeTime * 1000, total.mapped, total.hits,
+        total.dropped, total.stolen);
+    Bundle_close(&bundle);
+    atomic_store(&openDone, false);
+}
+
+const AudioClip* Sfx_acquire(const char* path) {
+    SfxEntry* slot = NULL;
+    for (int i = 0; i < SFX_CACHE_SIZE; i++) {
+        SfxEntry* entry = &entries[i];
+        if (entry->refs > 0 && strcmp(entry->path, path) == 0) {
+            entry->refs++;
+            stats.hits++;
+            return &entry->clip;
+        }
+        if (entry->refs == 0 && !slot) {
+            slot = entry;
+        }
+    }
+    if (!slot || strlen(path) >= sizeof(slot->path)) {
+        TraceLog(LOG_WARNING, "SFX: can't cache %s", path);
+        return NULL;
+    }
+
+    size_t frames;
+    const float* packed = Bundle_find(&bundle, path, &frames);
+    if (packed && bundle.header->sampleRate == sampleRate) {
+        slot->clip = (AudioClip) { .samples = packed, .frames = frames };
+        slot->mapped = true;
+        strcpy(slot->path, path);
+        slot->refs = 1;
+        stats.mapped++;
+        return &slot->clip;
+    }
+
+    double start = GetTime();
+    Wave wave;
+    if (packed) {
+        // packed for another device rate, resampling still beats decoding
+        Wave view = {
+            .frameCount = frames,
+            .sampleRate = bundle.header->sampleRate,
+            .sampleSize = 32,
+            .channels = 1,
+            .data = (void*)packed,
+        };
+        wave = WaveCopy(view);
+    } else {
+        wave = LoadWave(path);
+    }
+    if (wave.frameCount == 0) {
+        UnloadWave(wave);
+        return NULL;
+    }
+    WaveFormat(&wave, sampleRate ? sampleRate : wave.sampleRate, 32, 1);
+    slot->clip = (AudioClip) {
+        .samples = LoadWaveSamples(wave),
+        .frames = wave.frameCount,
+    };
+    UnloadWave(wave);
+    slot->mapped = false;
+    strcpy(slot->path, path);
+    slot->refs = 1;
+
+    stats.decodes++;
+    stats.decodeTime += GetTime() - start;
+    stats.residentBytes += slot->clip.frames * sizeof(float);
+    return &slot->clip;
+}
+
+void Sfx_release(const AudioClip* clip) {
+    if (!clip) {
+        return;
+    }
+    SfxEntry* entry = (SfxEntry*)((char*)clip - offsetof(SfxEntry, clip));
+    if (--entry->refs > 0) {
+        return;
+    }
+    if (!entry->mapped) {
+        stats.residentBytes -= entry->clip.frames * sizeof(float);
+    }
+    // a voice may still be reading it
+    if (attached) {
+        AudioMixer_stop(&mixer, &entry->clip);
+    }
+    if (!entry->mapped) {
+        UnloadWaveSamples((float*)entry->clip.samples);
+    }
+    entry->clip = (AudioClip) { .samples = NULL, .frames = 0 };
+}
+
+void Sfx_play(const AudioClip* clip, float pitch, float gain) {
+    AudioMixer_play(&mixer, clip, pitch, gain);
+}
+
+SfxStats Sfx_stats(void) {
+    SfxStats current = stats;
+    current.dropped += atomic_load(&mixer.dropped);
+    current.stolen += atomic_load(&mixer.stolen);
+    return current;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include "audio.h"
+
+// Decoded sound effects shared by the game and the menus
+// Each file is decoded once into mono floats at the device rate and kept
+// while anyone holds it. Everything plays through one pool of AUDIO_VOICES
+// voices mixed on the audio thread, so overlapping hits don't cut each
+// other off and starting a match costs no file I/O. Sounds found in a
+// bundle made by pack are played straight from its mapping instead.
+
+#define SFX_CACHE_SIZE 8
+
+typedef struct {
+    size_t decodes; // files decoded
+    size_t mapped; // clips played from the bundle without decoding
+    size_t hits; // acquires served from the cache
+    double decodeTime; // seconds spent decoding
+    double openTime; // seconds Sfx_openAsync's thread took
+    size_t residentBytes; // decoded samples currently held
+    size_t dropped; // plays the queue had no room for
+    size_t stolen; // voices cut off for a new one
+} SfxStats;
+
+// Before Sfx_open, false if path isn't a usable bundle
+bool Sfx_mapBundle(const char* path);
+// After InitAudioDevice, attaches the mixer to raylib's output
+void Sfx_open(void);
+// Maps the bundle at path, if any, runs InitAudioDevice and Sfx_open and
+// acquires the preload clips on a thread, so the window shows meanwhile
+// and later acquires of them are cache hits. Nothing else here may be
+// called until Sfx_opened, except Sfx_play with a NULL clip.
+void Sfx_openAsync(
+    const char* bundlePath, const char* const* preload, size_t count);
+// True once Sfx_openAsync has finished or Sfx_open was called
+bool Sfx_opened(void);
+// Before CloseAudioDevice, every clip must have been released
+void Sfx_close(void);
+
+// Decodes the file on first use, NULL if it can't be loaded
+const AudioClip* Sfx_acquire(const char* path);
+// Frees the samples once nobody holds the clip
+void Sfx_release(const AudioClip* clip);
+void Sfx_play(const AudioClip* clip, float pitch, float gain);
+
+SfxStats Sfx_stats(void);
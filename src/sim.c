@@ -0,0 +1,430 @@
+#include "sim.h"
+#include "ccd.h"
+#include "sim_internal.h"
+#include <math.h>
+#include <string.h>
+
+const float p0x = 0.1;
+const float p1x = 0.9;
+const float pdy = 0.015;
+const float boardHalfWidth = 0.01;
+const float boardHeight = 0.15;
+const float ballWidth = boardHalfWidth * 2;
+const float ballSpeedSlow = 0.007;
+const float ballSpeedNormal = ballSpeedSlow * 2;
+
+// CPU difficulty
+const float cpuChaseOffset = boardHeight / 4;
+const float cpuSlowMovingDistance = 0.8;
+const float cpuSlowMovingFactor = 0.5;
+
+void Ball_sweep(
+    Game* game, const float paddleFrom[2], float dt, GameEvents* events);
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define clamp(x, l, u) ((x) < (l) ? (l) : (x) > (u) ? (u) : (x))
+#define isInRangeInclusive(x, l, u) ((x) >= (l) && (x) <= (u))
+#define isRangeOverlap(x1, x2, y1, y2) ((x1) <= (y2) && (y1) <= (x2))
+
+static inline Vec2 Vec2_add(Vec2 a, Vec2 b) {
+    return (Vec2){ .x = a.x + b.x, .y = a.y + b.y };
+}
+
+static inline Vec2 Vec2_scale(Vec2 v, float s) {
+    return (Vec2){ .x = v.x * s, .y = v.y * s };
+}
+
+static inline float Vec2_length(Vec2 v) {
+    return sqrtf(v.x * v.x + v.y * v.y);
+}
+
+static void GameEvents_push(GameEvents* events, GameEvent event) {
+    if (events && events->count < GAME_EVENTS_MAX) {
+        events->events[events->count++] = event;
+    }
+}
+
+static void Player_init(Player* player, bool isCpu) {
+    player->score = 0;
+    player->y = 0.5;
+    player->isCpu = isCpu;
+    player->cpu.chanceOffset = NAN;
+    player->cpu.aimY = NAN;
+    player->cpu.params = CPU_PARAMS_DEFAULT;
+}
+
+Game Game_init(enum Mode players_n, uint64_t seed) {
+    return Game_initMatch(players_n, seed, 0);
+}
+
+Game Game_initMatch(enum Mode players_n, uint64_t seed, uint64_t matchId) {
+    Game game;
+    memset(&game, 0, sizeof(game));
+    game.init = true;
+    game.firstHit = false;
+    game.ended = false;
+    game.swept = false;
+    game.stepDt = 1;
+    game.rng = Rng_init(seed, matchId);
+    game.ball = (Ball) {
+        .pos = { .x = 0.5, .y = 0.5 },
+        .vel = { .x = ballSpeedSlow, .y = 0 },
+    };
+    Player_init(&game.players[0], players_n != TWO_PLAYERS);
+    Player_init(&game.players[1], players_n == CPU_VS_CPU);
+    return game;
+}
+
+void Game_setCpuParams(Game* game, int pn, CpuParams params) {
+    if (game->players[pn].isCpu) {
+        game->players[pn].cpu.params = params;
+    }
+}
+
+void Game_del(Game* game) {
+    game->init = false;
+}
+
+void Game_setSwept(Game* game, bool swept) {
+    game->swept = swept;
+}
+
+void Game_setStepDt(Game* game, float dt) {
+    game->stepDt = dt;
+}
+
+static void Game_movePaddles(Game* game, GameInput input, float dt) {
+    for (int pn = 0; pn < 2; pn++) {
+        Player* player = &game->players[pn];
+        if (player->isCpu) {
+            Cpu_update(player, &game->ball, &game->rng, pn, dt);
+        } else {
+            Player_update(player, input.dy[pn], dt);
+        }
+    }
+}
+
+static void Game_checkEnded(Game* game) {
+    if (game->players[0].score == winningScore ||
+        game->players[1].score == winningScore)
+    {
+        game->ended = true;
+    }
+}
+
+void Game_step(Game* game, GameInput input, GameEvents* events) {
+    if (game->swept) {
+        Game_stepDt(game, input, game->stepDt, events);
+        return;
+    }
+    if (events) {
+        events->count = 0;
+    }
+
+    Game_movePaddles(game, input, 1);
+    Ball_update(
+        &game->ball, game->players, &game->firstHit, &game->rng, events);
+    Game_checkEnded(game);
+}
+
+void Game_stepDt(Game* game, GameInput input, float dt, GameEvents* events) {
+    if (events) {
+        events->count = 0;
+    }
+
+    float paddleFrom[2] = { game->players[0].y, game->players[1].y };
+    Game_movePaddles(game, input, dt);
+    Ball_sweep(game, paddleFrom, dt, events);
+}
+
+int8_t Game_followBall(const Game* game, int pn) {
+    float dy = game->ball.pos.y - game->players[pn].y;
+    return dy < -pdy ? -1 : dy > pdy ? 1 : 0;
+}
+
+GameSnapshot Game_snapshot(const Game* game) {
+    GameSnapshot snapshot;
+    memcpy(&snapshot, game, sizeof(snapshot));
+    return snapshot;
+}
+
+void Game_restore(Game* game, const GameSnapshot* snapshot) {
+    memcpy(game, snapshot, sizeof(*game));
+}
+
+// Multiply and xorshift like splitmix64
+static uint64_t Hash_add(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0xbf58476d1ce4e5b9ull;
+    return hash ^ hash >> 31;
+}
+
+// Bit patterns, so a NaN aim hashes equal to itself
+static uint64_t Hash_addFloats(uint64_t hash, float a, float b) {
+    uint32_t bitsA, bitsB;
+    memcpy(&bitsA, &a, 4);
+    memcpy(&bitsB, &b, 4);
+    return Hash_add(hash, (uint64_t)bitsA << 32 | bitsB);
+}
+
+// Field by field, the padding can hold anything
+uint64_t Game_hash(const Game* game) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    hash = Hash_add(hash, game->rng.key);
+    hash = Hash_add(hash, game->rng.stream);
+    hash = Hash_add(hash, game->rng.counter);
+    hash = Hash_addFloats(hash, game->ball.pos.x, game->ball.pos.y);
+    hash = Hash_addFloats(hash, game->ball.vel.x, game->ball.vel.y);
+    for (int pn = 0; pn < 2; pn++) {
+        const Player* player = &game->players[pn];
+        const Cpu* cpu = &player->cpu;
+        const CpuParams* params = &cpu->params;
+        hash = Hash_add(hash, (uint64_t)player->score << 1 | player->isCpu);
+        hash = Hash_addFloats(hash, player->y, cpu->chanceOffset);
+        hash = Hash_addFloats(hash, cpu->aimY, params->chaseOffset);
+        hash = Hash_addFloats(
+            hash, params->slowMovingDistance, params->slowMovingFactor);
+        hash = Hash_addFloats(hash, params->aimError, params->aimBounceError);
+        hash = Hash_add(hash, params->aim);
+    }
+    hash = Hash_add(hash,
+        (uint64_t)game->init | (uint64_t)game->firstHit << 1 |
+        (uint64_t)game->ended << 2 | (uint64_t)game->swept << 3);
+    hash = Hash_addFloats(hash, game->stepDt, 0);
+    hash *= 0x94d049bb133111ebull;
+    return hash ^ hash >> 29;
+}
+
+// Where a cpu aiming with CPU_AIM_INTERCEPT goes for the current rally leg
+static float Cpu_predict(Cpu* cpu, const Ball* ball, Rng* rng, int pn) {
+    CpuParams* params = &cpu->params;
+    bool coming = pn == 0 ? ball->vel.x < 0 : ball->vel.x > 0;
+    if (!coming) {
+        return 0.5; // wait in the middle
+    }
+    float face = Paddle_faceX(pn);
+    int bounces;
+    float y = Ball_interceptY(ball, face, &bounces);
+    float error =
+        params->aimError * fabsf(face - ball->pos.x) +
+        params->aimBounceError * bounces;
+    if (error > 0) {
+        y += error * (Rng_range(rng, -1000, 1000) / 1000.f);
+    }
+    return y;
+}
+
+// pn 1 mirrors the left cpu, slowing down while the ball is far left
+// Over dt ticks it moves up to dt times its one tick step
+void Cpu_update(Player* player, Ball* ball, Rng* rng, int pn, float dt) {
+    Cpu* cpu = &player->cpu;
+    CpuParams* params = &cpu->params;
+    bool ballFar = pn == 0 ?
+        ball->pos.x > params->slowMovingDistance :
+        ball->pos.x < 1 - params->slowMovingDistance;
+    float movingFac = ballFar ? params->slowMovingFactor : 1;
+    float step = pdy * movingFac * dt;
+
+    // the prediction holds until a hit or a serve clears it
+    if (params->aim == CPU_AIM_INTERCEPT) {
+        if (isnan(cpu->aimY)) {
+            cpu->aimY = Cpu_predict(cpu, ball, rng, pn);
+        }
+        float dy = clamp(cpu->aimY - player->y, -step, step);
+        player->y = clamp(
+            player->y + dy, boardHeight / 2, 1 - boardHeight / 2);
+        return;
+    }
+
+    if (isnan(cpu->chanceOffset)) {
+        float fac = 100000.f;
+        cpu->chanceOffset =
+            Rng_range(rng, 0, params->chaseOffset * fac) / fac;
+    }
+
+    // sign of atan2f(vel.y, vel.x) without the atan2f, (+0, -x) is pi
+    bool ballUp = ball->vel.y > 0 ||
+        (ball->vel.y == 0 && !signbit(ball->vel.y) && ball->vel.x < 0);
+    int ballDir = ballUp ? 1 : -1;
+    float ballGuessY = ball->pos.y + cpu->chanceOffset * ballDir;
+    float dy = player->y < ballGuessY ?
+        min(step, (ballGuessY - player->y) * movingFac) :
+        player->y > ballGuessY ?
+            -min(step, (player->y - ballGuessY) * movingFac) :
+            0;
+    player->y += dy;
+    player->y = clamp(player->y, boardHeight / 2, 1 - boardHeight / 2);
+}
+
+void Player_update(Player* player, int8_t dy, float dt) {
+    if (dy < 0) {
+        player->y -= pdy * dt;
+    } else if (dy > 0) {
+        player->y += pdy * dt;
+    }
+    player->y = clamp(player->y, boardHeight / 2, 1 - boardHeight / 2);
+}
+
+void Ball_resetVel(Ball* ball, Rng* rng) {
+    float angle = Rng_range(rng, 110, 135) / 180.f * 2 - 1;
+    Vec2 v = { .x = 1, .y = angle };
+    ball->vel = Vec2_scale(v, ballSpeedSlow);
+}
+
+// The ball's path changed, cpus have to predict it again
+static void Players_forgetAim(Player players[2]) {
+    for (int pn = 0; pn < 2; pn++) {
+        players[pn].cpu.aimY = NAN;
+    }
+}
+
+// Scorer gets the point, the ball is served toward the other side
+void Ball_serve(
+    Ball* ball, Player players[2], int scorer, Rng* rng, GameEvents* events)
+{
+    Players_forgetAim(players);
+    players[scorer].score++;
+    ball->pos = (Vec2){ .x = 0.5, .y = Rng_range(rng, 4, 6) / 10.f };
+    Ball_resetVel(ball, rng);
+    if (scorer == 1) {
+        ball->vel.x = -ball->vel.x;
+    }
+    GameEvents_push(events, (GameEvent){
+        .type = GAMEEVENT_SCORE,
+        .player = scorer,
+        .ballSpeed = Vec2_length(ball->vel),
+    });
+}
+
+// The further from the paddle's center, the steeper the bounce
+void Ball_bounceOff(
+    Ball* ball, Player players[2], int pn, float paddleY, GameEvents* events)
+{
+    float dis = (ball->pos.y - paddleY) / (boardHeight);
+    Vec2 v = { .x = pn == 0 ? 1 : -1, .y = dis * 4 };
+    ball->vel = Vec2_scale(v, ballSpeedNormal);
+    players[pn].cpu.chanceOffset = NAN;
+    Players_forgetAim(players);
+    GameEvents_push(events, (GameEvent){
+        .type = GAMEEVENT_HIT,
+        .player = pn,
+        .ballSpeed = Vec2_length(ball->vel),
+    });
+}
+
+void Ball_checkOutOfBounce(
+    Ball* ball, Player players[2], Rng* rng, GameEvents* events)
+{
+    if (ball->pos.x > 1) {
+        Ball_serve(ball, players, 0, rng, events);
+    } else if (ball->pos.x < 0) {
+        Ball_serve(ball, players, 1, rng, events);
+    }
+}
+
+void Ball_checkCollisionWithBoard(
+    Ball* ball, Player players[2], bool* firstHit, GameEvents* events)
+{
+    #define xCollideWithP0(bx) \
+        isRangeOverlap( \
+            bx - ballWidth / 2, bx + ballWidth / 2, \
+            p0x - boardHalfWidth / 2, p0x + boardHalfWidth)
+    #define yCollideWithP0(by) \
+        isRangeOverlap( \
+            by - ballWidth / 2, by + ballWidth / 2, \
+            players[0].y - boardHeight / 2, players[0].y + boardHeight / 2)
+    #define collideWithP0(ball) \
+        ball->vel.x < 0 && \
+        xCollideWithP0(ball->pos.x) && yCollideWithP0(ball->pos.y)
+
+    #define xCollideWithP1(bx) \
+        isRangeOverlap( \
+            bx - ballWidth / 2, bx + ballWidth / 2, \
+            p1x - boardHalfWidth, p1x + boardHalfWidth / 2)
+    #define yCollideWithP1(by) \
+        isRangeOverlap( \
+            by - ballWidth / 2, by + ballWidth / 2, \
+            players[1].y - boardHeight / 2, players[1].y + boardHeight / 2)
+    #define collideWithP1(ball) \
+        ball->vel.x > 0 && \
+        xCollideWithP1(ball->pos.x) && yCollideWithP1(ball->pos.y)
+
+    if (collideWithP0(ball)) {
+        Ball_bounceOff(ball, players, 0, players[0].y, events);
+    } else if (collideWithP1(ball)) {
+        Ball_bounceOff(ball, players, 1, players[1].y, events);
+    }
+
+    #undef xCollideWithP0
+    #undef yCollideWithP0
+    #undef collideWithP0
+    #undef xCollideWithP1
+    #undef yCollideWithP1
+    #undef collideWithP1
+}
+
+void Ball_checkCollisionWithWall(Ball* ball, GameEvents* events) {
+    Vec2 future = Vec2_add(ball->pos, ball->vel);
+    if (!isInRangeInclusive(future.y, 0, 1)) {
+        ball->vel.y = -ball->vel.y;
+        GameEvents_push(events, (GameEvent){
+            .type = GAMEEVENT_WALL,
+            .player = -1,
+            .ballSpeed = Vec2_length(ball->vel),
+        });
+    }
+}
+
+void Ball_update(
+    Ball* ball, Player players[2], bool* firstHit,
+    Rng* rng, GameEvents* events)
+{
+    Ball_checkOutOfBounce(ball, players, rng, events);
+    Ball_checkCollisionWithBoard(ball, players, firstHit, events);
+    Ball_checkCollisionWithWall(ball, events);
+    ball->pos = Vec2_add(ball->pos, ball->vel);
+}
+
+// More contacts than this in one sweep means the ball is stuck in a corner
+#define SWEEP_MAX_CONTACTS 64
+
+// Moves the ball through every contact within dt, in time order
+void Ball_sweep(
+    Game* game, const float paddleFrom[2], float dt, GameEvents* events)
+{
+    Ball* ball = &game->ball;
+    float paddleTo[2] = { game->players[0].y, game->players[1].y };
+    float t = 0;
+    Contact contact;
+    for (int n = 0; n < SWEEP_MAX_CONTACTS && !game->ended &&
+        Ball_nextContact(ball, t, dt, paddleFrom, paddleTo, &contact); n++)
+    {
+        ball->pos = Vec2_add(ball->pos, Vec2_scale(ball->vel, contact.time - t));
+        t = contact.time;
+        switch (contact.type) {
+        case CONTACT_WALL:
+            ball->vel.y = -ball->vel.y;
+            GameEvents_push(events, (GameEvent){
+                .type = GAMEEVENT_WALL,
+                .player = -1,
+                .ballSpeed = Vec2_length(ball->vel),
+            });
+            break;
+        case CONTACT_PADDLE: {
+            float paddleY = Paddle_at(
+                paddleFrom, paddleTo, contact.side, t, dt);
+            Ball_bounceOff(
+                ball, game->players, contact.side, paddleY, events);
+            break;
+        }
+        case CONTACT_GOAL:
+            Ball_serve(
+                ball, game->players, !contact.side, &game->rng, events);
+            Game_checkEnded(game);
+            break;
+        }
+    }
+    if (!game->ended) {
+        ball->pos = Vec2_add(ball->pos, Vec2_scale(ball->vel, dt - t));
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "rng.h"
+
+// Headless match simulation
+// No raylib here, so it can be stepped without a window or an audio device
+
+// Coordinates 0 to 1
+// Scale with screen size
+
+extern const float p0x;
+extern const float p1x;
+extern const float pdy;
+extern const float boardHalfWidth;
+extern const float boardHeight;
+extern const float ballWidth;
+extern const float ballSpeedSlow;
+extern const float ballSpeedNormal;
+
+extern const float cpuChaseOffset;
+extern const float cpuSlowMovingDistance;
+extern const float cpuSlowMovingFactor;
+
+static const size_t winningScore = 11;
+
+typedef struct {
+    float x;
+    float y;
+} Vec2;
+
+// CPU difficulty
+typedef struct {
+    enum CpuAim {
+        CPU_AIM_CHASE,      // follows the ball's y
+        CPU_AIM_INTERCEPT,  // moves to where the ball will arrive
+    } aim;
+    float chaseOffset; // max random offset from the ball it aims at
+    float slowMovingDistance; // ball distance after which it slows down
+    float slowMovingFactor;
+    // intercept error model, the aim is off by up to
+    // aimError * distance the ball travels + aimBounceError * wall bounces
+    float aimError;
+    float aimBounceError;
+} CpuParams;
+
+#define CPU_PARAMS_DEFAULT ((CpuParams) { \
+    .aim = CPU_AIM_CHASE, \
+    .chaseOffset = cpuChaseOffset, \
+    .slowMovingDistance = cpuSlowMovingDistance, \
+    .slowMovingFactor = cpuSlowMovingFactor, \
+})
+
+// Only used when the player isCpu
+typedef struct {
+    float chanceOffset;
+    float aimY; // predicted intercept, NaN until the next prediction
+    CpuParams params;
+} Cpu;
+
+typedef struct {
+    uint32_t score;
+    float y;
+    Cpu cpu;
+    bool isCpu;
+} Player;
+
+typedef struct {
+    Vec2 pos;
+    Vec2 vel;
+} Ball;
+
+// A whole match, with no pointers and nothing on the heap, so a copy is a
+// snapshot. Padding isn't guaranteed to survive a copy, so Game_hash reads
+// the fields one by one and states are never compared with memcmp.
+typedef struct {
+    Rng rng;
+    Ball ball;
+    Player players[2];
+    bool init;
+    bool firstHit;
+    bool ended;
+    bool swept; // continuous collision, see Game_setSwept
+    float stepDt; // ticks a swept Game_step moves, see Game_setStepDt
+} Game;
+
+enum Mode {
+    ONE_PLAYER,
+    TWO_PLAYERS,
+    CPU_VS_CPU,
+};
+
+// Paddle movement requested for one tick
+// -1 moves up, 1 moves down, 0 stays
+// Ignored for cpu players
+typedef struct {
+    int8_t dy[2];
+} GameInput;
+
+static const GameInput GAME_INPUT_IDLE = { .dy = { 0, 0 } };
+
+typedef struct {
+    enum GameEventType {
+        GAMEEVENT_HIT,      // player hit the ball
+        GAMEEVENT_WALL,     // ball bounced off top or bottom wall
+        GAMEEVENT_SCORE,    // player scored a point
+    } type;
+    int player;
+    float ballSpeed;
+} GameEvent;
+
+#define GAME_EVENTS_MAX 8
+
+// Events produced by one tick, cleared by Game_step
+typedef struct {
+    int count;
+    GameEvent events[GAME_EVENTS_MAX];
+} GameEvents;
+
+// Saved states are whole games
+typedef Game GameSnapshot;
+
+// All randomness of a match comes from the stream (seed, matchId)
+Game Game_initMatch(enum Mode players_n, uint64_t seed, uint64_t matchId);
+Game Game_init(enum Mode players_n, uint64_t seed); // match id 0
+void Game_del(Game* game); // Nothing to free, marks it uninitialized
+void Game_setCpuParams(Game* game, int pn, CpuParams params);
+// events can be NULL
+void Game_step(Game* game, GameInput input, GameEvents* events);
+
+// Swept collision finds the exact time the ball reaches a wall, a paddle or
+// a goal line, so it can't tunnel at any speed or tick length. Off by
+// default, the batch engine only reproduces the discrete step.
+void Game_setSwept(Game* game, bool swept);
+// Steps dt ticks at once with swept collision, paddles move dt times as far
+// Game_step on a swept game is Game_stepDt with the game's step dt
+void Game_stepDt(Game* game, GameInput input, float dt, GameEvents* events);
+// Ticks of movement each Game_step of a swept game covers, 1 by default.
+// Stepping at n times the tick rate with dt 1 / n keeps the match's speed.
+void Game_setStepDt(Game* game, float dt);
+
+// Scripted input for headless tools, moves player pn toward the ball
+int8_t Game_followBall(const Game* game, int pn);
+
+// Plain copies
+GameSnapshot Game_snapshot(const Game* game);
+void Game_restore(Game* game, const GameSnapshot* snapshot);
+// Of every field, floats by bit pattern, padding left out. Equal for equal
+// states, for spotting desyncs.
+uint64_t Game_hash(const Game* game);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "sim.h"
+
+// Pieces of Game_step, for sim.c and the benchmarks that time them alone
+
+void Player_update(Player* player, int8_t dy, float dt);
+void Cpu_update(Player* player, Ball* ball, Rng* rng, int pn, float dt);
+void Ball_update(
+    Ball* ball, Player players[2], bool* firstHit,
+    Rng* rng, GameEvents* events);
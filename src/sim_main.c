@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+#include "sim.h"
+#include "timing.h"
+
+// Headless runner, plays cpu against a scripted player as fast as possible
+// usage: sim [matches] [seed] [dt]
+// dt > 0 uses swept collision and steps dt ticks at a time
+
+int main(int argc, char** argv) {
+    long matches = argc > 1 ? atol(argv[1]) : 1000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 1;
+    float dt = argc > 3 ? atof(argv[3]) : 0;
+
+    size_t steps = 0;
+    double ticks = 0;
+    size_t hits = 0;
+    size_t wins[2] = { 0, 0 };
+    double start = now();
+    for (long m = 0; m < matches; m++) {
+        Game game = Game_initMatch(ONE_PLAYER, seed, m);
+        Game_setSwept(&game, dt > 0);
+        GameEvents events;
+        while (!game.ended) {
+            GameInput input = { .dy = { 0, Game_followBall(&game, 1) } };
+            if (dt > 0) {
+                Game_stepDt(&game, input, dt, &events);
+                ticks += dt;
+            } else {
+                Game_step(&game, input, &events);
+                ticks++;
+            }
+            for (int i = 0; i < events.count; i++) {
+                hits += events.events[i].type == GAMEEVENT_HIT;
+            }
+            steps++;
+        }
+        wins[game.players[1].score == winningScore]++;
+        Game_del(&game);
+    }
+    double elapsed = now() - start;
+
+    printf("matches   %ld\n", matches);
+    printf("collision %s, dt %g\n", dt > 0 ? "swept" : "discrete", dt > 0 ? dt : 1);
+    printf("ticks     %.0f\n", ticks);
+    printf("steps     %zu\n", steps);
+    printf("hits      %zu\n", hits);
+    printf("wins      cpu %zu, scripted %zu\n", wins[0], wins[1]);
+    printf("elapsed   %.3f s\n", elapsed);
+    printf("ticks/s   %.0f\n", ticks / elapsed);
+    printf("steps/s   %.0f\n", steps / elapsed);
+    return 0;
+}
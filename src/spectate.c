@@ -0,0 +1,742 @@
+#define _GNU_SOURCE
+#include "spectate.h"
+#include <math.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "udp.h"
+
+#define SPECTATE_HEADER 15 // of a 'D' packet
+#define SPECTATE_FIELDS 6
+
+static uint8_t* putVarint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static const uint8_t* getVarint(
+    const uint8_t* p, const uint8_t* end, uint32_t* v)
+{
+    *v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t byte = *p++;
+        *v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return (uint32_t)v << 1 ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint16_t quantize(float v, float scale, float offset) {
+    float q = roundf((v + offset) * scale);
+    return q < 0 ? 0 : q > UINT16_MAX ? UINT16_MAX : q;
+}
+
+static int16_t quantizeSigned(float v, float scale) {
+    float q = roundf(v * scale);
+    return q < INT16_MIN ? INT16_MIN : q > INT16_MAX ? INT16_MAX : q;
+}
+
+SpectateFrame SpectateFrame_quantize(const Game* game) {
+    #define pos(v) quantize((v), SPECTATE_POS_SCALE, 1)
+    SpectateFrame frame = {
+        .ballX = pos(game->ball.pos.x),
+        .ballY = pos(game->ball.pos.y),
+        .velX = quantizeSigned(game->ball.vel.x, SPECTATE_VEL_SCALE),
+        .velY = quantizeSigned(game->ball.vel.y, SPECTATE_VEL_SCALE),
+        .paddles = { pos(game->players[0].y), pos(game->players[1].y) },
+        .scores = {
+            game->players[0].score < UINT8_MAX ? game->players[0].score : 0,
+            game->players[1].score < UINT8_MAX ? game->players[1].score : 0,
+        },
+    };
+    return frame;
+    #undef pos
+}
+
+void SpectateFrame_apply(const SpectateFrame* frame, Game* game) {
+    #define pos(q) ((q) / SPECTATE_POS_SCALE - 1)
+    game->ball.pos = (Vec2) { pos(frame->ballX), pos(frame->ballY) };
+    game->ball.vel = (Vec2) {
+        frame->velX / SPECTATE_VEL_SCALE,
+        frame->velY / SPECTATE_VEL_SCALE,
+    };
+    game->players[0].y = pos(frame->paddles[0]);
+    game->players[1].y = pos(frame->paddles[1]);
+    game->players[0].score = frame->scores[0];
+    game->players[1].score = frame->scores[1];
+    #undef pos
+}
+
+static void SpectateFrame_fields(
+    const SpectateFrame* frame, int32_t fields[SPECTATE_FIELDS])
+{
+    fields[0] = frame->ballX;
+    fields[1] = frame->ballY;
+    fields[2] = frame->velX;
+    fields[3] = frame->velY;
+    fields[4] = frame->paddles[0];
+    fields[5] = frame->paddles[1];
+}
+
+// A tick dt after ref, the ball keeping its velocity and the paddles the
+// speed they had between before and ref, if before is known
+static void SpectateFrame_predict(
+    const SpectateFrame* ref, const SpectateFrame* before, uint32_t dt,
+    int32_t fields[SPECTATE_FIELDS])
+{
+    const int32_t perPos = SPECTATE_VEL_SCALE / SPECTATE_POS_SCALE;
+    SpectateFrame_fields(ref, fields);
+    fields[0] += (int32_t)ref->velX * (int32_t)dt / perPos;
+    fields[1] += (int32_t)ref->velY * (int32_t)dt / perPos;
+    if (before) {
+        fields[4] += ref->paddles[0] - before->paddles[0];
+        fields[5] += ref->paddles[1] - before->paddles[1];
+    }
+}
+
+static uint8_t* SpectateFrame_encode(
+    uint8_t* p, const SpectateFrame* frame,
+    const int32_t predicted[SPECTATE_FIELDS])
+{
+    int32_t fields[SPECTATE_FIELDS];
+    SpectateFrame_fields(frame, fields);
+    uint8_t* mask = p++;
+    *mask = 0;
+    for (int i = 0; i < SPECTATE_FIELDS; i++) {
+        int32_t miss = fields[i] - predicted[i];
+        if (miss) {
+            *mask |= 1 << i;
+            p = putVarint(p, zigzag(miss));
+        }
+    }
+    return p;
+}
+
+static const uint8_t* SpectateFrame_decode(
+    const uint8_t* p, const uint8_t* end, SpectateFrame* frame,
+    const int32_t predicted[SPECTATE_FIELDS])
+{
+    if (p >= end) {
+        return NULL;
+    }
+    uint8_t mask = *p++;
+    int32_t fields[SPECTATE_FIELDS];
+    for (int i = 0; i < SPECTATE_FIELDS; i++) {
+        uint32_t miss = 0;
+        if (mask & 1 << i) {
+            p = getVarint(p, end, &miss);
+            if (!p) {
+                return NULL;
+            }
+        }
+        fields[i] = predicted[i] + unzigzag(miss);
+    }
+    frame->ballX = fields[0];
+    frame->ballY = fields[1];
+    frame->velX = fields[2];
+    frame->velY = fields[3];
+    frame->paddles[0] = fields[4];
+    frame->paddles[1] = fields[5];
+    return p;
+}
+
+static int SpectateKeyframe_encode(const SpectateKeyframe* key, uint8_t* data) {
+    memcpy(data, SPECTATE_MAGIC, 4);
+    data[4] = 'K';
+    put32(data + 5, key->seq);
+    put32(data + 9, key->tick);
+    put32(data + 13, key->match);
+    data[17] = key->frame.scores[0];
+    data[18] = key->frame.scores[1];
+    int32_t fields[SPECTATE_FIELDS];
+    SpectateFrame_fields(&key->frame, fields);
+    for (int i = 0; i < SPECTATE_FIELDS; i++) {
+        data[19 + 2 * i] = fields[i];
+        data[20 + 2 * i] = fields[i] >> 8;
+    }
+    return 19 + 2 * SPECTATE_FIELDS;
+}
+
+bool SpectatePublisher_open(SpectatePublisher* pub, int port) {
+    memset(pub, 0, sizeof(*pub));
+    pub->fd = Udp_open(port, NULL);
+    if (pub->fd < 0) {
+        return false;
+    }
+    // a packet leaves once per viewer in one go
+    Udp_setBuffers(pub->fd, 1 << 22);
+    return true;
+}
+
+void SpectatePublisher_close(SpectatePublisher* pub) {
+    if (pub->fd >= 0) {
+        close(pub->fd);
+    }
+    free(pub->subscribers);
+    free(pub->index);
+    free(pub->messages);
+    *pub = (SpectatePublisher) { .fd = -1 };
+}
+
+static uint64_t addressKey(const uint8_t* addr) {
+    const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+    return (uint64_t)in->sin_addr.s_addr << 16 | in->sin_port;
+}
+
+static size_t indexSlot(const SpectatePublisher* pub, uint64_t key) {
+    return (key * 0x9E3779B97F4A7C15ull >> 32) & (pub->indexSize - 1);
+}
+
+static void SpectatePublisher_reindex(SpectatePublisher* pub) {
+    memset(pub->index, 0, pub->indexSize * sizeof(*pub->index));
+    for (size_t i = 0; i < pub->count; i++) {
+        size_t slot = indexSlot(pub, addressKey(pub->subscribers[i].addr));
+        while (pub->index[slot]) {
+            slot = (slot + 1) & (pub->indexSize - 1);
+        }
+        pub->index[slot] = i + 1;
+    }
+}
+
+// NULL if it isn't subscribed and there is no memory for it
+static SpectateSubscriber* SpectatePublisher_find(
+    SpectatePublisher* pub, const uint8_t* addr, bool* added)
+{
+    uint64_t key = addressKey(addr);
+    *added = false;
+    if (pub->indexSize) {
+        size_t slot = indexSlot(pub, key);
+        while (pub->index[slot]) {
+            SpectateSubscriber* sub = &pub->subscribers[pub->index[slot] - 1];
+            if (addressKey(sub->addr) == key) {
+                return sub;
+            }
+            slot = (slot + 1) & (pub->indexSize - 1);
+        }
+    }
+
+    if (pub->count == pub->capacity) {
+        size_t capacity = pub->capacity ? pub->capacity * 2 : 64;
+        SpectateSubscriber* subscribers =
+            realloc(pub->subscribers, capacity * sizeof(*subscribers));
+        uint32_t* index = calloc(capacity * 2, sizeof(*index));
+        void* messages = realloc(
+            pub->messages, capacity * sizeof(struct mmsghdr));
+        if (!subscribers || !index || !messages) {
+            free(index);
+            pub->subscribers = subscribers ? subscribers : pub->subscribers;
+            pub->messages = messages ? messages : pub->messages;
+            return NULL;
+        }
+        free(pub->index);
+        pub->subscribers = subscribers;
+        pub->index = index;
+        pub->messages = messages;
+        pub->capacity = capacity;
+        pub->indexSize = capacity * 2;
+        SpectatePublisher_reindex(pub);
+    }
+    SpectateSubscriber* sub = &pub->subscribers[pub->count++];
+    *sub = (SpectateSubscriber) {
+        .acked = SPECTATE_NONE,
+        .heard = 0,
+        .resent = -SPECTATE_RESEND,
+    };
+    memcpy(sub->addr, addr, sizeof(sub->addr));
+    size_t slot = indexSlot(pub, key);
+    while (pub->index[slot]) {
+        slot = (slot + 1) & (pub->indexSize - 1);
+    }
+    pub->index[slot] = pub->count;
+    *added = true;
+    return sub;
+}
+
+static void SpectatePublisher_sendTo(
+    SpectatePublisher* pub, SpectateSubscriber* sub,
+    const uint8_t* data, int size)
+{
+    if (sendto(pub->fd, data, size, 0,
+        (struct sockaddr*)sub->addr, sizeof(struct sockaddr_in)) == size)
+    {
+        pub->sent++;
+        pub->bytes += size;
+    } else {
+        pub->failed++;
+    }
+}
+
+// The same bytes to every subscriber
+static void SpectatePublisher_broadcast(
+    SpectatePublisher* pub, const uint8_t* data, int size)
+{
+    pub->packets++;
+    struct iovec iov = { .iov_base = (void*)data, .iov_len = size };
+    struct mmsghdr* messages = pub->messages;
+    for (size_t i = 0; i < pub->count; i++) {
+        messages[i] = (struct mmsghdr) {
+            .msg_hdr = {
+                .msg_name = pub->subscribers[i].addr,
+                .msg_namelen = sizeof(struct sockaddr_in),
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+            },
+        };
+    }
+    size_t failed = Udp_sendAll(pub->fd, messages, pub->count);
+    pub->failed += failed;
+    pub->sent += pub->count - failed;
+    pub->bytes += (uint64_t)(pub->count - failed) * size;
+}
+
+static const SpectateKeyframe* SpectatePublisher_keyframe(
+    const SpectatePublisher* pub, uint32_t seq)
+{
+    if (seq == SPECTATE_NONE || seq >= pub->nextSeq ||
+        pub->nextSeq - seq > SPECTATE_KEYFRAMES)
+    {
+        return NULL;
+    }
+    return &pub->keyframes[seq % SPECTATE_KEYFRAMES];
+}
+
+static void SpectatePublisher_resend(
+    SpectatePublisher* pub, SpectateSubscriber* sub, uint32_t seq,
+    double now)
+{
+    const SpectateKeyframe* key = SpectatePublisher_keyframe(pub, seq);
+    if (!key || now - sub->resent < SPECTATE_RESEND) {
+        return;
+    }
+    uint8_t data[SPECTATE_PACKET_MAX];
+    int size = SpectateKeyframe_encode(key, data);
+    SpectatePublisher_sendTo(pub, sub, data, size);
+    sub->resent = now;
+    pub->resent++;
+}
+
+void SpectatePublisher_poll(SpectatePublisher* pub, double now) {
+    uint8_t data[SPECTATE_PACKET_MAX];
+    for (;;) {
+        _Alignas(8) uint8_t from[sizeof(struct sockaddr_in)];
+        socklen_t fromSize = sizeof(from);
+        ssize_t size = recvfrom(pub->fd, data, sizeof(data), 0,
+            (struct sockaddr*)from, &fromSize);
+        if (size < 0) {
+            break;
+        }
+        if (size < 14 || memcmp(data, SPECTATE_MAGIC, 4) != 0 ||
+            data[4] != 'S' || fromSize != sizeof(from))
+        {
+            continue;
+        }
+        bool added;
+        SpectateSubscriber* sub = SpectatePublisher_find(pub, from, &added);
+        if (!sub) {
+            continue;
+        }
+        uint32_t acked = get32(data + 5);
+        uint32_t need = get32(data + 9);
+        sub->heard = now;
+        if (acked != SPECTATE_NONE &&
+            (sub->acked == SPECTATE_NONE || acked >= sub->acked))
+        {
+            sub->acked = acked;
+            sub->held = data[13];
+        }
+        if (need != SPECTATE_NONE) {
+            SpectatePublisher_resend(pub, sub, need, now);
+        } else if (!SpectatePublisher_keyframe(pub, sub->acked)) {
+            // new, or too far behind to catch up with deltas
+            SpectatePublisher_resend(pub, sub, pub->nextSeq - 1, now);
+        }
+    }
+
+    if (now - pub->pruned < 1) {
+        return;
+    }
+    pub->pruned = now;
+    size_t kept = 0;
+    for (size_t i = 0; i < pub->count; i++) {
+        if (now - pub->subscribers[i].heard < SPECTATE_TIMEOUT) {
+            pub->subscribers[kept++] = pub->subscribers[i];
+        }
+    }
+    if (kept != pub->count) {
+        pub->count = kept;
+        SpectatePublisher_reindex(pub);
+    }
+}
+
+// Sends the pending ticks against the newest keyframe every subscriber
+// holds, or the newest one if they have none in common
+static void SpectatePublisher_flush(SpectatePublisher* pub, double now) {
+    uint32_t newest = pub->nextSeq - 1;
+    // bit i set while every subscriber holds keyframe newest - i
+    uint32_t common = (1u << SPECTATE_KEYFRAMES) - 1;
+    for (size_t i = 0; i < pub->count; i++) {
+        SpectateSubscriber* sub = &pub->subscribers[i];
+        if (!SpectatePublisher_keyframe(pub, sub->acked)) {
+            // can't decode anything yet, doesn't hold the others back
+            SpectatePublisher_resend(pub, sub, newest, now);
+        } else {
+            common &= (uint32_t)sub->held << (newest - sub->acked);
+        }
+    }
+    common &= (1u << SPECTATE_KEYFRAMES) - 1;
+    uint32_t base = common ? newest - __builtin_ctz(common) : newest;
+    const SpectateKeyframe* key = SpectatePublisher_keyframe(pub, base);
+    uint32_t first = pub->tick - pub->pendingCount;
+
+    uint8_t data[SPECTATE_PACKET_MAX];
+    memcpy(data, SPECTATE_MAGIC, 4);
+    data[4] = 'D';
+    put32(data + 5, base);
+    put32(data + 9, first);
+    data[13] = pub->pendingCount;
+    uint8_t* p = data + SPECTATE_HEADER;
+    int events = 0;
+    for (int i = 0; i < pub->eventCount; i++) {
+        const SpectateEvent* event = &pub->events[i];
+        if ((int32_t)(event->tick - key->tick) > 0) {
+            p = putVarint(p, event->tick - key->tick);
+            *p++ = event->scores[0];
+            *p++ = event->scores[1];
+            events++;
+        }
+    }
+    data[14] = events;
+    for (int i = 0; i < pub->pendingCount; i++) {
+        int32_t predicted[SPECTATE_FIELDS];
+        if (i == 0) {
+            SpectateFrame_predict(
+                &key->frame, NULL, first - key->tick, predicted);
+        } else {
+            SpectateFrame_predict(&pub->pending[i - 1],
+                i > 1 ? &pub->pending[i - 2] : NULL, 1, predicted);
+        }
+        p = SpectateFrame_encode(p, &pub->pending[i], predicted);
+    }
+    SpectatePublisher_broadcast(pub, data, p - data);
+    pub->pendingCount = 0;
+}
+
+void SpectatePublisher_tick(
+    SpectatePublisher* pub, const Game* game, double now)
+{
+    SpectateFrame frame = SpectateFrame_quantize(game);
+    uint32_t tick = pub->tick++;
+    uint64_t matchKey = game->rng.key ^ game->rng.stream << 32;
+    bool newMatch = !pub->nextSeq || matchKey != pub->matchKey;
+    if (newMatch) {
+        pub->match++;
+        pub->matchKey = matchKey;
+    }
+    if (tick && memcmp(frame.scores, pub->last.scores, 2) != 0) {
+        if (pub->eventCount == SPECTATE_EVENTS) {
+            memmove(pub->events, pub->events + 1,
+                (SPECTATE_EVENTS - 1) * sizeof(SpectateEvent));
+            pub->eventCount--;
+        }
+        pub->events[pub->eventCount++] = (SpectateEvent) {
+            .tick = tick,
+            .scores = { frame.scores[0], frame.scores[1] },
+        };
+    }
+    pub->last = frame;
+
+    const SpectateKeyframe* newest =
+        SpectatePublisher_keyframe(pub, pub->nextSeq - 1);
+    if (newMatch || !newest ||
+        tick - newest->tick >= SPECTATE_KEYFRAME_INTERVAL)
+    {
+        SpectateKeyframe* key =
+            &pub->keyframes[pub->nextSeq % SPECTATE_KEYFRAMES];
+        *key = (SpectateKeyframe) {
+            .seq = pub->nextSeq++,
+            .tick = tick,
+            .match = pub->match,
+            .frame = frame,
+        };
+        uint8_t data[SPECTATE_PACKET_MAX];
+        int size = SpectateKeyframe_encode(key, data);
+        SpectatePublisher_broadcast(pub, data, size);
+    }
+
+    pub->pending[pub->pendingCount++] = frame;
+    if (pub->pendingCount == SPECTATE_TICKS) {
+        SpectatePublisher_flush(pub, now);
+    }
+}
+
+bool SpectateViewer_open(SpectateViewer* viewer, const char* publisher) {
+    memset(viewer, 0, sizeof(*viewer));
+    if (!Udp_resolve(publisher, viewer->publisher)) {
+        return false;
+    }
+    viewer->fd = Udp_open(0, NULL);
+    if (viewer->fd < 0) {
+        return false;
+    }
+    viewer->newestKeyframe = SPECTATE_NONE;
+    viewer->need = SPECTATE_NONE;
+    viewer->sentAt = -SPECTATE_KEEPALIVE;
+    for (int i = 0; i < SPECTATE_BUFFER; i++) {
+        viewer->ticks[i] = SPECTATE_NONE;
+    }
+    for (int i = 0; i < SPECTATE_KEYFRAMES; i++) {
+        viewer->keyframes[i].seq = SPECTATE_NONE;
+    }
+    return true;
+}
+
+void SpectateViewer_close(SpectateViewer* viewer) {
+    if (viewer->fd >= 0) {
+        close(viewer->fd);
+        viewer->fd = -1;
+    }
+}
+
+static void SpectateViewer_store(
+    SpectateViewer* viewer, uint32_t tick, const SpectateFrame* frame)
+{
+    int slot = tick % SPECTATE_BUFFER;
+    viewer->frames[slot] = *frame;
+    viewer->ticks[slot] = tick;
+    if (!viewer->started || (int32_t)(tick - viewer->newest) > 0) {
+        viewer->newest = tick;
+        viewer->started = true;
+    }
+}
+
+static bool SpectateViewer_receiveKeyframe(
+    SpectateViewer* viewer, const uint8_t* data, int size)
+{
+    if (size < 19 + 2 * SPECTATE_FIELDS) {
+        return false;
+    }
+    SpectateKeyframe key = {
+        .seq = get32(data + 5),
+        .tick = get32(data + 9),
+        .match = get32(data + 13),
+        .frame.scores = { data[17], data[18] },
+    };
+    int32_t fields[SPECTATE_FIELDS];
+    for (int i = 0; i < SPECTATE_FIELDS; i++) {
+        fields[i] = data[19 + 2 * i] | data[20 + 2 * i] << 8;
+    }
+    key.frame.ballX = fields[0];
+    key.frame.ballY = fields[1];
+    key.frame.velX = (int16_t)fields[2];
+    key.frame.velY = (int16_t)fields[3];
+    key.frame.paddles[0] = fields[4];
+    key.frame.paddles[1] = fields[5];
+
+    viewer->keyframes[key.seq % SPECTATE_KEYFRAMES] = key;
+    SpectateViewer_store(viewer, key.tick, &key.frame);
+    if (viewer->need == key.seq) {
+        viewer->need = SPECTATE_NONE;
+    }
+    if (viewer->newestKeyframe == SPECTATE_NONE ||
+        key.seq > viewer->newestKeyframe)
+    {
+        viewer->newestKeyframe = key.seq;
+        return true;
+    }
+    return false;
+}
+
+static void SpectateViewer_receiveTicks(
+    SpectateViewer* viewer, const uint8_t* data, int size)
+{
+    if (size < SPECTATE_HEADER) {
+        return;
+    }
+    uint32_t base = get32(data + 5);
+    uint32_t first = get32(data + 9);
+    int count = data[13];
+    int eventCount = data[14];
+    const SpectateKeyframe* key =
+        &viewer->keyframes[base % SPECTATE_KEYFRAMES];
+    if (key->seq != base) {
+        viewer->undecodable++;
+        viewer->need = base;
+        return;
+    }
+
+    const uint8_t* p = data + SPECTATE_HEADER;
+    const uint8_t* end = data + size;
+    SpectateEvent events[SPECTATE_EVENTS];
+    if (eventCount > SPECTATE_EVENTS) {
+        return;
+    }
+    for (int i = 0; i < eventCount; i++) {
+        uint32_t after;
+        p = getVarint(p, end, &after);
+        if (!p || end - p < 2) {
+            return;
+        }
+        events[i] = (SpectateEvent) {
+            .tick = key->tick + after,
+            .scores = { p[0], p[1] },
+        };
+        p += 2;
+    }
+
+    SpectateFrame frames[SPECTATE_TICKS];
+    if (count > SPECTATE_TICKS) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        uint32_t tick = first + i;
+        int32_t predicted[SPECTATE_FIELDS];
+        if (i == 0) {
+            SpectateFrame_predict(
+                &key->frame, NULL, first - key->tick, predicted);
+        } else {
+            SpectateFrame_predict(
+                &frames[i - 1], i > 1 ? &frames[i - 2] : NULL, 1, predicted);
+        }
+        p = SpectateFrame_decode(p, end, &frames[i], predicted);
+        if (!p) {
+            return;
+        }
+        memcpy(frames[i].scores, key->frame.scores, 2);
+        for (int e = 0; e < eventCount; e++) {
+            if ((int32_t)(events[e].tick - tick) <= 0) {
+                memcpy(frames[i].scores, events[e].scores, 2);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        SpectateViewer_store(viewer, first + i, &frames[i]);
+    }
+}
+
+bool SpectateViewer_receive(
+    SpectateViewer* viewer, const uint8_t* data, int size)
+{
+    if (size < 5 || memcmp(data, SPECTATE_MAGIC, 4) != 0) {
+        return false;
+    }
+    viewer->packets++;
+    viewer->bytes += size;
+    if (data[4] == 'K') {
+        return SpectateViewer_receiveKeyframe(viewer, data, size);
+    }
+    if (data[4] == 'D') {
+        SpectateViewer_receiveTicks(viewer, data, size);
+    }
+    return false;
+}
+
+void SpectateViewer_ack(SpectateViewer* viewer, double now) {
+    uint8_t held = 0;
+    uint32_t newest = viewer->newestKeyframe;
+    for (int i = 0; i < SPECTATE_KEYFRAMES && newest != SPECTATE_NONE; i++) {
+        uint32_t seq = newest - i;
+        if (viewer->keyframes[seq % SPECTATE_KEYFRAMES].seq == seq) {
+            held |= 1 << i;
+        }
+    }
+    uint8_t data[14];
+    memcpy(data, SPECTATE_MAGIC, 4);
+    data[4] = 'S';
+    put32(data + 5, newest);
+    put32(data + 9, viewer->need);
+    data[13] = held;
+    sendto(viewer->fd, data, sizeof(data), 0,
+        (struct sockaddr*)viewer->publisher, sizeof(struct sockaddr_in));
+    viewer->sentAt = now;
+}
+
+void SpectateViewer_poll(SpectateViewer* viewer, double now) {
+    bool ack = now - viewer->sentAt >= SPECTATE_KEEPALIVE;
+    uint8_t data[SPECTATE_PACKET_MAX];
+    for (;;) {
+        ssize_t size = recv(viewer->fd, data, sizeof(data), 0);
+        if (size < 0) {
+            break;
+        }
+        uint32_t need = viewer->need;
+        ack = SpectateViewer_receive(viewer, data, size) || ack ||
+            (viewer->need != SPECTATE_NONE && viewer->need != need);
+    }
+    // asks again until the keyframe gets through
+    ack = ack || (viewer->need != SPECTATE_NONE &&
+        now - viewer->sentAt >= SPECTATE_RESEND);
+    if (ack) {
+        SpectateViewer_ack(viewer, now);
+    }
+}
+
+bool SpectateViewer_frame(
+    const SpectateViewer* viewer, uint32_t tick, SpectateFrame* frame)
+{
+    int slot = tick % SPECTATE_BUFFER;
+    if (viewer->ticks[slot] != tick) {
+        return false;
+    }
+    *frame = viewer->frames[slot];
+    return true;
+}
+
+void SpectateClock_advance(
+    SpectateClock* clock, const SpectateViewer* viewer, double ticks)
+{
+    if (!viewer->started) {
+        return;
+    }
+    double target = (double)viewer->newest - SPECTATE_DELAY;
+    if (!clock->playing || fabs(target - clock->tick) > 3 * SPECTATE_TICKS) {
+        // starting, or too far off after a stall, jump
+        clock->tick = target;
+        clock->playing = true;
+        return;
+    }
+    // packets come in bursts, ease towards the target instead of chasing
+    clock->tick += ticks + (target - clock->tick) * 0.02;
+}
+
+bool SpectateViewer_at(
+    const SpectateViewer* viewer, double tick, Game* game)
+{
+    if (tick < 0) {
+        return false;
+    }
+    uint32_t floorTick = (uint32_t)tick;
+    SpectateFrame from;
+    SpectateFrame to;
+    if (!SpectateViewer_frame(viewer, floorTick, &from)) {
+        return false;
+    }
+    SpectateFrame_apply(&from, game);
+    if (!SpectateViewer_frame(viewer, floorTick + 1, &to)) {
+        return true;
+    }
+    Game next = *game;
+    SpectateFrame_apply(&to, &next);
+    float alpha = tick - floorTick;
+    #define lerp(a, b) ((a) + ((b) - (a)) * alpha)
+    game->ball.pos.x = lerp(game->ball.pos.x, next.ball.pos.x);
+    game->ball.pos.y = lerp(game->ball.pos.y, next.ball.pos.y);
+    game->players[0].y = lerp(game->players[0].y, next.players[0].y);
+    game->players[1].y = lerp(game->players[1].y, next.players[1].y);
+    #undef lerp
+    return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sim.h"
+
+// Live match broadcast to passive viewers over UDP, IPv4
+// The publisher quantizes every tick and sends SPECTATE_TICKS of them per
+// packet. The first is delta coded against the newest keyframe every
+// viewer reports holding, the rest against the tick before. A packet is
+// encoded once and the same bytes go to every viewer with sendmmsg.
+// Keyframes go out every SPECTATE_KEYFRAME_INTERVAL ticks and on a new
+// match. A viewer that missed the keyframe a packet needs asks for it every
+// SPECTATE_RESEND until it arrives, and only that viewer gets a copy. Score
+// changes since the packet's keyframe ride along as events in every packet,
+// so a lost packet never loses a point. Viewers subscribe by sending to the publisher and are forgotten
+// after SPECTATE_TIMEOUT of silence.
+//
+// Packets, little endian, after the 4 byte magic and a type byte:
+//   'K' keyframe  seq u32, tick u32, match u32, score0 u8, score1 u8,
+//                 then the frame: ballX ballY velX velY paddle0 paddle1
+//                 as 16 bit fields
+//   'D' ticks     base seq u32, first tick u32, count u8, event count u8,
+//                 events (ticks after the base varint, score0 u8, score1
+//                 u8), then per tick a mask of the fields that missed
+//                 their prediction and a zigzag varint for each. The ball
+//                 is predicted to keep its velocity and a paddle its speed
+//                 since the tick before, so most ticks are a byte or two.
+//   'S' viewer    newest keyframe seq held u32, needed seq u32, both
+//                 UINT32_MAX for none, held mask u8, bit i set if the
+//                 viewer holds keyframe newest - i
+
+#define SPECTATE_MAGIC "PSP2"
+#define SPECTATE_TICKS 6 // per packet, 10 packets a second at 60 Hz
+#define SPECTATE_KEYFRAME_INTERVAL 120
+#define SPECTATE_KEYFRAMES 8 // kept on both sides
+#define SPECTATE_EVENTS 16 // score changes kept
+#define SPECTATE_BUFFER 128 // decoded ticks a viewer keeps, power of two
+#define SPECTATE_TIMEOUT 5.0 // seconds
+#define SPECTATE_KEEPALIVE 1.0 // seconds between a viewer's acks
+#define SPECTATE_RESEND 0.1 // seconds between keyframes sent to one viewer
+#define SPECTATE_PACKET_MAX 512
+#define SPECTATE_POS_SCALE 16384.0f // units per field, from -1
+#define SPECTATE_VEL_SCALE 65536.0f // units per field per tick
+#define SPECTATE_NONE UINT32_MAX
+#define SPECTATE_DELAY (2 * SPECTATE_TICKS) // viewers play this far behind
+
+// One tick, quantized
+typedef struct {
+    uint16_t ballX;
+    uint16_t ballY;
+    int16_t velX;
+    int16_t velY;
+    uint16_t paddles[2];
+    uint8_t scores[2]; // not delta coded, from keyframes and events
+} SpectateFrame;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t tick;
+    uint32_t match;
+    SpectateFrame frame;
+} SpectateKeyframe;
+
+typedef struct {
+    uint32_t tick;
+    uint8_t scores[2];
+} SpectateEvent;
+
+SpectateFrame SpectateFrame_quantize(const Game* game);
+// Dequantized back into a game that only has what drawing needs
+void SpectateFrame_apply(const SpectateFrame* frame, Game* game);
+
+// Publisher side
+typedef struct {
+    _Alignas(8) uint8_t addr[16]; // sockaddr_in
+    uint32_t acked; // newest keyframe it holds
+    uint8_t held; // bit i set if it holds keyframe acked - i
+    double heard; // last packet from it
+    double resent; // last keyframe sent to it alone
+} SpectateSubscriber;
+
+typedef struct {
+    int fd;
+    SpectateSubscriber* subscribers;
+    size_t count;
+    size_t capacity;
+    uint32_t* index; // open addressing on the address, subscriber + 1
+    size_t indexSize; // power of two, at least twice capacity
+    void* messages; // mmsghdr per subscriber for sendmmsg
+
+    uint32_t tick; // ticks published
+    uint32_t match; // changes with the game's seed and match id
+    uint64_t matchKey;
+    SpectateKeyframe keyframes[SPECTATE_KEYFRAMES]; // by seq
+    uint32_t nextSeq;
+    SpectateEvent events[SPECTATE_EVENTS]; // oldest first
+    int eventCount;
+    SpectateFrame pending[SPECTATE_TICKS];
+    int pendingCount;
+    SpectateFrame last; // latest tick, for score changes
+    double pruned; // when silent subscribers were last dropped
+
+    uint64_t packets; // encoded once
+    uint64_t sent; // datagrams, a packet is sent once per subscriber
+    uint64_t bytes; // of payload sent
+    uint64_t resent; // keyframes sent to one subscriber
+    uint64_t failed; // sends the kernel refused
+} SpectatePublisher;
+
+bool SpectatePublisher_open(SpectatePublisher* pub, int port);
+void SpectatePublisher_close(SpectatePublisher* pub);
+// Reads subscriptions and acks, drops silent viewers. now is in seconds
+// on any monotonic clock.
+void SpectatePublisher_poll(SpectatePublisher* pub, double now);
+// After every tick of the match, or of the next one
+void SpectatePublisher_tick(
+    SpectatePublisher* pub, const Game* game, double now);
+
+// Viewer side
+typedef struct {
+    int fd;
+    _Alignas(8) uint8_t publisher[16]; // sockaddr_in
+    SpectateKeyframe keyframes[SPECTATE_KEYFRAMES]; // by seq
+    uint32_t newestKeyframe; // SPECTATE_NONE before the first
+    uint32_t need; // keyframe asked for, SPECTATE_NONE when none
+    SpectateFrame frames[SPECTATE_BUFFER]; // by tick
+    uint32_t ticks[SPECTATE_BUFFER]; // which tick each slot holds
+    uint32_t newest; // latest decoded tick
+    bool started; // newest is valid
+    double sentAt; // last ack
+
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t undecodable; // packets whose keyframe was missing
+} SpectateViewer;
+
+// publisher is "host:port"
+bool SpectateViewer_open(SpectateViewer* viewer, const char* publisher);
+void SpectateViewer_close(SpectateViewer* viewer);
+// Reads every waiting packet and acks keyframes
+void SpectateViewer_poll(SpectateViewer* viewer, double now);
+// Decodes a datagram, for callers reading the socket themselves.
+// Returns whether it was a new keyframe, which poll acks at once.
+bool SpectateViewer_receive(
+    SpectateViewer* viewer, const uint8_t* data, int size);
+void SpectateViewer_ack(SpectateViewer* viewer, double now);
+// The decoded state of tick, false if it was never received or is too old
+bool SpectateViewer_frame(
+    const SpectateViewer* viewer, uint32_t tick, SpectateFrame* frame);
+
+// Viewer playback, SPECTATE_DELAY ticks behind the newest decoded so the
+// next packet is usually in before it's needed
+typedef struct {
+    double tick;
+    bool playing;
+} SpectateClock;
+
+// ticks is how many passed since the last call, frame time * tick rate
+void SpectateClock_advance(
+    SpectateClock* clock, const SpectateViewer* viewer, double ticks);
+// The state at a fractional tick, blended between the two around it, into
+// a game that only has what drawing needs. False if neither was received.
+bool SpectateViewer_at(
+    const SpectateViewer* viewer, double tick, Game* game);
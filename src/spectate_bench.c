@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include "spectate.h"
+#include "timing.h"
+
+// Broadcasts cpu against cpu matches to many viewers over loopback
+// A publisher thread plays at 60 Hz in real time and keeps every tick it
+// sent, a second thread runs all the viewers over epoll, each with its
+// own socket, and checks every tick it decodes against the publisher's.
+// Reports the publisher's share of a core and the bandwidth per viewer,
+// counting the 28 bytes of IPv4 and UDP headers of every datagram too.
+//
+// usage: spectate_bench [options]
+//   --viewers N        subscribers (10000)
+//   --seconds S        broadcast length (10)
+//   --loss PCT         packets each viewer drops on arrival (0)
+//   --port PORT        publisher port (7800)
+
+#define SPECTATE_BENCH_SEED 1
+#define SPECTATE_BENCH_RATE 60
+#define UDP_OVERHEAD 28
+
+typedef struct {
+    int port;
+    uint32_t ticks;
+    SpectateFrame* truth; // every tick sent
+    _Atomic uint32_t published; // ticks in truth
+    _Atomic bool done;
+
+    // publisher results
+    double cpu;
+    double elapsed;
+    double maxTick;
+    uint32_t matches;
+    uint64_t packets;
+    uint64_t sent;
+    uint64_t bytes;
+    uint64_t resent;
+    uint64_t failed;
+    size_t subscribers;
+} Broadcast;
+
+static void* publish(void* arg) {
+    Broadcast* broadcast = arg;
+    SpectatePublisher pub;
+    if (!SpectatePublisher_open(&pub, broadcast->port)) {
+        atomic_store(&broadcast->done, true);
+        return NULL;
+    }
+    uint64_t match = 0;
+    Game game = Game_initMatch(CPU_VS_CPU, SPECTATE_BENCH_SEED, match);
+    double start = now();
+    double cpuStart = threadCpu();
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (uint32_t t = 0; t < broadcast->ticks; t++) {
+        double tickStart = now();
+        SpectatePublisher_poll(&pub, tickStart);
+        Game_step(&game, GAME_INPUT_IDLE, NULL);
+        if (game.ended) {
+            game = Game_initMatch(CPU_VS_CPU, SPECTATE_BENCH_SEED, ++match);
+        }
+        broadcast->truth[t] = SpectateFrame_quantize(&game);
+        atomic_store_explicit(
+            &broadcast->published, t + 1, memory_order_release);
+        SpectatePublisher_tick(&pub, &game, tickStart);
+        double tickTime = now() - tickStart;
+        if (tickTime > broadcast->maxTick && t > SPECTATE_BENCH_RATE) {
+            // after the first second of subscriptions
+            broadcast->maxTick = tickTime;
+        }
+
+        next.tv_nsec += 1000000000 / SPECTATE_BENCH_RATE;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    broadcast->cpu = threadCpu() - cpuStart;
+    broadcast->elapsed = now() - start;
+    broadcast->matches = match + 1;
+    broadcast->packets = pub.packets;
+    broadcast->sent = pub.sent;
+    broadcast->bytes = pub.bytes;
+    broadcast->resent = pub.resent;
+    broadcast->failed = pub.failed;
+    broadcast->subscribers = pub.count;
+    SpectatePublisher_close(&pub);
+    atomic_store(&broadcast->done, true);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    size_t count = 10000;
+    double seconds = 10;
+    double loss = 0;
+    int port = 7800;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--viewers") == 0) {
+            count = strtoull(argv[i + 1], NULL, 0);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--loss") == 0) {
+            loss = atof(argv[i + 1]) / 100;
+        } else if (strcmp(argv[i], "--port") == 0) {
+            port = atoi(argv[i + 1]);
+        }
+    }
+
+    // a socket per viewer
+    struct rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    if (files.rlim_cur < count + 64 && files.rlim_max > files.rlim_cur) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    if (count + 64 > files.rlim_cur) {
+        count = files.rlim_cur > 64 ? files.rlim_cur - 64 : 1;
+        printf("only %zu viewers fit the open file limit\n", count);
+    }
+
+    Broadcast broadcast = {
+        .port = port,
+        .ticks = seconds * SPECTATE_BENCH_RATE,
+    };
+    broadcast.truth = malloc(broadcast.ticks * sizeof(SpectateFrame));
+    SpectateViewer* viewers = malloc(count * sizeof(SpectateViewer));
+    char address[64];
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+    int epoll = epoll_create1(0);
+    for (size_t i = 0; i < count; i++) {
+        if (!SpectateViewer_open(&viewers[i], address)) {
+            return 1;
+        }
+        int buffer = 1 << 16;
+        setsockopt(viewers[i].fd, SOL_SOCKET, SO_RCVBUF,
+            &buffer, sizeof(buffer));
+        struct epoll_event event = { .events = EPOLLIN, .data.u64 = i };
+        epoll_ctl(epoll, EPOLL_CTL_ADD, viewers[i].fd, &event);
+    }
+
+    pthread_t publisher;
+    pthread_create(&publisher, NULL, publish, &broadcast);
+
+    Rng rng = Rng_init(SPECTATE_BENCH_SEED, 1);
+    uint64_t checked = 0;
+    uint64_t mismatched = 0;
+    uint64_t dropped = 0;
+    double swept = 0;
+    double cpuStart = threadCpu();
+    struct epoll_event events[256];
+    while (!atomic_load(&broadcast.done)) {
+        int ready = epoll_wait(epoll, events, 256, 10);
+        double time = now();
+        for (int e = 0; e < ready; e++) {
+            SpectateViewer* viewer = &viewers[events[e].data.u64];
+            bool ack = false;
+            uint8_t data[SPECTATE_PACKET_MAX];
+            ssize_t size;
+            // SpectateViewer_poll, with the loss
+            while ((size = recv(viewer->fd, data, sizeof(data), 0)) >= 0) {
+                if (loss > 0 && Rng_next(&rng) < loss * 4294967296.0) {
+                    dropped++;
+                    continue;
+                }
+                uint32_t need = viewer->need;
+                uint32_t newest = viewer->newest;
+                ack = SpectateViewer_receive(viewer, data, size) || ack ||
+                    (viewer->need != SPECTATE_NONE && viewer->need != need);
+                if (viewer->started && viewer->newest != newest) {
+                    uint32_t published = atomic_load_explicit(
+                        &broadcast.published, memory_order_acquire);
+                    SpectateFrame frame;
+                    SpectateViewer_frame(viewer, viewer->newest, &frame);
+                    checked++;
+                    if (viewer->newest >= published ||
+                        memcmp(&frame, &broadcast.truth[viewer->newest],
+                            sizeof(frame)) != 0)
+                    {
+                        mismatched++;
+                    }
+                }
+            }
+            if (ack || time - viewer->sentAt >= SPECTATE_KEEPALIVE ||
+                (viewer->need != SPECTATE_NONE &&
+                    time - viewer->sentAt >= SPECTATE_RESEND))
+            {
+                SpectateViewer_ack(viewer, time);
+            }
+        }
+        if (time - swept >= 0.1) {
+            // subscribes, and retries for viewers nothing reached yet
+            for (size_t i = 0; i < count; i++) {
+                if (time - viewers[i].sentAt >= SPECTATE_KEEPALIVE) {
+                    SpectateViewer_ack(&viewers[i], time);
+                }
+            }
+            swept = time;
+        }
+    }
+    double viewerCpu = threadCpu() - cpuStart;
+    pthread_join(publisher, NULL);
+
+    // every tick of the last few seconds each viewer still holds
+    uint32_t ticks = broadcast.ticks;
+    uint64_t held = 0;
+    uint64_t expected = 0;
+    size_t behind = 0;
+    uint64_t undecodable = 0;
+    for (size_t i = 0; i < count; i++) {
+        SpectateViewer* viewer = &viewers[i];
+        for (uint32_t t = ticks > SPECTATE_BUFFER ? ticks - SPECTATE_BUFFER : 0;
+            t + SPECTATE_TICKS <= ticks; t++)
+        {
+            SpectateFrame frame;
+            expected++;
+            if (SpectateViewer_frame(viewer, t, &frame)) {
+                held++;
+                if (memcmp(&frame, &broadcast.truth[t], sizeof(frame)) != 0) {
+                    mismatched++;
+                }
+            }
+        }
+        if (!viewer->started || ticks - viewer->newest > 2 * SPECTATE_TICKS) {
+            behind++;
+        }
+        undecodable += viewer->undecodable;
+        SpectateViewer_close(viewer);
+    }
+
+    double elapsed = broadcast.elapsed;
+    double perViewer = (double)broadcast.bytes / count / elapsed;
+    double wire = (double)(broadcast.bytes + broadcast.sent * UDP_OVERHEAD) /
+        count / elapsed;
+    printf("viewers       %zu, %zu subscribed at the end, %zu behind\n",
+        count, broadcast.subscribers, behind);
+    printf("broadcast     %.1f s, %u ticks, %u matches, %llu packets "
+        "encoded, %llu datagrams\n",
+        elapsed, ticks, broadcast.matches,
+        (unsigned long long)broadcast.packets,
+        (unsigned long long)broadcast.sent);
+    printf("publisher     %.1f%% of a core, slowest tick %.2f ms\n",
+        broadcast.cpu / elapsed * 100, broadcast.maxTick * 1000);
+    printf("viewers cpu   %.1f%% of a core\n", viewerCpu / elapsed * 100);
+    printf("per viewer    %.0f B/s payload, %.0f B/s with headers\n",
+        perViewer, wire);
+    printf("keyframes     %llu resent, %llu sends failed, %llu packets "
+        "dropped by --loss, %llu undecodable\n",
+        (unsigned long long)broadcast.resent,
+        (unsigned long long)broadcast.failed,
+        (unsigned long long)dropped, (unsigned long long)undecodable);
+    printf("check         %llu live ticks and %.1f%% of the last %d held, "
+        "%llu differ from the publisher\n",
+        (unsigned long long)checked,
+        expected ? held * 100.0 / expected : 0.0,
+        SPECTATE_BUFFER - SPECTATE_TICKS, (unsigned long long)mismatched);
+    free(viewers);
+    free(broadcast.truth);
+    return mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+#include "swarm.h"
+#include <math.h>
+#include <string.h>
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define clamp(x, l, u) ((x) < (l) ? (l) : (x) > (u) ? (u) : (x))
+
+
+static uint32_t Swarm_key(const Swarm* swarm, float x, float y) {
+    int col = clamp((int)(x * swarm->cols), 0, swarm->cols - 1);
+    int row = clamp((int)(y * swarm->cols), 0, swarm->cols - 1);
+    return (uint32_t)row * swarm->cols + col;
+}
+
+// From the middle, up to 45 degrees off either goal
+static void Swarm_serve(Swarm* swarm, size_t i) {
+    float angle = Rng_range(&swarm->rng, -45, 45) * 3.14159265f / 180;
+    float side = Rng_range(&swarm->rng, 0, 1) ? 1 : -1;
+    swarm->x[i] = 0.5;
+    swarm->y[i] = Rng_range(&swarm->rng, 10, 90) / 100.f;
+    swarm->vx[i] = cosf(angle) * swarm->speed * side;
+    swarm->vy[i] = sinf(angle) * swarm->speed;
+}
+
+// Counting sort by key, stable, so balls sharing a cell keep their order.
+// The input is last tick's order, so each cell's balls are read and written
+// nearly in sequence.
+static void Swarm_sort(Swarm* swarm) {
+    size_t cells = (size_t)swarm->cols * swarm->cols;
+    memset(swarm->cells, 0, (cells + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < swarm->count; i++) {
+        swarm->cells[swarm->key[i] + 1]++;
+    }
+    for (size_t c = 0; c < cells; c++) {
+        swarm->cells[c + 1] += swarm->cells[c];
+    }
+    float* fields[4] = { swarm->x, swarm->y, swarm->vx, swarm->vy };
+    for (size_t i = 0; i < swarm->count; i++) {
+        uint32_t to = swarm->cells[swarm->key[i]]++;
+        for (int f = 0; f < 4; f++) {
+            swarm->scratch[f][to] = fields[f][i];
+        }
+        swarm->scratchKey[to] = swarm->key[i];
+    }
+    swarm->x = swarm->scratch[0];
+    swarm->y = swarm->scratch[1];
+    swarm->vx = swarm->scratch[2];
+    swarm->vy = swarm->scratch[3];
+    for (int f = 0; f < 4; f++) {
+        swarm->scratch[f] = fields[f];
+    }
+    uint32_t* key = swarm->key;
+    swarm->key = swarm->scratchKey;
+    swarm->scratchKey = key;
+}
+
+Swarm Swarm_new(size_t count, uint64_t seed) {
+    float size = min(ballWidth, sqrtf(SWARM_COVERAGE / (count ? count : 1)));
+    Swarm swarm = {
+        .count = count,
+        .size = size,
+        .speed = min(ballSpeedSlow, size / 2),
+        // cells at least as wide as a ball
+        .cols = (int)(1 / size),
+        .rng = Rng_init(seed, 0),
+        .paddles = { 0.5, 0.5 },
+        .cpu = { true, true },
+    };
+    size_t cells = (size_t)swarm.cols * swarm.cols;
+    swarm.x = malloc(count * sizeof(float));
+    swarm.y = malloc(count * sizeof(float));
+    swarm.vx = malloc(count * sizeof(float));
+    swarm.vy = malloc(count * sizeof(float));
+    swarm.key = malloc(count * sizeof(uint32_t));
+    for (int f = 0; f < 4; f++) {
+        swarm.scratch[f] = malloc(count * sizeof(float));
+    }
+    swarm.scratchKey = malloc(count * sizeof(uint32_t));
+    swarm.cells = malloc((cells + 1) * sizeof(uint32_t));
+
+    // spread over the field instead of all in the middle
+    for (size_t i = 0; i < count; i++) {
+        Swarm_serve(&swarm, i);
+        swarm.x[i] = Rng_range(&swarm.rng, 20, 80) / 100.f;
+        swarm.key[i] = Swarm_key(&swarm, swarm.x[i], swarm.y[i]);
+    }
+    Swarm_sort(&swarm);
+    return swarm;
+}
+
+void Swarm_del(Swarm* swarm) {
+    free(swarm->x);
+    free(swarm->y);
+    free(swarm->vx);
+    free(swarm->vy);
+    free(swarm->key);
+    for (int f = 0; f < 4; f++) {
+        free(swarm->scratch[f]);
+    }
+    free(swarm->scratchKey);
+    free(swarm->cells);
+}
+
+// Moves the balls, bounces them off walls and paddles, serves the ones
+// past a goal and takes their new keys
+static void Swarm_move(Swarm* swarm, float cpuTarget[2]) {
+    float half = swarm->size / 2;
+    float paddleTop[2], paddleBottom[2];
+    for (int pn = 0; pn < 2; pn++) {
+        paddleTop[pn] = swarm->paddles[pn] - boardHeight / 2 - half;
+        paddleBottom[pn] = swarm->paddles[pn] + boardHeight / 2 + half;
+    }
+    // ball x ranges that touch each paddle
+    float p0Left = p0x - boardHalfWidth - half;
+    float p0Right = p0x + boardHalfWidth + half;
+    float p1Left = p1x - boardHalfWidth - half;
+    float p1Right = p1x + boardHalfWidth + half;
+    // the cpu goes for the ball that reaches it first
+    float nearest[2] = { INFINITY, INFINITY };
+    cpuTarget[0] = cpuTarget[1] = 0.5;
+    for (size_t i = 0; i < swarm->count; i++) {
+        float x = swarm->x[i] + swarm->vx[i];
+        float y = swarm->y[i] + swarm->vy[i];
+        if (y < half) {
+            y = half;
+            swarm->vy[i] = fabsf(swarm->vy[i]);
+        } else if (y > 1 - half) {
+            y = 1 - half;
+            swarm->vy[i] = -fabsf(swarm->vy[i]);
+        }
+        float vx = swarm->vx[i];
+        if (vx < 0 && x > p0Left && x < p0Right &&
+            y > paddleTop[0] && y < paddleBottom[0])
+        {
+            swarm->vx[i] = vx = -vx;
+        } else if (vx > 0 && x > p1Left && x < p1Right &&
+            y > paddleTop[1] && y < paddleBottom[1])
+        {
+            swarm->vx[i] = vx = -vx;
+        }
+        swarm->x[i] = x;
+        swarm->y[i] = y;
+        if (x < 0 || x > 1) {
+            swarm->scores[x < 0]++;
+            Swarm_serve(swarm, i);
+        } else {
+            int pn = vx > 0;
+            float distance = pn ? p1x - x : x - p0x;
+            if (distance > 0 && distance < nearest[pn]) {
+                nearest[pn] = distance;
+                cpuTarget[pn] = y;
+            }
+        }
+        swarm->key[i] = Swarm_key(swarm, swarm->x[i], swarm->y[i]);
+    }
+}
+
+// Equal masses, so an elastic bounce swaps the velocities along the axis
+// of least overlap. The pair is pushed apart along it too.
+static inline bool Swarm_collide(Swarm* swarm, size_t i, size_t j) {
+    float dx = swarm->x[j] - swarm->x[i];
+    float dy = swarm->y[j] - swarm->y[i];
+    float overlapX = swarm->size - fabsf(dx);
+    float overlapY = swarm->size - fabsf(dy);
+    if (overlapX <= 0 || overlapY <= 0) {
+        return false;
+    }
+    if (overlapX < overlapY) {
+        float push = copysignf(overlapX / 2, dx);
+        swarm->x[i] -= push;
+        swarm->x[j] += push;
+        if ((swarm->vx[j] - swarm->vx[i]) * dx < 0) {
+            float v = swarm->vx[i];
+            swarm->vx[i] = swarm->vx[j];
+            swarm->vx[j] = v;
+        }
+    } else {
+        float push = copysignf(overlapY / 2, dy);
+        swarm->y[i] -= push;
+        swarm->y[j] += push;
+        if ((swarm->vy[j] - swarm->vy[i]) * dy < 0) {
+            float v = swarm->vy[i];
+            swarm->vy[i] = swarm->vy[j];
+            swarm->vy[j] = v;
+        }
+    }
+    return true;
+}
+
+// Visits every pair in the same or adjacent cells once, collide decides
+// whether to resolve or only count
+static uint64_t Swarm_pairs(Swarm* swarm, bool resolve) {
+    const uint32_t* key = swarm->key;
+    size_t n = swarm->count;
+    uint32_t cols = swarm->cols;
+    uint64_t contacts = 0;
+    uint64_t pairs = 0;
+    size_t below = 0; // first ball at or after the cells below i's
+    for (size_t i = 0; i < n; i++) {
+        uint32_t k = key[i];
+        // rest of its own cell and the cell to the right
+        for (size_t j = i + 1; j < n && key[j] <= k + 1; j++) {
+            pairs++;
+            contacts += resolve ?
+                Swarm_collide(swarm, i, j) :
+                fabsf(swarm->x[j] - swarm->x[i]) < swarm->size &&
+                fabsf(swarm->y[j] - swarm->y[i]) < swarm->size;
+        }
+        // the three cells below, wrapping at the row's ends is harmless
+        // since the narrowphase rejects those
+        uint32_t from = k + cols - 1;
+        while (below < n && key[below] < from) {
+            below++;
+        }
+        for (size_t j = below; j < n && key[j] <= from + 2; j++) {
+            pairs++;
+            contacts += resolve ?
+                Swarm_collide(swarm, i, j) :
+                fabsf(swarm->x[j] - swarm->x[i]) < swarm->size &&
+                fabsf(swarm->y[j] - swarm->y[i]) < swarm->size;
+        }
+    }
+    swarm->pairs += pairs;
+    return contacts;
+}
+
+static void Swarm_movePaddles(
+    Swarm* swarm, GameInput input, const float cpuTarget[2])
+{
+    for (int pn = 0; pn < 2; pn++) {
+        float* y = &swarm->paddles[pn];
+        if (swarm->cpu[pn]) {
+            float dy = cpuTarget[pn] - *y;
+            *y += clamp(dy, -pdy, pdy);
+        } else if (input.dy[pn]) {
+            *y += input.dy[pn] < 0 ? -pdy : pdy;
+        }
+        *y = clamp(*y, boardHeight / 2, 1 - boardHeight / 2);
+    }
+}
+
+void Swarm_step(Swarm* swarm, GameInput input) {
+    float cpuTarget[2];
+    Swarm_move(swarm, cpuTarget);
+    Swarm_movePaddles(swarm, input, cpuTarget);
+    Swarm_sort(swarm);
+    swarm->contacts += Swarm_pairs(swarm, true);
+    swarm->ticks++;
+}
+
+uint64_t Swarm_bruteContacts(const Swarm* swarm) {
+    uint64_t contacts = 0;
+    for (size_t i = 0; i < swarm->count; i++) {
+        for (size_t j = i + 1; j < swarm->count; j++) {
+            contacts +=
+                fabsf(swarm->x[j] - swarm->x[i]) < swarm->size &&
+                fabsf(swarm->y[j] - swarm->y[i]) < swarm->size;
+        }
+    }
+    return contacts;
+}
+
+uint64_t Swarm_contacts(Swarm* swarm) {
+    // collisions pushed balls since their keys were taken
+    for (size_t i = 0; i < swarm->count; i++) {
+        swarm->key[i] = Swarm_key(swarm, swarm->x[i], swarm->y[i]);
+    }
+    Swarm_sort(swarm);
+    uint64_t pairs = swarm->pairs;
+    uint64_t contacts = Swarm_pairs(swarm, false);
+    swarm->pairs = pairs;
+    return contacts;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "sim.h"
+
+// Arena mode, one pair of paddles against any number of balls
+// Balls bounce off the walls, the paddles and each other, a ball leaving
+// through a goal scores for the other side and is served again from the
+// middle. Balls shrink and slow down as their number grows so they never
+// move more than half their size in a tick, which keeps discrete collision
+// from tunneling.
+//
+// Broadphase is a uniform grid with cells the size of a ball, without a
+// per cell list. Balls are sorted by cell, row by row, every tick, so the
+// balls of a cell and its right neighbour are contiguous, and the three
+// cells below are one more contiguous run found by a pointer that only
+// moves forward. Fields are separate arrays in that order, so balls that
+// are neighbours on the field are neighbours in memory too.
+
+#define SWARM_COVERAGE 0.1f // share of the field covered by balls at most
+
+typedef struct {
+    size_t count;
+    float size; // ball width
+    float speed; // per tick, the same for every ball
+    int cols; // grid cells per row and per column
+    Rng rng;
+
+    // one entry per ball, sorted by key
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    uint32_t* key; // row * cols + column of the ball's center
+
+    // sort scratch, same fields, and a count per cell
+    float* scratch[4];
+    uint32_t* scratchKey;
+    uint32_t* cells;
+
+    float paddles[2];
+    bool cpu[2]; // follows the ball nearest to its goal
+    uint32_t scores[2];
+
+    uint64_t ticks;
+    uint64_t contacts; // ball pairs that collided
+    uint64_t pairs; // ball pairs the broadphase tested
+} Swarm;
+
+Swarm Swarm_new(size_t count, uint64_t seed);
+void Swarm_del(Swarm* swarm);
+// Human paddles move like in Game_step, input is ignored for cpu ones
+void Swarm_step(Swarm* swarm, GameInput input);
+// Ball pairs overlapping right now by testing every pair, for checking the
+// broadphase, O(count^2)
+uint64_t Swarm_bruteContacts(const Swarm* swarm);
+// Same with the grid, sorts the balls again first
+uint64_t Swarm_contacts(Swarm* swarm);
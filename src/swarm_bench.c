@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "swarm.h"
+#include "timing.h"
+
+// How Swarm_step scales with the number of balls, cpu against cpu
+// usage: swarm_bench [ticks] [max balls] [check]
+// Steps from 1000 balls up to max balls (default 100000), 1, 2.5 and 5
+// times each power of ten, and times ticks ticks of each after a second of
+// warm up. check also compares the
+// grid's contacts with testing every pair, every 60 ticks up to 8000 balls.
+
+#define SWARM_BENCH_WARMUP 60
+#define SWARM_BENCH_CHECK_MAX 8000
+
+// False on the first tick whose contacts differ
+bool run(size_t balls, size_t ticks, bool check) {
+    Swarm swarm = Swarm_new(balls, 1);
+    for (int t = 0; t < SWARM_BENCH_WARMUP; t++) {
+        Swarm_step(&swarm, GAME_INPUT_IDLE);
+    }
+    uint64_t contacts = swarm.contacts;
+    uint64_t pairs = swarm.pairs;
+    double elapsed = 0;
+    bool same = true;
+    for (size_t t = 0; t < ticks && same; t++) {
+        double start = now();
+        Swarm_step(&swarm, GAME_INPUT_IDLE);
+        elapsed += now() - start;
+        if (check && balls <= SWARM_BENCH_CHECK_MAX && t % 60 == 0) {
+            uint64_t grid = Swarm_contacts(&swarm);
+            uint64_t brute = Swarm_bruteContacts(&swarm);
+            if (grid != brute) {
+                printf("tick %zu with %zu balls: grid found %llu contacts, "
+                    "every pair %llu\n", t, balls,
+                    (unsigned long long)grid, (unsigned long long)brute);
+                same = false;
+            }
+        }
+    }
+
+    double tick = elapsed / ticks;
+    printf("%7zu %10.1f %8.1f %9.0f %7.1f%% %9.1f %7.2f\n",
+        balls, tick * 1e6, tick * 1e9 / balls, 1 / tick,
+        tick * 60 * 100,
+        (double)(swarm.contacts - contacts) / ticks,
+        (double)(swarm.pairs - pairs) / ticks / balls);
+    Swarm_del(&swarm);
+    return same;
+}
+
+int main(int argc, char** argv) {
+    size_t ticks = argc > 1 ? strtoull(argv[1], NULL, 0) : 600;
+    size_t maxBalls = argc > 2 ? strtoull(argv[2], NULL, 0) : 100000;
+    bool check = argc > 3 && strcmp(argv[3], "check") == 0;
+
+    printf("  balls    us/tick  ns/ball   ticks/s  60 Hz   contacts   pairs\n");
+    int status = 0;
+    for (size_t step = 0; ; step++) {
+        size_t power = 1000;
+        for (size_t i = 0; i < step / 3; i++) {
+            power *= 10;
+        }
+        size_t balls = power * (size_t[]){ 2, 5, 10 }[step % 3] / 2;
+        balls = balls < maxBalls ? balls : maxBalls;
+        if (!run(balls, ticks, check)) {
+            status = 1;
+        }
+        if (balls == maxBalls) {
+            break;
+        }
+    }
+    if (check && status == 0) {
+        printf("check          grid contacts match every pair\n");
+    }
+    return status;
+}
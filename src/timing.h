@@ -0,0 +1,27 @@
+#pragma once
+
+#include <time.h>
+
+// Clocks and sorting for timing things
+// clock_gettime needs _POSIX_C_SOURCE 199309L before the first include
+
+// Seconds on the monotonic clock
+static inline double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Seconds of cpu used by the calling thread
+static inline double threadCpu(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// For qsort, ascending
+static inline int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
@@ -0,0 +1,284 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "pool.h"
+#include "sim.h"
+#include "timing.h"
+
+// CPU against CPU tournament for tuning CpuParams
+// Every swept configuration plays the baseline (CPU_PARAMS_DEFAULT) on both
+// sides of the field. All configurations use the same match streams, so
+// results only depend on the seed, never on thread count or scheduling.
+//
+// usage: tournament [options]
+//   --matches N        matches per configuration (10000)
+//   --threads N        worker threads, 0 for one per cpu (0)
+//   --seed S           seed, match m uses rng stream m (1)
+//   --max-ticks N      ticks before a match is called a draw (200000)
+//   --target P         win rate to look for (0.5)
+//   --chase lo:hi:n    sweep chaseOffset over n values
+//   --distance lo:hi:n sweep slowMovingDistance
+//   --factor lo:hi:n   sweep slowMovingFactor
+//   --aim chase|intercept  how the candidate aims (chase)
+//   --error lo:hi:n    sweep aimError, intercept only
+//   --bounce-error lo:hi:n sweep aimBounceError, intercept only
+
+#define MATCHES_PER_TASK 64
+
+typedef struct {
+    float lo;
+    float hi;
+    int steps;
+} Sweep;
+
+typedef struct {
+    size_t wins;
+    size_t losses;
+    size_t draws;
+    size_t points;
+    double rallySum; // hits per point
+    double rallySquares;
+    size_t ticks;
+} Stats;
+
+typedef struct {
+    CpuParams* configs;
+    Stats* taskStats; // one slot per task, summed after the run
+    size_t matches;
+    size_t tasksPerConfig;
+    uint64_t seed;
+    size_t maxTicks;
+} Tournament;
+
+float Sweep_value(Sweep* sweep, int i) {
+    return sweep->steps <= 1 ?
+        sweep->lo :
+        sweep->lo + (sweep->hi - sweep->lo) * i / (sweep->steps - 1);
+}
+
+bool Sweep_parse(const char* text, Sweep* sweep) {
+    return sscanf(text, "%f:%f:%d", &sweep->lo, &sweep->hi, &sweep->steps) == 3
+        && sweep->steps > 0;
+}
+
+// Candidate plays the left side in even matches and the right side in odd
+void playMatch(
+    Tournament* t, CpuParams candidate, size_t match, Stats* stats)
+{
+    int side = match % 2;
+    Game game = Game_initMatch(CPU_VS_CPU, t->seed, match);
+    Game_setCpuParams(&game, side, candidate);
+    Game_setCpuParams(&game, !side, CPU_PARAMS_DEFAULT);
+
+    GameEvents events;
+    size_t hits = 0;
+    size_t tick = 0;
+    for (; tick < t->maxTicks && !game.ended; tick++) {
+        Game_step(&game, GAME_INPUT_IDLE, &events);
+        for (int i = 0; i < events.count; i++) {
+            if (events.events[i].type == GAMEEVENT_HIT) {
+                hits++;
+            } else if (events.events[i].type == GAMEEVENT_SCORE) {
+                stats->points++;
+                stats->rallySum += hits;
+                stats->rallySquares += (double)hits * hits;
+                hits = 0;
+            }
+        }
+    }
+    stats->ticks += tick;
+
+    if (!game.ended) {
+        stats->draws++;
+    } else if (game.players[side].score == winningScore) {
+        stats->wins++;
+    } else {
+        stats->losses++;
+    }
+    Game_del(&game);
+}
+
+void runTask(void* arg, size_t index, int worker) {
+    Tournament* t = arg;
+    size_t config = index / t->tasksPerConfig;
+    size_t first = index % t->tasksPerConfig * MATCHES_PER_TASK;
+    size_t last = first + MATCHES_PER_TASK;
+    last = last < t->matches ? last : t->matches;
+
+    Stats stats = { 0 };
+    for (size_t m = first; m < last; m++) {
+        playMatch(t, t->configs[config], m, &stats);
+    }
+    t->taskStats[index] = stats;
+}
+
+// Wilson score interval, 95%
+void wilson(size_t wins, size_t n, double* lo, double* hi) {
+    if (n == 0) {
+        *lo = 0;
+        *hi = 1;
+        return;
+    }
+    double z = 1.96;
+    double p = (double)wins / n;
+    double denom = 1 + z * z / n;
+    double center = (p + z * z / (2 * n)) / denom;
+    double half = z * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / denom;
+    *lo = center - half;
+    *hi = center + half;
+}
+
+int main(int argc, char** argv) {
+    size_t matches = 10000;
+    int threads = 0;
+    uint64_t seed = 1;
+    size_t maxTicks = 200000;
+    double target = 0.5;
+    CpuParams base = CPU_PARAMS_DEFAULT;
+    Sweep chase = { base.chaseOffset, base.chaseOffset, 1 };
+    Sweep distance = {
+        base.slowMovingDistance, base.slowMovingDistance, 1 };
+    Sweep factor = { base.slowMovingFactor, base.slowMovingFactor, 1 };
+    enum CpuAim aim = CPU_AIM_CHASE;
+    Sweep error = { 0, 0, 1 };
+    Sweep bounceError = { 0, 0, 1 };
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* opt = argv[i];
+        const char* val = argv[i + 1];
+        bool ok = true;
+        if (strcmp(opt, "--matches") == 0) {
+            matches = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--threads") == 0) {
+            threads = atoi(val);
+        } else if (strcmp(opt, "--seed") == 0) {
+            seed = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--max-ticks") == 0) {
+            maxTicks = strtoull(val, NULL, 0);
+        } else if (strcmp(opt, "--target") == 0) {
+            target = atof(val);
+        } else if (strcmp(opt, "--chase") == 0) {
+            ok = Sweep_parse(val, &chase);
+        } else if (strcmp(opt, "--distance") == 0) {
+            ok = Sweep_parse(val, &distance);
+        } else if (strcmp(opt, "--factor") == 0) {
+            ok = Sweep_parse(val, &factor);
+        } else if (strcmp(opt, "--aim") == 0) {
+            aim = strcmp(val, "intercept") == 0 ?
+                CPU_AIM_INTERCEPT : CPU_AIM_CHASE;
+            ok = aim == CPU_AIM_INTERCEPT || strcmp(val, "chase") == 0;
+        } else if (strcmp(opt, "--error") == 0) {
+            ok = Sweep_parse(val, &error);
+        } else if (strcmp(opt, "--bounce-error") == 0) {
+            ok = Sweep_parse(val, &bounceError);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "bad option %s %s\n", opt, val);
+            return 1;
+        }
+    }
+
+    size_t configCount = (size_t)chase.steps * distance.steps * factor.steps
+        * error.steps * bounceError.steps;
+    CpuParams* configs = malloc(configCount * sizeof(*configs));
+    size_t c = 0;
+    for (int a = 0; a < chase.steps; a++) {
+    for (int b = 0; b < distance.steps; b++) {
+    for (int f = 0; f < factor.steps; f++) {
+    for (int e = 0; e < error.steps; e++) {
+    for (int r = 0; r < bounceError.steps; r++) {
+        configs[c++] = (CpuParams) {
+            .aim = aim,
+            .chaseOffset = Sweep_value(&chase, a),
+            .slowMovingDistance = Sweep_value(&distance, b),
+            .slowMovingFactor = Sweep_value(&factor, f),
+            .aimError = Sweep_value(&error, e),
+            .aimBounceError = Sweep_value(&bounceError, r),
+        };
+    }
+    }
+    }
+    }
+    }
+
+    size_t tasksPerConfig = (matches + MATCHES_PER_TASK - 1) / MATCHES_PER_TASK;
+    Tournament t = {
+        .configs = configs,
+        .taskStats = calloc(configCount * tasksPerConfig, sizeof(Stats)),
+        .matches = matches,
+        .tasksPerConfig = tasksPerConfig,
+        .seed = seed,
+        .maxTicks = maxTicks,
+    };
+
+    Pool* pool = Pool_new(threads);
+    double start = now();
+    Pool_run(pool, configCount * tasksPerConfig, runTask, &t);
+    double elapsed = now() - start;
+
+    printf(
+        "%8s %8s %8s %8s %8s | %7s %17s %6s | %6s %13s\n",
+        "chase", "distance", "factor", "error", "bounce",
+        "win", "95% ci", "draws", "rally", "95% ci");
+    size_t best = 0;
+    double bestGap = INFINITY;
+    size_t totalTicks = 0;
+    for (c = 0; c < configCount; c++) {
+        Stats s = { 0 };
+        for (size_t k = 0; k < tasksPerConfig; k++) {
+            Stats* task = &t.taskStats[c * tasksPerConfig + k];
+            s.wins += task->wins;
+            s.losses += task->losses;
+            s.draws += task->draws;
+            s.points += task->points;
+            s.rallySum += task->rallySum;
+            s.rallySquares += task->rallySquares;
+            s.ticks += task->ticks;
+        }
+        totalTicks += s.ticks;
+
+        size_t decided = s.wins + s.losses;
+        double winRate = decided ? (double)s.wins / decided : 0;
+        double lo, hi;
+        wilson(s.wins, decided, &lo, &hi);
+        double rally = s.points ? s.rallySum / s.points : 0;
+        double variance = s.points > 1 ?
+            (s.rallySquares - s.rallySum * rally) / (s.points - 1) :
+            0;
+        double rallyHalf = s.points ? 1.96 * sqrt(variance / s.points) : 0;
+
+        printf(
+            "%8.4f %8.3f %8.3f %8.4f %8.4f | %7.4f [%7.4f, %7.4f] %6zu | "
+            "%6.2f [%5.2f,%5.2f]\n",
+            configs[c].chaseOffset, configs[c].slowMovingDistance,
+            configs[c].slowMovingFactor,
+            configs[c].aimError, configs[c].aimBounceError,
+            winRate, lo, hi, s.draws,
+            rally, rally - rallyHalf, rally + rallyHalf);
+
+        if (fabs(winRate - target) < bestGap) {
+            bestGap = fabs(winRate - target);
+            best = c;
+        }
+    }
+
+    printf(
+        "\nclosest to win rate %.3f: chase %.4f distance %.3f factor %.3f "
+        "error %.4f bounce %.4f\n",
+        target, configs[best].chaseOffset, configs[best].slowMovingDistance,
+        configs[best].slowMovingFactor,
+        configs[best].aimError, configs[best].aimBounceError);
+    printf(
+        "%zu matches, %zu ticks in %.3f s on %d threads, %.0f ticks/s\n",
+        configCount * matches, totalTicks, elapsed, Pool_threads(pool),
+        totalTicks / elapsed);
+
+    Pool_del(pool);
+    free(t.taskStats);
+    free(configs);
+    return 0;
+}
@@ -0,0 +1,86 @@
+#define _GNU_SOURCE
+#include "udp.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define UDP_SEND_BATCH 1024 // messages per sendmmsg
+
+int Udp_open(int port, int* bound) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    socklen_t size = sizeof(local);
+    if (bind(fd, (struct sockaddr*)&local, sizeof(local)) < 0 ||
+        getsockname(fd, (struct sockaddr*)&local, &size) < 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    if (bound) {
+        *bound = ntohs(local.sin_port);
+    }
+    return fd;
+}
+
+void Udp_setBuffers(int fd, int bytes) {
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+}
+
+bool Udp_resolve(const char* address, uint8_t addr[UDP_ADDR_SIZE]) {
+    _Static_assert(sizeof(struct sockaddr_in) == UDP_ADDR_SIZE,
+        "UDP_ADDR_SIZE is a sockaddr_in");
+    char host[256];
+    const char* colon = strrchr(address, ':');
+    if (!colon || colon - address >= (long)sizeof(host)) {
+        fprintf(stderr, "%s isn't host:port\n", address);
+        return false;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_DGRAM };
+    struct addrinfo* found;
+    int error = getaddrinfo(host, colon + 1, &hints, &found);
+    if (error) {
+        fprintf(stderr, "%s: %s\n", address, gai_strerror(error));
+        return false;
+    }
+    memcpy(addr, found->ai_addr, UDP_ADDR_SIZE);
+    freeaddrinfo(found);
+    return true;
+}
+
+size_t Udp_sendAll(int fd, struct mmsghdr* messages, size_t count) {
+    size_t failed = 0;
+    for (size_t i = 0; i < count;) {
+        size_t batch = count - i;
+        batch = batch < UDP_SEND_BATCH ? batch : UDP_SEND_BATCH;
+        int sent = sendmmsg(fd, messages + i, batch, 0);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            // skip the one the kernel refused
+            failed++;
+            i++;
+            continue;
+        }
+        i += sent;
+    }
+    return failed;
+}
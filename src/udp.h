@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// UDP sockets and packet fields shared by netplay, spectating and the
+// match server, IPv4
+
+#define UDP_ADDR_SIZE 16 // sockaddr_in
+
+struct mmsghdr;
+
+// Packet fields are little endian
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline uint16_t get16(const uint8_t* p) {
+    return p[0] | p[1] << 8;
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = v >> (8 * i);
+    }
+}
+
+static inline uint32_t get32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void put64(uint8_t* p, uint64_t v) {
+    put32(p, v);
+    put32(p + 4, v >> 32);
+}
+
+static inline uint64_t get64(const uint8_t* p) {
+    return get32(p) | (uint64_t)get32(p + 4) << 32;
+}
+
+static inline void putFloat(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put32(p, bits);
+}
+
+static inline float getFloat(const uint8_t* p) {
+    uint32_t bits = get32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Non-blocking socket on port of every interface, 0 for any free one.
+// bound gets the port, it can be NULL. -1 on failure.
+int Udp_open(int port, int* bound);
+// Send and receive buffers, for sockets that send in bursts
+void Udp_setBuffers(int fd, int bytes);
+// "host:port" to a sockaddr_in, prints why it failed
+bool Udp_resolve(const char* address, uint8_t addr[UDP_ADDR_SIZE]);
+// Sends every message with as few sendmmsg calls as it can, returns how
+// many the kernel refused
+size_t Udp_sendAll(int fd, struct mmsghdr* messages, size_t count);
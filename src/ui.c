@@ -1,5 +1,7 @@
 #include "ui.h"
 #include "raylib.h"
+#include "sfx.h"
+#include <string.h>
 
 typedef struct {
     UI* ui;
@@ -9,29 +11,25 @@ void Button_chooseOnePlayerCallback(Button* button, ButtonCallbackArgv* argv);
 void Button_chooseTwoPlayerCallback(Button* button, ButtonCallbackArgv* argv);
 void Button_playAgainCallback(Button* button, ButtonCallbackArgv* argv);
 void Button_backToMenuCallback(Button* button, ButtonCallbackArgv* argv);
-void Button_getFrame(Button* button, int w, int h, Rectangle* frame);
-void Button_update(Button* button, UI* ui, Game* game, int w, int h);
-void Button_render(Button* button, int w, int h);
+void Button_layout(Button* button, int w, int h);
+void Button_update(Button* button, UI* ui, Game* game);
+void Button_render(DrawList* list, Button* button, int w, int h);
 
-Sound* buttonSfx_press = NULL;
-Sound* buttonSfx_release = NULL;
+const AudioClip* buttonSfx = NULL;
 
-void Text_space(Text* text, int w, int h, float* textWidth, float* textHeight);
-void Text_render(Text* text, int w, int h, Color color);
+uint64_t newGameSeed(void);
 
-UI UI_init(int w, int h) {
-    if (!buttonSfx_press) {
-        buttonSfx_press = malloc(sizeof(*buttonSfx_press));
-        *buttonSfx_press = LoadSound("assets/hitsound.mp3");
-        SetSoundPitch(*buttonSfx_press, 0.7);
-        SetSoundVolume(*buttonSfx_press, 0.7);
-    }
-    if (!buttonSfx_release) {
-        buttonSfx_release = malloc(sizeof(*buttonSfx_release));
-        *buttonSfx_release = LoadSound("assets/hitsound.mp3");
-        SetSoundPitch(*buttonSfx_release, 0.6);
-        SetSoundVolume(*buttonSfx_release, 0.5);
+void Text_layout(Text* text, int w, int h);
+void Text_render(DrawList* list, Text* text, DrawColor color);
+
+void UI_loadAssets(void) {
+    if (!buttonSfx) {
+        // same clip as the hit sound, decoded once
+        buttonSfx = Sfx_acquire("assets/hitsound.mp3");
     }
+}
+
+UI UI_init(int w, int h) {
     Text pongText = {
         .text = "PONG",
         .pos = (Vector2) { .x = 0.5, .y = 0.3 },
@@ -47,7 +45,6 @@ UI UI_init(int w, int h) {
         .state = BUTTONSTATE_INACTIVE,
         .callback = (void(*)(Button*, void*))Button_chooseOnePlayerCallback,
     };
-    Button_getFrame(&onePlayerButton, w, h, &onePlayerButton.frame);
 
     Button twoPlayerButton = {
         .text = (Text) {
@@ -58,7 +55,6 @@ UI UI_init(int w, int h) {
         .state = BUTTONSTATE_INACTIVE,
         .callback = (void(*)(Button*, void*))Button_chooseTwoPlayerCallback,
     };
-    Button_getFrame(&twoPlayerButton, w, h, &twoPlayerButton.frame);
 
     Text playerOneWinText = {
         .text = "P1 WINS",
@@ -81,7 +77,6 @@ UI UI_init(int w, int h) {
         .state = BUTTONSTATE_INACTIVE,
         .callback = (void(*)(Button*, void*))Button_playAgainCallback,
     };
-    Button_getFrame(&playAgainButton, w, h, &playAgainButton.frame);
 
     Button backToMenuButton = {
         .text = (Text) {
@@ -92,9 +87,8 @@ UI UI_init(int w, int h) {
         .state = BUTTONSTATE_INACTIVE,
         .callback = (void(*)(Button*, void*))Button_backToMenuCallback,
     };
-    Button_getFrame(&backToMenuButton, w, h, &backToMenuButton.frame);
 
-    return (UI) {
+    UI ui = {
         .screen = SCREEN_TITLE,
         .pongText = pongText,
         .onePlayerButton = onePlayerButton,
@@ -103,58 +97,88 @@ UI UI_init(int w, int h) {
         .playerTwoWinText = playerTwoWinText,
         .playAgainButton = playAgainButton,
         .backToMenuButton = backToMenuButton,
+        .layoutW = 0,
+        .layoutH = 0,
     };
+    UI_layout(&ui, w, h);
+    return ui;
 }
 
 void UI_del(UI* ui) {
-    UnloadSound(*buttonSfx_press);
-    UnloadSound(*buttonSfx_release);
-    free(buttonSfx_press);
-    free(buttonSfx_release);
-    buttonSfx_press = NULL;
-    buttonSfx_release = NULL;
+    Sfx_release(buttonSfx);
+    buttonSfx = NULL;
+}
+
+void UI_layout(UI* ui, int w, int h) {
+    if (ui->layoutW == w && ui->layoutH == h) {
+        return;
+    }
+    Text_layout(&ui->pongText, w, h);
+    Button_layout(&ui->onePlayerButton, w, h);
+    Button_layout(&ui->twoPlayerButton, w, h);
+    Text_layout(&ui->playerOneWinText, w, h);
+    Text_layout(&ui->playerTwoWinText, w, h);
+    Button_layout(&ui->playAgainButton, w, h);
+    Button_layout(&ui->backToMenuButton, w, h);
+    ui->layoutW = w;
+    ui->layoutH = h;
 }
 
-void UI_update(UI* ui, Game* game, int w, int h) {
+bool UI_update(UI* ui, Game* game, int w, int h) {
+    #define buttonStates() { \
+        ui->onePlayerButton.state, ui->twoPlayerButton.state, \
+        ui->playAgainButton.state, ui->backToMenuButton.state, \
+    }
+
+    bool resized = ui->layoutW != w || ui->layoutH != h;
+    enum Screen screen = ui->screen;
+    enum ButtonState before[] = buttonStates();
+    UI_layout(ui, w, h);
     if (ui->screen == SCREEN_TITLE) {
-        Button_update(&ui->onePlayerButton, ui, game, w, h);
-        Button_update(&ui->twoPlayerButton, ui, game, w, h);
+        Button_update(&ui->onePlayerButton, ui, game);
+        Button_update(&ui->twoPlayerButton, ui, game);
     } else if (ui->screen == SCREEN_END) {
-        Button_update(&ui->playAgainButton, ui, game, w, h);
-        Button_update(&ui->backToMenuButton, ui, game, w, h);
+        Button_update(&ui->playAgainButton, ui, game);
+        Button_update(&ui->backToMenuButton, ui, game);
     }
+    enum ButtonState after[] = buttonStates();
+    return resized || ui->screen != screen ||
+        memcmp(before, after, sizeof(before)) != 0;
+
+    #undef buttonStates
 }
 
-void UI_render(UI* ui, Game* game, int w, int h) {
+void UI_render(DrawList* list, UI* ui, Game* game, int w, int h) {
+    UI_layout(ui, w, h);
     if (ui->screen == SCREEN_TITLE) {
-        Text_render(&ui->pongText, w, h, WHITE);
-        Button_render(&ui->onePlayerButton, w, h);
-        Button_render(&ui->twoPlayerButton, w, h);
+        Text_render(list, &ui->pongText, DRAW_WHITE);
+        Button_render(list, &ui->onePlayerButton, w, h);
+        Button_render(list, &ui->twoPlayerButton, w, h);
     } else if (ui->screen == SCREEN_END) {
-        Text* text = game->players[0]->score == 11 ?
+        Text* text = game->players[0].score == winningScore ?
             &ui->playerOneWinText :
             &ui->playerTwoWinText;
-        Text_render(text, w, h, WHITE);
-        Button_render(&ui->playAgainButton, w, h);
-        Button_render(&ui->backToMenuButton, w, h);
+        Text_render(list, text, DRAW_WHITE);
+        Button_render(list, &ui->playAgainButton, w, h);
+        Button_render(list, &ui->backToMenuButton, w, h);
     }
 }
 
 void Button_chooseOnePlayerCallback(Button* button, ButtonCallbackArgv* argv) {
     argv->ui->screen = SCREEN_GAME;
-    *argv->game = Game_init(ONE_PLAYER);
+    *argv->game = Game_init(ONE_PLAYER, newGameSeed());
 }
 
 void Button_chooseTwoPlayerCallback(Button* button, ButtonCallbackArgv* argv) {
     argv->ui->screen = SCREEN_GAME;
-    *argv->game = Game_init(TWO_PLAYERS);
+    *argv->game = Game_init(TWO_PLAYERS, newGameSeed());
 }
 
 void Button_playAgainCallback(Button* button, ButtonCallbackArgv* argv) {
     argv->ui->screen = SCREEN_GAME;
-    enum Mode mode = argv->game->players[0]->isCpu ? ONE_PLAYER : TWO_PLAYERS;
+    enum Mode mode = argv->game->players[0].isCpu ? ONE_PLAYER : TWO_PLAYERS;
     Game_del(argv->game);
-    *argv->game = Game_init(mode);
+    *argv->game = Game_init(mode, newGameSeed());
 }
 
 void Button_backToMenuCallback(Button* button, ButtonCallbackArgv* argv) {
@@ -162,8 +186,16 @@ void Button_backToMenuCallback(Button* button, ButtonCallbackArgv* argv) {
     argv->ui->screen = SCREEN_TITLE;
 }
 
-void Button_update(Button* button, UI* ui, Game* game, int w, int h) {
-    Button_getFrame(button, w, h, &button->frame);
+// raylib's rng only hands out small ints, so assemble 64 bits from 16 bit draws
+uint64_t newGameSeed(void) {
+    uint64_t seed = 0;
+    for (int i = 0; i < 4; i++) {
+        seed = seed << 16 | (uint64_t)GetRandomValue(0, 0xffff);
+    }
+    return seed;
+}
+
+void Button_update(Button* button, UI* ui, Game* game) {
     Vector2 mousePoint = GetMousePosition();
     if (CheckCollisionPointRec(mousePoint, button->frame)) {
         if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
@@ -173,12 +205,10 @@ void Button_update(Button* button, UI* ui, Game* game, int w, int h) {
                     .game = game,
                 };
             button->callback(button, &argv);
-            if (buttonSfx_release) {
-                PlaySound(*buttonSfx_release);
-            }
+            Sfx_play(buttonSfx, 0.6, 0.5);
         } else if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-            if (button->state != BUTTONSTATE_PRESSING && buttonSfx_press) {
-                PlaySound(*buttonSfx_press);
+            if (button->state != BUTTONSTATE_PRESSING) {
+                Sfx_play(buttonSfx, 0.7, 0.7);
             }
             button->state = BUTTONSTATE_PRESSING;
         } else {
@@ -189,18 +219,18 @@ void Button_update(Button* button, UI* ui, Game* game, int w, int h) {
     }
 }
 
-void Button_getFrame(Button* button, int w, int h, Rectangle* frame) {
-    float textWidth, textHeight;
-    Text_space(&button->text, w, h, &textWidth, &textHeight);
+void Button_layout(Button* button, int w, int h) {
+    Text_layout(&button->text, w, h);
+    Rectangle* textBounds = &button->text.bounds;
     Vector2 pos = {
         .x = button->text.pos.x * w,
         .y = button->text.pos.y * h,
     };
     Vector2 frameDim = {
-        .x = textWidth + 0.03 * 2 * w,
-        .y = textHeight + 0.03 * 2 * h,
+        .x = textBounds->width + 0.03 * 2 * w,
+        .y = textBounds->height + 0.03 * 2 * h,
     };
-    *frame = (Rectangle){
+    button->frame = (Rectangle){
         .x = pos.x - frameDim.x / 2,
         .y = pos.y - frameDim.y / 2,
         .width = frameDim.x,
@@ -209,12 +239,13 @@ void Button_getFrame(Button* button, int w, int h, Rectangle* frame) {
 }
 
 void drawButtonFrame(
+    DrawList* list,
     Rectangle* rec,
     enum ButtonState state,
     int w,
     int h)
 {
-    DrawRectangleRec(*rec, WHITE);
+    DrawList_rect(list, rec->x, rec->y, rec->width, rec->height, DRAW_WHITE);
     if (state != BUTTONSTATE_ACTIVE) {
         float borderWidth = 0.01;
         Rectangle inner = {
@@ -223,36 +254,41 @@ void drawButtonFrame(
             .width = rec->width - borderWidth * 2 * w,
             .height = rec->height - borderWidth * 2 * h,
         };
-        Color color = state == BUTTONSTATE_INACTIVE ?
-            BLACK :
+        DrawColor color = state == BUTTONSTATE_INACTIVE ?
+            DRAW_BLACK :
             state == BUTTONSTATE_ACTIVE ?
-                WHITE :
-                DARKGRAY;
-        DrawRectangleRec(inner, color);
+                DRAW_WHITE :
+                DRAW_DARKGRAY;
+        DrawList_rect(
+            list, inner.x, inner.y, inner.width, inner.height, color);
     }
 }
 
-void Button_render(Button* button, int w, int h) {
-    drawButtonFrame(&button->frame, button->state, w, h);
-    Color color = button->state == BUTTONSTATE_INACTIVE ?
-        WHITE :
+void Button_render(DrawList* list, Button* button, int w, int h) {
+    drawButtonFrame(list, &button->frame, button->state, w, h);
+    DrawColor color = button->state == BUTTONSTATE_INACTIVE ?
+        DRAW_WHITE :
         button->state == BUTTONSTATE_ACTIVE ?
-            BLACK :
-            LIGHTGRAY;
-    Text_render(&button->text, w, h, color);
+            DRAW_BLACK :
+            DRAW_LIGHTGRAY;
+    Text_render(list, &button->text, color);
 }
 
-void Text_space(Text* text, int w, int h, float* textWidth, float* textHeight) {
+// Centered on pos
+void Text_layout(Text* text, int w, int h) {
     float fontSize = text->fontSize * h;
-    *textWidth = MeasureText(text->text, fontSize);
-    *textHeight = fontSize;
+    float width = MeasureText(text->text, fontSize);
+    text->bounds = (Rectangle) {
+        .x = text->pos.x * w - width / 2.f,
+        .y = text->pos.y * h - fontSize / 2.f,
+        .width = width,
+        .height = fontSize,
+    };
 }
 
-void Text_render(Text* text, int w, int h, Color color) {
-    float fontSize = text->fontSize * h;
-    float textWidth, textHeight;
-    Text_space(text, w, h, &textWidth, &textHeight);
-    float x = text->pos.x * w - textWidth / 2.f;
-    float y = text->pos.y * h - textHeight / 2.f;
-    DrawText(text->text, x, y, fontSize, color);
+// Left aligned at the measured position, so the backend doesn't measure
+void Text_render(DrawList* list, Text* text, DrawColor color) {
+    Rectangle* b = &text->bounds;
+    DrawList_text(
+        list, text->text, b->x, b->y, b->height, DRAW_ALIGN_LEFT, color);
 }
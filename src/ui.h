@@ -4,8 +4,9 @@
 
 typedef struct {
     const char* text;
-    Vector2 pos;
-    float fontSize;
+    Vector2 pos; // center, fraction of the window
+    float fontSize; // fraction of the window height
+    Rectangle bounds; // pixels, set by the layout
 } Text;
 
 typedef struct Button {
@@ -15,7 +16,7 @@ typedef struct Button {
         BUTTONSTATE_ACTIVE,
         BUTTONSTATE_PRESSING,
     } state;
-    Rectangle frame;
+    Rectangle frame; // pixels, set by the layout
     void (*callback)(struct Button*, void*);
 } Button;
 
@@ -33,9 +34,22 @@ typedef struct {
     Text playerTwoWinText;
     Button playAgainButton;
     Button backToMenuButton;
+
+    // window size the bounds and frames were laid out for
+    int layoutW;
+    int layoutH;
 } UI;
 
 UI UI_init(int w, int h);
 void UI_del(UI* ui);
-void UI_update(UI* ui, Game* game, int w, int h);
-void UI_render(UI* ui, Game* game, int w, int h);
+// Between Sfx_opened and Sfx_close, buttons are silent until then
+void UI_loadAssets(void);
+// Measures text and places every element, only when the size changed
+void UI_layout(UI* ui, int w, int h);
+// True when the screen, a button state or the layout changed, so the last
+// UI_render output is stale
+bool UI_update(UI* ui, Game* game, int w, int h);
+void UI_render(DrawList* list, UI* ui, Game* game, int w, int h);
+
+// From raylib's rng
+uint64_t newGameSeed(void);